@@ -5,7 +5,8 @@ int32_t BitExtractor::extract(const uint8_t* payload,
                               int bitStart,
                               int bitLength,
                               bool littleEndian,
-                              bool signExtend)
+                              bool signExtend,
+                              int payloadSize)
 {
     if (bitLength <= 0 || bitLength > 32 || byteOffset < 0) {
         return 0;
@@ -19,12 +20,12 @@ int32_t BitExtractor::extract(const uint8_t* payload,
     uint32_t raw = 0;
     if (littleEndian) {
         // Little endian: LSB first
-        for (int i = 0; i < bytesNeeded && (byteOffset + i) < 8; ++i) {
+        for (int i = 0; i < bytesNeeded && (byteOffset + i) < payloadSize; ++i) {
             raw |= static_cast<uint32_t>(payload[byteOffset + i]) << (i * 8);
         }
     } else {
         // Big endian: MSB first
-        for (int i = 0; i < bytesNeeded && (byteOffset + i) < 8; ++i) {
+        for (int i = 0; i < bytesNeeded && (byteOffset + i) < payloadSize; ++i) {
             raw = (raw << 8) | payload[byteOffset + i];
         }
         // For big endian, we need to align the extracted bits properly
@@ -52,31 +53,40 @@ int32_t BitExtractor::extract(const uint8_t* payload,
 
 void BitExtractor::pack(uint8_t* payload,
                         int byteOffset,
+                        int bitStart,
                         int bitLength,
                         bool littleEndian,
-                        int32_t value)
+                        int32_t value,
+                        int payloadSize)
 {
-    if (bitLength <= 0 || bitLength > 32 || byteOffset < 0) {
+    if (bitLength <= 0 || bitLength > 32 || byteOffset < 0 || bitStart < 0 || bitStart > 7) {
         return;
     }
 
-    int bytesNeeded = (bitLength + 7) / 8;
-    uint32_t raw = static_cast<uint32_t>(value);
+    int totalBits = bitStart + bitLength;
+    int bytesNeeded = (totalBits + 7) / 8;
 
-    // Mask to the bit length
-    uint32_t mask = (bitLength == 32) ? 0xFFFFFFFF : ((1U << bitLength) - 1);
-    raw &= mask;
+    // Bit position of the field within the assembled word. Big endian
+    // fields sit at the top of their bytes, as extract() reads them.
+    int shift = littleEndian ? bitStart : (bytesNeeded * 8) - bitLength;
 
-    if (littleEndian) {
-        // Little endian: LSB first
-        for (int i = 0; i < bytesNeeded && (byteOffset + i) < 8; ++i) {
-            payload[byteOffset + i] = static_cast<uint8_t>(raw & 0xFF);
-            raw >>= 8;
-        }
-    } else {
-        // Big endian: MSB first
-        for (int i = bytesNeeded - 1; i >= 0 && (byteOffset + i) < 8; --i) {
-            payload[byteOffset + (bytesNeeded - 1 - i)] = static_cast<uint8_t>((raw >> (i * 8)) & 0xFF);
+    uint64_t mask = ((uint64_t(1) << bitLength) - 1) << shift;
+    uint64_t bits = (static_cast<uint64_t>(static_cast<uint32_t>(value)) << shift) & mask;
+
+    // Read-modify-write so neighbouring fields sharing a byte survive
+    uint64_t word = 0;
+    for (int i = 0; i < bytesNeeded; ++i) {
+        uint64_t byte = (byteOffset + i) < payloadSize ? payload[byteOffset + i] : 0;
+        if (littleEndian) {
+            word |= byte << (i * 8);
+        } else {
+            word = (word << 8) | byte;
         }
     }
+    word = (word & ~mask) | bits;
+
+    for (int i = 0; i < bytesNeeded && (byteOffset + i) < payloadSize; ++i) {
+        int byteShift = littleEndian ? i * 8 : (bytesNeeded - 1 - i) * 8;
+        payload[byteOffset + i] = static_cast<uint8_t>((word >> byteShift) & 0xFF);
+    }
 }
@@ -6,31 +6,41 @@
 class BitExtractor
 {
 public:
+    static constexpr int kClassicPayloadSize = 8;
+    static constexpr int kMaxPayloadSize = 64;   // CAN-FD
+
     // Extract bits from CAN frame payload
-    // payload: CAN frame data (up to 8 bytes for classic CAN)
-    // byteOffset: starting byte (0-7)
+    // payload: CAN frame data
+    // byteOffset: starting byte
     // bitStart: starting bit within the extracted bytes (0 = LSB)
     // bitLength: number of bits to extract (1-32)
     // littleEndian: byte order for multi-byte fields
     // signExtend: sign-extend the result for signed values
+    // payloadSize: bytes available in payload (8 for classic CAN, up to 64 for CAN-FD)
     static int32_t extract(const uint8_t* payload,
                            int byteOffset,
                            int bitStart,
                            int bitLength,
                            bool littleEndian,
-                           bool signExtend);
+                           bool signExtend,
+                           int payloadSize = kClassicPayloadSize);
 
-    // Pack value into CAN frame payload (for commands)
+    // Pack value into CAN frame payload (for commands). Exact inverse of
+    // extract() with the same layout; bits outside the field are preserved.
     // payload: destination buffer
     // byteOffset: starting byte
-    // bitLength: number of bits (determines how many bytes to write)
+    // bitStart: starting bit within the written bytes (0 = LSB)
+    // bitLength: number of bits (1-32)
     // littleEndian: byte order
-    // value: value to pack
+    // value: value to pack (truncated to bitLength)
+    // payloadSize: bytes available in payload; writes past it are dropped
     static void pack(uint8_t* payload,
                      int byteOffset,
+                     int bitStart,
                      int bitLength,
                      bool littleEndian,
-                     int32_t value);
+                     int32_t value,
+                     int payloadSize = kClassicPayloadSize);
 };
 
 #endif // BIT_EXTRACTOR_H
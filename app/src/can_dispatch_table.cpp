@@ -0,0 +1,57 @@
+#include "can_dispatch_table.h"
+
+#include <algorithm>
+
+CanDispatchTable CanDispatchTable::build(const MotorProfile& profile, int bus)
+{
+    CanDispatchTable table;
+    const int motorCount = std::min<int>(profile.motors.size(), INT16_MAX);
+
+    auto onBus = [&profile, bus](int i) {
+        const int motorBus = profile.motors[i].bus;
+        return motorBus < 0 || motorBus == bus;
+    };
+
+    for (int i = 0; i < motorCount; ++i) {
+        if (!onBus(i)) {
+            continue;
+        }
+        const CanIdMatcher& matcher = profile.motors[i].canIdMatcher;
+        if (matcher.mode == CanIdMatcher::Mode::Mask) {
+            table.m_masks.push_back({matcher.mask, matcher.value, i});
+        } else if (matcher.canId >= kStandardIdCount && !table.m_extended.contains(matcher.canId)) {
+            table.m_extended.insert(matcher.canId, i);
+        }
+    }
+    std::sort(table.m_masks.begin(), table.m_masks.end(),
+              [](const MaskEntry& a, const MaskEntry& b) { return a.motorIndex < b.motorIndex; });
+
+    // The standard ID space is small enough to resolve every entry up front
+    table.m_standard.assign(kStandardIdCount, -1);
+    for (uint32_t id = 0; id < kStandardIdCount; ++id) {
+        for (int i = 0; i < motorCount; ++i) {
+            if (onBus(i) && profile.motors[i].canIdMatcher.matches(id)) {
+                table.m_standard[id] = static_cast<int16_t>(i);
+                break;
+            }
+        }
+    }
+
+    return table;
+}
+
+int CanDispatchTable::lookupExtended(uint32_t canId) const
+{
+    int exact = m_extended.value(canId, -1);
+
+    // Only masks declared before the exact match can take precedence
+    for (const MaskEntry& entry : m_masks) {
+        if (exact >= 0 && entry.motorIndex > exact) {
+            break;
+        }
+        if ((canId & entry.mask) == entry.value) {
+            return entry.motorIndex;
+        }
+    }
+    return exact;
+}
@@ -0,0 +1,48 @@
+#ifndef CAN_DISPATCH_TABLE_H
+#define CAN_DISPATCH_TABLE_H
+
+#include <QHash>
+
+#include <cstdint>
+#include <vector>
+
+#include "motor_profile.h"
+
+// CAN ID -> motor index lookup built once per profile.
+// Standard 11-bit IDs resolve through a direct-indexed table, extended IDs
+// through a hash of exact matchers, with mask matchers checked last.
+// Preserves the first-match-wins order of MotorProfile::motors.
+class CanDispatchTable
+{
+public:
+    static constexpr uint32_t kStandardIdCount = 0x800;
+
+    // Build for one bus: motors bound to that bus plus motors with bus -1.
+    // bus = -1 builds the table for motors not bound to any bus.
+    static CanDispatchTable build(const MotorProfile& profile, int bus = -1);
+
+    // Motor index for canId, or -1 if no motor matches
+    int lookup(uint32_t canId) const
+    {
+        if (canId < kStandardIdCount) {
+            return m_standard.empty() ? -1 : m_standard[canId];
+        }
+        return lookupExtended(canId);
+    }
+
+private:
+    struct MaskEntry
+    {
+        uint32_t mask = 0;
+        uint32_t value = 0;
+        int motorIndex = -1;
+    };
+
+    int lookupExtended(uint32_t canId) const;
+
+    std::vector<int16_t> m_standard;     // Fully resolved, including masks
+    QHash<uint32_t, int> m_extended;     // Exact matchers above 0x7FF
+    std::vector<MaskEntry> m_masks;      // Sorted by motor index
+};
+
+#endif // CAN_DISPATCH_TABLE_H
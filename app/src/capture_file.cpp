@@ -0,0 +1,175 @@
+#include "capture_file.h"
+
+#include <QFile>
+
+#include <algorithm>
+
+namespace {
+// Without a footer, consecutive records of one lane are indexed in runs of
+// at most this many frames
+constexpr uint32_t kScanRunFrames = 4096;
+}
+
+CaptureFile::CaptureFile() = default;
+
+CaptureFile::~CaptureFile()
+{
+    close();
+}
+
+bool CaptureFile::open(const QString& path, QString* error)
+{
+    close();
+
+    auto fail = [&](const QString& message) {
+        if (error) {
+            *error = message;
+        }
+        close();
+        return false;
+    };
+
+    m_file = std::make_unique<QFile>(path);
+    if (!m_file->open(QIODevice::ReadOnly)) {
+        return fail(m_file->errorString());
+    }
+    const qint64 size = m_file->size();
+    if (size < static_cast<qint64>(sizeof(CaptureFileHeader))) {
+        return fail(QStringLiteral("Not a frame capture file"));
+    }
+    m_data = m_file->map(0, size);
+    if (!m_data) {
+        return fail(m_file->errorString());
+    }
+    m_size = static_cast<uint64_t>(size);
+    m_path = path;
+
+    CaptureFileHeader header;
+    std::memcpy(&header, m_data, sizeof(header));
+    if (!CaptureFormat::isValid(header)) {
+        return fail(QStringLiteral("Not a frame capture file"));
+    }
+    m_recordsEnd = m_size;
+
+    // Version 1 has no footer; neither has a file whose recording was cut short
+    CaptureTrailer trailer;
+    if (header.version < 2 || m_size < sizeof(header) + sizeof(trailer)) {
+        return true;
+    }
+    std::memcpy(&trailer, m_data + m_size - sizeof(trailer), sizeof(trailer));
+    const uint64_t blockBytes = uint64_t(trailer.blockCount) * sizeof(CaptureBlockEntry);
+    const uint64_t summaryBytes = uint64_t(trailer.summaryCount) * sizeof(CaptureIdSummary);
+    if (!CaptureFormat::isValid(trailer) || trailer.indexOffset % 8 != 0 || trailer.indexOffset < sizeof(header)
+        || trailer.indexOffset + blockBytes + summaryBytes + sizeof(trailer) != m_size) {
+        return true;
+    }
+
+    std::vector<CaptureBlockEntry> blocks(trailer.blockCount);
+    std::memcpy(blocks.data(), m_data + trailer.indexOffset, blockBytes);
+    uint64_t recordsEnd = sizeof(header);
+    for (const CaptureBlockEntry& block : blocks) {
+        if (block.offset < sizeof(header) || block.offset + block.size > trailer.indexOffset
+            || uint64_t(block.firstSummary) + block.summaryCount > trailer.summaryCount) {
+            return true;
+        }
+        recordsEnd = std::max<uint64_t>(recordsEnd, block.offset + block.size);
+    }
+
+    // The footer is 8-byte aligned, so the summaries are used in place
+    m_recordsEnd = recordsEnd;
+    m_indexed = true;
+    useIndex(std::move(blocks), reinterpret_cast<const CaptureIdSummary*>(m_data + trailer.indexOffset + blockBytes));
+    return true;
+}
+
+void CaptureFile::close()
+{
+    if (m_file) {
+        if (m_data) {
+            m_file->unmap(const_cast<uchar*>(m_data));
+        }
+        m_file->close();
+        m_file.reset();
+    }
+    m_path.clear();
+    m_data = nullptr;
+    m_size = 0;
+    m_recordsEnd = 0;
+    m_indexed = false;
+    m_blocks.clear();
+    m_summaries = nullptr;
+    m_scanned.clear();
+    m_firstTimeNs = 0;
+    m_lastTimeNs = 0;
+    m_maxBlockSpanNs = 0;
+}
+
+void CaptureFile::scanIndex()
+{
+    if (!m_data || m_indexed || !m_blocks.empty()) {
+        return;
+    }
+
+    // A run ends where the lane changes, time steps back or it gets long;
+    // inside a run the records then are exactly like a recorder block's
+    uint64_t pos = recordsBegin();
+    uint64_t runStart = pos;
+    uint32_t runFrames = 0;
+    CaptureRecord previous = {};
+    while (m_size - pos >= sizeof(CaptureRecord)) {
+        CaptureRecord record;
+        std::memcpy(&record, m_data + pos, sizeof(record));
+        if (m_size - pos < sizeof(record) + record.length || !CaptureFormat::isConsistent(record)) {
+            break;
+        }
+        if (runFrames > 0
+            && (record.bus != previous.bus || ((record.flags ^ previous.flags) & CaptureFormat::Tx)
+                || record.hostTimeNs < previous.hostTimeNs || runFrames >= kScanRunFrames)) {
+            m_scanned.addBlock(runStart, m_data + runStart, pos - runStart);
+            runStart = pos;
+            runFrames = 0;
+        }
+        previous = record;
+        ++runFrames;
+        pos += sizeof(record) + record.length;
+    }
+    if (runFrames > 0) {
+        m_scanned.addBlock(runStart, m_data + runStart, pos - runStart);
+    }
+
+    m_recordsEnd = pos;
+    useIndex(m_scanned.blocks(), m_scanned.summaries().data());
+}
+
+void CaptureFile::useIndex(std::vector<CaptureBlockEntry> blocks, const CaptureIdSummary* summaries)
+{
+    std::stable_sort(blocks.begin(), blocks.end(), [](const CaptureBlockEntry& a, const CaptureBlockEntry& b) {
+        return a.firstTimeNs < b.firstTimeNs;
+    });
+    m_blocks = std::move(blocks);
+    m_summaries = summaries;
+
+    m_firstTimeNs = m_blocks.empty() ? 0 : m_blocks.front().firstTimeNs;
+    m_lastTimeNs = m_firstTimeNs;
+    m_maxBlockSpanNs = 0;
+    for (const CaptureBlockEntry& block : m_blocks) {
+        m_lastTimeNs = std::max(m_lastTimeNs, block.lastTimeNs);
+        m_maxBlockSpanNs = std::max(m_maxBlockSpanNs, block.lastTimeNs - block.firstTimeNs);
+    }
+}
+
+std::vector<int> CaptureFile::blocksInRange(int64_t t0, int64_t t1) const
+{
+    // No block starting before t0 - longest span can reach t0
+    std::vector<int> result;
+    auto it = std::lower_bound(m_blocks.begin(), m_blocks.end(), t0 - m_maxBlockSpanNs,
+                               [](const CaptureBlockEntry& block, int64_t time) {
+                                   return block.firstTimeNs < time;
+                               });
+    for (; it != m_blocks.end() && it->firstTimeNs <= t1; ++it) {
+        if (it->lastTimeNs >= t0) {
+            result.push_back(static_cast<int>(it - m_blocks.begin()));
+        }
+    }
+    return result;
+}
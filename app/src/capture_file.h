@@ -0,0 +1,92 @@
+#ifndef CAPTURE_FILE_H
+#define CAPTURE_FILE_H
+
+#include <QString>
+
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <vector>
+
+#include "capture_format.h"
+#include "capture_index.h"
+
+class QFile;
+
+// Read-only view of a capture file (see capture_format.h) through a memory
+// mapping. Opening reads the header and the index footer only; the pages
+// of a block are faulted in when its records are visited, so a time range
+// of an hours-long capture costs the blocks that cover it.
+class CaptureFile
+{
+public:
+    CaptureFile();
+    ~CaptureFile();
+
+    CaptureFile(const CaptureFile&) = delete;
+    CaptureFile& operator=(const CaptureFile&) = delete;
+
+    // Map path and load its index. Returns false with error set when the
+    // file cannot be mapped or is not a capture.
+    bool open(const QString& path, QString* error = nullptr);
+    void close();
+
+    bool isOpen() const { return m_data != nullptr; }
+    QString path() const { return m_path; }
+    uint64_t fileSize() const { return m_size; }
+
+    // Whether the index came from the footer. Without one, blocks() stays
+    // empty until scanIndex() has read the whole file.
+    bool isIndexed() const { return m_indexed; }
+    void scanIndex();
+
+    // Records occupy [recordsBegin(), recordsEnd()) of data()
+    const uint8_t* data() const { return m_data; }
+    uint64_t recordsBegin() const { return sizeof(CaptureFileHeader); }
+    uint64_t recordsEnd() const { return m_recordsEnd; }
+
+    // Index, with blocks ordered by their first time stamp
+    const std::vector<CaptureBlockEntry>& blocks() const { return m_blocks; }
+    const CaptureIdSummary* summaries(const CaptureBlockEntry& block) const { return m_summaries + block.firstSummary; }
+    int64_t firstTimeNs() const { return m_firstTimeNs; }
+    int64_t lastTimeNs() const { return m_lastTimeNs; }
+
+    // Indices into blocks() of the blocks with records in [t0, t1]
+    std::vector<int> blocksInRange(int64_t t0, int64_t t1) const;
+
+    // Call f(const CaptureRecord&, const uint8_t* payload) for each record of block
+    template <typename F>
+    void forEachRecord(const CaptureBlockEntry& block, F&& f) const
+    {
+        const uint8_t* p = m_data + block.offset;
+        const uint8_t* end = p + block.size;
+        while (static_cast<size_t>(end - p) >= sizeof(CaptureRecord)) {
+            CaptureRecord record;
+            std::memcpy(&record, p, sizeof(record));
+            if (static_cast<size_t>(end - p) < sizeof(record) + record.length) {
+                break;
+            }
+            f(record, p + sizeof(record));
+            p += sizeof(record) + record.length;
+        }
+    }
+
+private:
+    void useIndex(std::vector<CaptureBlockEntry> blocks, const CaptureIdSummary* summaries);
+
+    std::unique_ptr<QFile> m_file;
+    QString m_path;
+    const uint8_t* m_data = nullptr;
+    uint64_t m_size = 0;
+    uint64_t m_recordsEnd = 0;
+
+    bool m_indexed = false;
+    std::vector<CaptureBlockEntry> m_blocks;
+    const CaptureIdSummary* m_summaries = nullptr;   // In the mapping, or m_scanned's
+    CaptureIndexBuilder m_scanned;                   // Index of a file without footer
+    int64_t m_firstTimeNs = 0;
+    int64_t m_lastTimeNs = 0;
+    int64_t m_maxBlockSpanNs = 0;                    // Longest lastTimeNs - firstTimeNs
+};
+
+#endif // CAPTURE_FILE_H
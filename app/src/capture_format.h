@@ -0,0 +1,182 @@
+#ifndef CAPTURE_FORMAT_H
+#define CAPTURE_FORMAT_H
+
+#include <cstdint>
+#include <cstring>
+
+#include "pub_user.h"
+
+// On-disk layout of a raw frame capture (.dmcap). A file header is followed
+// by records back to back, each a CaptureRecord plus `length` payload bytes,
+// so records are not aligned and are read with memcpy. Records are in time
+// order per bus and direction only: blocks of different buses interleave.
+// Integers are stored in host order; every supported target is little-endian.
+//
+// From version 2 a cleanly closed file ends in an index footer. The last
+// record is followed by an end marker (a CaptureRecord of 0xFF bytes, which
+// no reader takes for a record) and zero padding to 8-byte alignment, then:
+//   CaptureBlockEntry[blockCount]  one per written block, in file order
+//   CaptureIdSummary[idCount]      per block, per CAN ID
+//   CaptureTrailer                 last bytes of the file
+// A file without the trailer (recording cut short, or version 1) holds
+// records up to its end and is indexed by scanning instead.
+struct CaptureFileHeader
+{
+    char magic[8];
+    uint32_t version;
+    uint32_t recordSize;         // sizeof(CaptureRecord) the file was written with
+};
+
+struct CaptureRecord
+{
+    int64_t hostTimeNs;          // Host monotonic time at callback entry
+    uint64_t deviceTime;         // Adapter time stamp, 0 when not provided
+    uint32_t canId;              // 29-bit identifier
+    uint8_t bus;                 // device * 2 + channel
+    uint8_t flags;               // CaptureFormat::Flag bits
+    uint8_t dlc;
+    uint8_t length;              // Payload bytes that follow
+};
+
+// One recorder block: records of a single bus and direction, in time order
+struct CaptureBlockEntry
+{
+    uint64_t offset;             // File offset of the first record
+    uint32_t size;               // Bytes of records
+    uint32_t frames;
+    int64_t firstTimeNs;
+    int64_t lastTimeNs;
+    uint32_t firstSummary;       // Index of the block's first CaptureIdSummary
+    uint16_t summaryCount;
+    uint8_t bus;
+    uint8_t flags;               // CaptureFormat::Tx for a transmit lane
+};
+
+// Frames of one CAN ID within a block
+struct CaptureIdSummary
+{
+    uint32_t canId;
+    uint32_t frames;
+    int64_t firstTimeNs;
+    int64_t lastTimeNs;
+};
+
+struct CaptureTrailer
+{
+    uint64_t indexOffset;        // First CaptureBlockEntry; records end here
+    uint32_t blockCount;
+    uint32_t summaryCount;
+    int64_t firstTimeNs;         // Over all records
+    int64_t lastTimeNs;
+    char magic[8];               // CaptureFormat::kIndexMagic
+};
+
+class CaptureFormat
+{
+public:
+    static constexpr char kMagic[8] = {'D', 'M', 'C', 'A', 'P', 'T', 'R', 'E'};
+    static constexpr char kIndexMagic[8] = {'D', 'M', 'C', 'A', 'P', 'I', 'D', 'X'};
+    static constexpr uint32_t kVersion = 2;
+
+    enum Flag : uint8_t {
+        Ext = 0x01,
+        Rtr = 0x02,
+        Esi = 0x04,
+        CanFd = 0x08,
+        Brs = 0x10,
+        Tx = 0x20,               // Echo of a frame this host sent
+        Ack = 0x40
+    };
+
+    // Largest record including its payload
+    static constexpr int kMaxRecordSize = static_cast<int>(sizeof(CaptureRecord)) + 64;
+
+    static CaptureFileHeader fileHeader()
+    {
+        CaptureFileHeader header;
+        std::memcpy(header.magic, kMagic, sizeof(kMagic));
+        header.version = kVersion;
+        header.recordSize = sizeof(CaptureRecord);
+        return header;
+    }
+
+    // Payload bytes carried by a frame with this DLC
+    static int payloadLength(uint8_t dlc, bool canfd)
+    {
+        static constexpr uint8_t kFdLengths[] = {12, 16, 20, 24, 32, 48, 64};
+        dlc &= 0xF;
+        if (dlc <= 8) {
+            return dlc;
+        }
+        return canfd ? kFdLengths[dlc - 9] : 8;
+    }
+
+    // Write frame as one record at out, which must have kMaxRecordSize
+    // bytes free. Returns the bytes written.
+    static int encode(const usb_rx_frame_t& frame, int bus, int64_t hostTimeNs, bool tx, uint8_t* out)
+    {
+        const usb_rx_frame_head_t& head = frame.head;
+        CaptureRecord record;
+        record.hostTimeNs = hostTimeNs;
+        record.deviceTime = head.time_stamp;
+        record.canId = head.can_id;
+        record.bus = static_cast<uint8_t>(bus);
+        record.flags = static_cast<uint8_t>((head.ext ? Ext : 0) | (head.rtr ? Rtr : 0) | (head.esi ? Esi : 0)
+                                            | (head.canfd ? CanFd : 0) | (head.brs ? Brs : 0)
+                                            | (tx ? Tx : 0) | (head.ack ? Ack : 0));
+        record.dlc = head.dlc;
+        record.length = static_cast<uint8_t>(head.rtr ? 0 : payloadLength(head.dlc, head.canfd));
+
+        std::memcpy(out, &record, sizeof(record));
+        std::memcpy(out + sizeof(record), frame.payload, record.length);
+        return static_cast<int>(sizeof(record)) + record.length;
+    }
+
+    // Rebuild the SDK frame of a record; payload holds record.length bytes
+    static void decode(const CaptureRecord& record, const uint8_t* payload, usb_rx_frame_t& frame)
+    {
+        std::memset(&frame, 0, sizeof(frame));
+        usb_rx_frame_head_t& head = frame.head;
+        head.can_id = record.canId & 0x1FFFFFFF;
+        head.ext = (record.flags & Ext) ? 1 : 0;
+        head.rtr = (record.flags & Rtr) ? 1 : 0;
+        head.esi = (record.flags & Esi) ? 1 : 0;
+        head.time_stamp = record.deviceTime;
+        head.channel = static_cast<uint8_t>(record.bus % 2);
+        head.canfd = (record.flags & CanFd) ? 1 : 0;
+        head.dir = (record.flags & Tx) ? 1 : 0;
+        head.brs = (record.flags & Brs) ? 1 : 0;
+        head.ack = (record.flags & Ack) ? 1 : 0;
+        head.dlc = record.dlc & 0xF;
+        std::memcpy(frame.payload, payload, record.length < 64 ? record.length : 64);
+    }
+
+    // Whether a record's length agrees with its flags and DLC. Anything else
+    // is not a record, e.g. the torn index footer of an interrupted close.
+    static bool isConsistent(const CaptureRecord& record)
+    {
+        const bool rtr = (record.flags & Rtr) != 0;
+        return record.flags < 0x80 && record.dlc <= 0xF
+               && record.length == (rtr ? 0 : payloadLength(record.dlc, (record.flags & CanFd) != 0));
+    }
+
+    // Whether data starts with a header this build can read
+    static bool isValid(const CaptureFileHeader& header)
+    {
+        return std::memcmp(header.magic, kMagic, sizeof(kMagic)) == 0 && header.version >= 1
+               && header.version <= kVersion && header.recordSize == sizeof(CaptureRecord);
+    }
+
+    static bool isValid(const CaptureTrailer& trailer)
+    {
+        return std::memcmp(trailer.magic, kIndexMagic, sizeof(kIndexMagic)) == 0;
+    }
+};
+
+static_assert(sizeof(CaptureFileHeader) == 16, "CaptureFileHeader layout is part of the file format");
+static_assert(sizeof(CaptureRecord) == 24, "CaptureRecord layout is part of the file format");
+static_assert(sizeof(CaptureBlockEntry) == 40, "CaptureBlockEntry layout is part of the file format");
+static_assert(sizeof(CaptureIdSummary) == 24, "CaptureIdSummary layout is part of the file format");
+static_assert(sizeof(CaptureTrailer) == 40, "CaptureTrailer layout is part of the file format");
+
+#endif // CAPTURE_FORMAT_H
@@ -0,0 +1,110 @@
+#include "capture_index.h"
+
+#include <algorithm>
+
+void CaptureIndexBuilder::addBlock(uint64_t offset, const uint8_t* data, size_t size)
+{
+    CaptureBlockEntry entry = {};
+    entry.offset = offset;
+    entry.firstTimeNs = std::numeric_limits<int64_t>::max();
+    entry.lastTimeNs = std::numeric_limits<int64_t>::min();
+    entry.firstSummary = static_cast<uint32_t>(m_summaries.size());
+
+    m_slots.clear();
+    size_t pos = 0;
+    while (size - pos >= sizeof(CaptureRecord)) {
+        CaptureRecord record;
+        std::memcpy(&record, data + pos, sizeof(record));
+        if (size - pos < sizeof(record) + record.length) {
+            break;
+        }
+        if (entry.frames == 0) {
+            entry.bus = record.bus;
+            entry.flags = record.flags & CaptureFormat::Tx;
+        }
+        ++entry.frames;
+        entry.firstTimeNs = std::min(entry.firstTimeNs, record.hostTimeNs);
+        entry.lastTimeNs = std::max(entry.lastTimeNs, record.hostTimeNs);
+
+        auto slot = m_slots.find(record.canId);
+        if (slot == m_slots.end()) {
+            slot = m_slots.emplace(record.canId, static_cast<uint32_t>(m_summaries.size())).first;
+            m_summaries.push_back(CaptureIdSummary{record.canId, 0, record.hostTimeNs, record.hostTimeNs});
+        }
+        CaptureIdSummary& summary = m_summaries[slot->second];
+        ++summary.frames;
+        summary.firstTimeNs = std::min(summary.firstTimeNs, record.hostTimeNs);
+        summary.lastTimeNs = std::max(summary.lastTimeNs, record.hostTimeNs);
+
+        pos += sizeof(record) + record.length;
+    }
+    if (entry.frames == 0) {
+        return;
+    }
+
+    entry.size = static_cast<uint32_t>(pos);
+    entry.summaryCount = static_cast<uint16_t>(m_summaries.size() - entry.firstSummary);
+    m_firstTimeNs = std::min(m_firstTimeNs, entry.firstTimeNs);
+    m_lastTimeNs = std::max(m_lastTimeNs, entry.lastTimeNs);
+    m_blocks.push_back(entry);
+}
+
+void CaptureIndexBuilder::append(const CaptureIndexBuilder& other, uint64_t offset)
+{
+    const uint32_t firstSummary = static_cast<uint32_t>(m_summaries.size());
+    for (CaptureBlockEntry block : other.m_blocks) {
+        block.offset += offset;
+        block.firstSummary += firstSummary;
+        m_blocks.push_back(block);
+    }
+    m_summaries.insert(m_summaries.end(), other.m_summaries.begin(), other.m_summaries.end());
+    if (!other.m_blocks.empty()) {
+        m_firstTimeNs = std::min(m_firstTimeNs, other.m_firstTimeNs);
+        m_lastTimeNs = std::max(m_lastTimeNs, other.m_lastTimeNs);
+    }
+}
+
+void CaptureIndexBuilder::clear()
+{
+    m_blocks.clear();
+    m_summaries.clear();
+    m_firstTimeNs = std::numeric_limits<int64_t>::max();
+    m_lastTimeNs = std::numeric_limits<int64_t>::min();
+}
+
+CaptureTrailer CaptureIndexBuilder::trailer(uint64_t indexOffset) const
+{
+    CaptureTrailer trailer;
+    trailer.indexOffset = indexOffset;
+    trailer.blockCount = static_cast<uint32_t>(m_blocks.size());
+    trailer.summaryCount = static_cast<uint32_t>(m_summaries.size());
+    trailer.firstTimeNs = firstTimeNs();
+    trailer.lastTimeNs = lastTimeNs();
+    std::memcpy(trailer.magic, CaptureFormat::kIndexMagic, sizeof(trailer.magic));
+    return trailer;
+}
+
+std::vector<uint8_t> CaptureIndexBuilder::footer(uint64_t recordsEnd) const
+{
+    // The end marker stops a scan before a footer torn by a crash; the
+    // padding keeps the footer aligned in a mapping of the file
+    const size_t leadBytes = sizeof(CaptureRecord) + (8 - recordsEnd % 8) % 8;
+    const size_t blockBytes = m_blocks.size() * sizeof(CaptureBlockEntry);
+    const size_t summaryBytes = m_summaries.size() * sizeof(CaptureIdSummary);
+    const CaptureTrailer trailer = this->trailer(recordsEnd + leadBytes);
+
+    std::vector<uint8_t> footer(leadBytes + blockBytes + summaryBytes + sizeof(trailer), 0);
+    uint8_t* p = footer.data();
+    std::memset(p, 0xFF, sizeof(CaptureRecord));
+    p += leadBytes;
+    if (blockBytes > 0) {
+        std::memcpy(p, m_blocks.data(), blockBytes);
+        p += blockBytes;
+    }
+    if (summaryBytes > 0) {
+        std::memcpy(p, m_summaries.data(), summaryBytes);
+        p += summaryBytes;
+    }
+    std::memcpy(p, &trailer, sizeof(trailer));
+    return footer;
+}
@@ -0,0 +1,47 @@
+#ifndef CAPTURE_INDEX_H
+#define CAPTURE_INDEX_H
+
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <unordered_map>
+#include <vector>
+
+#include "capture_format.h"
+
+// Builds the index footer of a capture (see capture_format.h) one block at
+// a time. The recorder's writer thread feeds every block it writes; a
+// reader feeds runs of records when a file has no footer; the log importer
+// indexes each chunk on its own and appends the chunks' indexes in order.
+class CaptureIndexBuilder
+{
+public:
+    // Index the records in data, which start at offset in the file. They
+    // must share one bus and direction, as the records of a block do.
+    void addBlock(uint64_t offset, const uint8_t* data, size_t size);
+
+    // Add other's blocks, whose offsets are relative to offset
+    void append(const CaptureIndexBuilder& other, uint64_t offset);
+    void clear();
+
+    const std::vector<CaptureBlockEntry>& blocks() const { return m_blocks; }
+    const std::vector<CaptureIdSummary>& summaries() const { return m_summaries; }
+    int64_t firstTimeNs() const { return m_blocks.empty() ? 0 : m_firstTimeNs; }
+    int64_t lastTimeNs() const { return m_blocks.empty() ? 0 : m_lastTimeNs; }
+
+    // Trailer of a footer whose block entries start at indexOffset
+    CaptureTrailer trailer(uint64_t indexOffset) const;
+
+    // Everything that follows the last record, which ends at recordsEnd:
+    // end marker, padding, block entries, summaries and trailer
+    std::vector<uint8_t> footer(uint64_t recordsEnd) const;
+
+private:
+    std::vector<CaptureBlockEntry> m_blocks;
+    std::vector<CaptureIdSummary> m_summaries;
+    std::unordered_map<uint32_t, uint32_t> m_slots;   // CAN ID -> summary, reused per block
+    int64_t m_firstTimeNs = std::numeric_limits<int64_t>::max();
+    int64_t m_lastTimeNs = std::numeric_limits<int64_t>::min();
+};
+
+#endif // CAPTURE_INDEX_H
@@ -0,0 +1,157 @@
+#include "channel_worker.h"
+
+#include <vector>
+
+namespace {
+constexpr size_t kFrameRingCapacity = 8192;
+constexpr size_t kDecodeBatch = 256;
+constexpr int kIdleSpins = 64;            // Yields before blocking, for bursts
+}
+
+ChannelWorker::ChannelWorker(int bus,
+                             const SnapshotCell<ProfileSnapshot>& profile,
+                             std::function<void()> notify)
+    : m_bus(bus)
+    , m_profile(profile)
+    , m_notify(std::move(notify))
+    , m_frames(kFrameRingCapacity)
+{
+}
+
+ChannelWorker::~ChannelWorker()
+{
+    stop();
+}
+
+void ChannelWorker::start()
+{
+    if (m_running.exchange(true)) {
+        return;
+    }
+    m_thread = std::thread(&ChannelWorker::run, this);
+}
+
+void ChannelWorker::stop()
+{
+    if (!m_running.exchange(false)) {
+        return;
+    }
+    {
+        std::lock_guard<std::mutex> lock(m_wakeMutex);
+    }
+    m_wake.notify_one();
+    if (m_thread.joinable()) {
+        m_thread.join();
+    }
+}
+
+void ChannelWorker::submit(const usb_rx_frame_t& frame, int64_t hostTimeNs)
+{
+    m_framesReceived.fetch_add(1, std::memory_order_relaxed);
+
+    RxFrame rx;
+    rx.hostTimeNs = hostTimeNs;
+    rx.frame = frame;
+    if (!m_frames.tryPush(rx)) {
+        m_framesDropped.fetch_add(1, std::memory_order_relaxed);
+        return;
+    }
+    wake();
+}
+
+bool ChannelWorker::offer(const usb_rx_frame_t& frame, int64_t hostTimeNs)
+{
+    // Each queued frame may become a sample, and so may each frame of the
+    // batch being decoded, which is in neither queue
+    if (m_frames.size() + kDecodeBatch + m_samples.depth() >= m_samples.capacity()) {
+        return false;
+    }
+    RxFrame rx;
+    rx.hostTimeNs = hostTimeNs;
+    rx.frame = frame;
+    if (!m_frames.tryPush(rx)) {
+        return false;
+    }
+    m_framesReceived.fetch_add(1, std::memory_order_relaxed);
+    wake();
+    return true;
+}
+
+void ChannelWorker::wake()
+{
+    // Pairs with the fence in run(): either the worker sees the frame just
+    // pushed before it waits, or this sees it sleeping
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    if (!m_sleeping.load(std::memory_order_relaxed)) {
+        return;
+    }
+    // Taking the mutex orders this after a worker between its check and its wait
+    {
+        std::lock_guard<std::mutex> lock(m_wakeMutex);
+    }
+    m_wake.notify_one();
+}
+
+void ChannelWorker::run()
+{
+    std::vector<RxFrame> batch(kDecodeBatch);
+    int idle = 0;
+
+    while (m_running.load(std::memory_order_acquire)) {
+        size_t count = m_frames.popBatch(batch.data(), batch.size());
+        if (count == 0) {
+            if (++idle < kIdleSpins) {
+                std::this_thread::yield();
+                continue;
+            }
+            m_sleeping.store(true, std::memory_order_relaxed);
+            std::atomic_thread_fence(std::memory_order_seq_cst);
+            {
+                std::unique_lock<std::mutex> lock(m_wakeMutex);
+                m_wake.wait(lock, [this]() {
+                    return !m_frames.isEmpty() || !m_running.load(std::memory_order_acquire);
+                });
+            }
+            m_sleeping.store(false, std::memory_order_relaxed);
+            idle = 0;
+            continue;
+        }
+        idle = 0;
+
+        // One pin per batch; a profile swap applies from the next batch
+        auto snapshot = m_profile.pin();
+        const CanDispatchTable& dispatch = snapshot->dispatchFor(m_bus);
+
+        bool decoded = false;
+        for (size_t i = 0; i < count; ++i) {
+            const usb_rx_frame_t& frame = batch[i].frame;
+
+            // Every frame feeds the clock estimate, matched or not
+            const uint64_t deviceTime = frame.head.time_stamp;
+            const int64_t timestamp = deviceTime != 0
+                                          ? m_clock.map(deviceTime, batch[i].hostTimeNs)
+                                          : batch[i].hostTimeNs;
+
+            int motorIndex = dispatch.lookup(frame.head.can_id);
+            if (motorIndex < 0) {
+                continue;
+            }
+
+            MotorSample sample;
+            sample.motorIndex = motorIndex;
+            sample.bus = m_bus;
+            sample.timestampNs = timestamp;
+            sample.deviceTimestamp = deviceTime;
+            snapshot->decodePlan.decode(motorIndex, frame.payload, sample.measure);
+            m_samples.push(sample);
+            decoded = true;
+        }
+
+        m_driftPpm.store(m_clock.driftPpm(), std::memory_order_relaxed);
+        m_clockOnHostTime.store(m_clock.onHostTime(), std::memory_order_relaxed);
+
+        if (decoded && m_notify) {
+            m_notify();
+        }
+    }
+}
@@ -0,0 +1,93 @@
+#ifndef CHANNEL_WORKER_H
+#define CHANNEL_WORKER_H
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <thread>
+
+#include "pub_user.h"
+#include "clock_sync.h"
+#include "profile_snapshot.h"
+#include "sample_queue.h"
+#include "snapshot_cell.h"
+#include "spsc_ring.h"
+
+// Raw frame as captured on the SDK callback thread
+struct RxFrame
+{
+    int64_t hostTimeNs = 0;      // Host monotonic time at callback entry
+    usb_rx_frame_t frame;
+};
+
+// Decodes one bus on its own thread.
+// SDK callback -> raw frame ring -> worker (dispatch + decode) -> SampleQueue
+// An idle worker sleeps on a condition variable; the producer only signals
+// it when it is asleep, so a busy bus costs no wakeups.
+class ChannelWorker
+{
+public:
+    // notify is invoked on the worker thread after each decoded batch
+    ChannelWorker(int bus,
+                  const SnapshotCell<ProfileSnapshot>& profile,
+                  std::function<void()> notify);
+    ~ChannelWorker();
+
+    ChannelWorker(const ChannelWorker&) = delete;
+    ChannelWorker& operator=(const ChannelWorker&) = delete;
+
+    int bus() const { return m_bus; }
+
+    void start();
+    void stop();
+
+    // Producer side (single SDK callback thread); never waits for the
+    // worker beyond the moment it takes to wake it
+    void submit(const usb_rx_frame_t& frame, int64_t hostTimeNs);
+
+    // Replay producer: like submit(), but returns false instead of dropping
+    // while the frames not yet decoded might overflow the sample queue, so
+    // the caller can wait
+    bool offer(const usb_rx_frame_t& frame, int64_t hostTimeNs);
+
+    // Consumer side: decoded samples of this bus, oldest first
+    SampleQueue& samples() { return m_samples; }
+    const SampleQueue& samples() const { return m_samples; }
+
+    uint64_t framesReceived() const { return m_framesReceived.load(std::memory_order_relaxed); }
+    uint64_t framesDropped() const { return m_framesDropped.load(std::memory_order_relaxed); }
+    size_t framesPending() const { return m_frames.size(); }
+
+    // Adapter clock drift relative to the host, as last estimated
+    double clockDriftPpm() const { return m_driftPpm.load(std::memory_order_relaxed); }
+    // Whether the adapter clock fit was rejected and samples carry host time
+    bool clockOnHostTime() const { return m_clockOnHostTime.load(std::memory_order_relaxed); }
+
+private:
+    void run();
+    void wake();
+
+    const int m_bus;
+    const SnapshotCell<ProfileSnapshot>& m_profile;
+    std::function<void()> m_notify;
+
+    SpscRing<RxFrame> m_frames;
+    SampleQueue m_samples;
+    ClockSync m_clock;          // Worker thread only
+
+    std::atomic<bool> m_running{false};
+    std::thread m_thread;
+
+    std::mutex m_wakeMutex;
+    std::condition_variable m_wake;
+    std::atomic<bool> m_sleeping{false};    // Worker waits or is about to
+
+    std::atomic<uint64_t> m_framesReceived{0};
+    std::atomic<uint64_t> m_framesDropped{0};
+    std::atomic<double> m_driftPpm{0.0};
+    std::atomic<bool> m_clockOnHostTime{false};
+};
+
+#endif // CHANNEL_WORKER_H
@@ -0,0 +1,115 @@
+#include "clock_sync.h"
+
+#include <algorithm>
+#include <cmath>
+
+ClockSync::ClockSync(double ticksPerSecond)
+    : m_nsPerTick(1e9 / ticksPerSecond)
+{
+}
+
+void ClockSync::reset()
+{
+    m_valid = false;
+    m_rejected = false;
+    m_windowHasPoint = false;
+    m_pointCount = 0;
+    m_pointNext = 0;
+    m_intercept = 0.0;
+    m_slope = 0.0;
+}
+
+int64_t ClockSync::map(uint64_t deviceTicks, int64_t hostNs)
+{
+    // Counter reset or a device restart: start over
+    if (m_valid && deviceTicks < m_lastTicks) {
+        reset();
+    }
+
+    if (!m_valid) {
+        m_valid = true;
+        m_originTicks = deviceTicks;
+        m_originHost = hostNs;
+        m_windowStart = 0.0;
+    }
+    m_lastTicks = deviceTicks;
+
+    const double x = static_cast<double>(deviceTicks - m_originTicks) * m_nsPerTick;
+    const double y = static_cast<double>(hostNs - m_originHost) - x;
+
+    if (!m_windowHasPoint || y < m_windowMinY) {
+        m_windowMinX = x;
+        m_windowMinY = y;
+        m_windowHasPoint = true;
+    }
+    if (x - m_windowStart >= kWindowNs) {
+        closeWindow();
+        m_windowStart = x;
+    }
+
+    // Host time until the first window closes: a running minimum would
+    // step back with every frame that arrives quicker than the ones before
+    int64_t mapped = hostNs;
+    if (!m_rejected && m_pointCount > 0) {
+        // Latency can't be negative: follow the envelope if it dips below
+        const double offset = std::min(m_intercept + m_slope * x, y);
+        mapped = m_originHost + static_cast<int64_t>(std::llround(x + offset));
+    }
+
+    // A refit, or a switch to or from host time, may step the mapping back.
+    // Hold time until the new mapping catches up instead.
+    m_lastMapped = std::max(m_lastMapped, mapped);
+    return m_lastMapped;
+}
+
+void ClockSync::closeWindow()
+{
+    m_pointsX[m_pointNext] = m_windowMinX;
+    m_pointsY[m_pointNext] = m_windowMinY;
+    m_pointNext = (m_pointNext + 1) % kMaxWindows;
+    m_pointCount = std::min(m_pointCount + 1, kMaxWindows);
+    m_windowHasPoint = false;
+    refit();
+}
+
+void ClockSync::refit()
+{
+    if (m_pointCount < 2) {
+        m_intercept = m_pointsY[0];
+        m_slope = 0.0;
+        return;
+    }
+
+    double meanX = 0.0;
+    double meanY = 0.0;
+    for (int i = 0; i < m_pointCount; ++i) {
+        meanX += m_pointsX[i];
+        meanY += m_pointsY[i];
+    }
+    meanX /= m_pointCount;
+    meanY /= m_pointCount;
+
+    double sxx = 0.0;
+    double sxy = 0.0;
+    for (int i = 0; i < m_pointCount; ++i) {
+        const double dx = m_pointsX[i] - meanX;
+        sxx += dx * dx;
+        sxy += dx * (m_pointsY[i] - meanY);
+    }
+
+    const double slope = (sxx > 0.0) ? sxy / sxx : 0.0;
+    m_rejected = std::fabs(slope) * 1e6 > kMaxDriftPpm;
+    if (m_rejected) {
+        // Keep the last good line; the window ring refits as it rolls over
+        return;
+    }
+
+    // Shift the line down onto the lowest minimum so latency stays >= 0
+    double intercept = meanY - slope * meanX;
+    for (int i = 0; i < m_pointCount; ++i) {
+        intercept = std::min(intercept, m_pointsY[i] - slope * m_pointsX[i]);
+    }
+
+    m_slope = slope;
+    m_intercept = intercept;
+}
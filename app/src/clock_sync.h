@@ -0,0 +1,73 @@
+#ifndef CLOCK_SYNC_H
+#define CLOCK_SYNC_H
+
+#include <cstdint>
+
+// Maps adapter RX timestamps onto the host monotonic clock.
+// Host receive time = device time + offset + latency, with latency >= 0,
+// so the lower envelope of (host - device) tracks the true offset. The
+// minimum of each window is kept and a line fitted through the recent
+// minima gives offset and drift. A fit implying more drift than any crystal
+// has (kMaxDriftPpm) is rejected: usually the tick rate is wrong or the
+// adapter clock jumped, and map() returns host time until the fit recovers.
+// Before the first window closes map() returns host time as well. Mapped
+// times never decrease, across refits and counter resets alike.
+// Not thread-safe; one instance per worker.
+class ClockSync
+{
+public:
+    // Tick rate of usb_rx_frame_head_t::time_stamp. The SDK does not
+    // document it; 1 MHz matches the adapters seen so far, and any other
+    // rate shows up as a rejected fit rather than bent timestamps.
+    static constexpr double kDefaultTicksPerSecond = 1e6;
+
+    static constexpr double kMaxDriftPpm = 1000.0;
+
+    explicit ClockSync(double ticksPerSecond = kDefaultTicksPerSecond);
+
+    // Record an observation and return the device time mapped to host ns,
+    // never earlier than the previous result
+    int64_t map(uint64_t deviceTicks, int64_t hostNs);
+
+    void reset();
+
+    bool isValid() const { return m_valid; }
+    // Whether the last fit was rejected and map() returns host time
+    bool onHostTime() const { return m_rejected; }
+    double driftPpm() const { return m_slope * 1e6; }
+    double offsetNs() const { return m_intercept; }
+
+private:
+    static constexpr int kMaxWindows = 16;
+    static constexpr double kWindowNs = 500e6;
+
+    void closeWindow();
+    void refit();
+
+    double m_nsPerTick;
+    bool m_valid = false;
+    bool m_rejected = false;
+
+    uint64_t m_originTicks = 0;
+    uint64_t m_lastTicks = 0;
+    int64_t m_originHost = 0;
+    int64_t m_lastMapped = INT64_MIN;   // Kept by reset()
+
+    // Current window lower envelope
+    double m_windowStart = 0.0;
+    double m_windowMinX = 0.0;
+    double m_windowMinY = 0.0;
+    bool m_windowHasPoint = false;
+
+    // Minima of closed windows (ring)
+    double m_pointsX[kMaxWindows] = {};
+    double m_pointsY[kMaxWindows] = {};
+    int m_pointCount = 0;
+    int m_pointNext = 0;
+
+    // offset(x) = m_intercept + m_slope * x, x = device elapsed ns
+    double m_intercept = 0.0;
+    double m_slope = 0.0;
+};
+
+#endif // CLOCK_SYNC_H
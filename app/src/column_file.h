@@ -0,0 +1,93 @@
+#ifndef COLUMN_FILE_H
+#define COLUMN_FILE_H
+
+#include <cstdint>
+
+// Self-describing columnar export (.dmcol), written by DataExporter:
+//   ColumnFileHeader
+//   per column: ColumnFileColumn, then nameBytes of UTF-8 name
+//   row groups, each: uint32 rows, then per column a ColumnFileBlock and
+//     its storedBytes of data
+//   uint64 file offset of each row group
+//   ColumnFileTrailer, the last bytes of the file
+// Column data is the rows' values back to back in host order (every
+// supported target is little-endian). A Bytes column holds one uint32 end
+// offset per row followed by the concatenated values. Data is stored as
+// qCompress() output (zlib with a 4-byte size prefix) when that is smaller
+// than the raw data; storedBytes == rawBytes means it is stored raw.
+enum class ColumnType : uint8_t {
+    Int64 = 1,
+    UInt64,
+    UInt32,
+    UInt8,
+    Float64,
+    Float32,                 // NaN where a value is missing
+    Bytes
+};
+
+struct ColumnFileHeader
+{
+    char magic[8];
+    uint32_t version;
+    uint32_t columnCount;
+};
+
+struct ColumnFileColumn
+{
+    uint8_t type;            // ColumnType
+    uint8_t flags;           // ColumnFile::Hex: integers read best in hex
+    uint16_t nameBytes;
+};
+
+struct ColumnFileBlock
+{
+    uint32_t storedBytes;
+    uint32_t rawBytes;
+};
+
+struct ColumnFileTrailer
+{
+    uint64_t rows;
+    uint64_t groupIndexOffset;   // First row group offset
+    uint32_t groupCount;
+    uint32_t reserved;
+    char magic[8];
+};
+
+class ColumnFile
+{
+public:
+    static constexpr char kMagic[8] = {'D', 'M', 'C', 'O', 'L', 'S', '0', '1'};
+    static constexpr char kTrailerMagic[8] = {'D', 'M', 'C', 'O', 'L', 'E', 'N', 'D'};
+    static constexpr uint32_t kVersion = 1;
+
+    enum Flag : uint8_t {
+        Hex = 0x01
+    };
+
+    // Bytes per value of a fixed-width type, 0 for Bytes
+    static int valueSize(ColumnType type)
+    {
+        switch (type) {
+        case ColumnType::Int64:
+        case ColumnType::UInt64:
+        case ColumnType::Float64:
+            return 8;
+        case ColumnType::UInt32:
+        case ColumnType::Float32:
+            return 4;
+        case ColumnType::UInt8:
+            return 1;
+        case ColumnType::Bytes:
+            break;
+        }
+        return 0;
+    }
+};
+
+static_assert(sizeof(ColumnFileHeader) == 16, "ColumnFileHeader layout is part of the file format");
+static_assert(sizeof(ColumnFileColumn) == 4, "ColumnFileColumn layout is part of the file format");
+static_assert(sizeof(ColumnFileBlock) == 8, "ColumnFileBlock layout is part of the file format");
+static_assert(sizeof(ColumnFileTrailer) == 32, "ColumnFileTrailer layout is part of the file format");
+
+#endif // COLUMN_FILE_H
@@ -0,0 +1,153 @@
+#ifndef COLUMN_RING_H
+#define COLUMN_RING_H
+
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+// Fixed-capacity ring holding one column of samples, addressed by absolute
+// sample sequence (0, 1, 2, ... for the lifetime of the ring). Storage is
+// split into fixed-size segments that are allocated once and then recycled,
+// so appending never allocates after the first lap.
+//
+// Copies share segments. A write to a shared segment copies it first (or,
+// when the write starts the segment over, replaces it), so a copy is a
+// frozen view that costs one segment per lap of writes while it lives.
+// Copies may only be made while no thread is writing to the original, but
+// may be read and released on any thread while it is written.
+template <typename T>
+class ColumnRing
+{
+public:
+    static constexpr int kMinSegmentShift = 6;
+    static constexpr int kMaxSegmentShift = 12;
+
+    // Drop all storage and size the ring for capacity live samples
+    void reset(int64_t capacity)
+    {
+        // Segments of roughly a quarter of the capacity, within bounds
+        m_shift = kMinSegmentShift;
+        while (m_shift < kMaxSegmentShift && (int64_t(4) << m_shift) < capacity) {
+            ++m_shift;
+        }
+        // One spare segment: the live window may straddle capacity / segment + 1
+        const int64_t size = segmentSize();
+        const int64_t segments = (capacity + size - 1) / size + 1;
+        m_segments.assign(static_cast<size_t>(segments), Segment());
+    }
+
+    bool isEmpty() const { return m_segments.empty(); }
+    int64_t segmentSize() const { return int64_t(1) << m_shift; }
+
+    void write(int64_t seq, T value)
+    {
+        const size_t offset = static_cast<size_t>(seq & (segmentSize() - 1));
+        Segment& segment = m_segments[segmentIndex(seq)];
+        if (!segment || (offset == 0 && segment.isShared())) {
+            // Appends fill a segment in order, so the rest of it is a past lap
+            segment = Segment(segmentSize(), nullptr);
+        } else if (segment.isShared()) {
+            segment = Segment(segmentSize(), segment.get());
+        }
+        segment.get()[offset] = value;
+    }
+
+    T read(int64_t seq) const
+    {
+        const Segment& segment = m_segments[segmentIndex(seq)];
+        return segment ? segment.get()[static_cast<size_t>(seq & (segmentSize() - 1))] : T();
+    }
+
+    // Writable slot; allocates or unshares the segment if needed
+    T& at(int64_t seq)
+    {
+        Segment& segment = m_segments[segmentIndex(seq)];
+        if (!segment) {
+            segment = Segment(segmentSize(), nullptr);
+        } else if (segment.isShared()) {
+            segment = Segment(segmentSize(), segment.get());
+        }
+        return segment.get()[static_cast<size_t>(seq & (segmentSize() - 1))];
+    }
+
+    // Contiguous run starting at seq, at most maxCount long. Returns nullptr
+    // (with count still set) where no value was ever written.
+    const T* span(int64_t seq, int64_t maxCount, int64_t& count) const
+    {
+        const int64_t offset = seq & (segmentSize() - 1);
+        count = std::min(maxCount, segmentSize() - offset);
+        const Segment& segment = m_segments[segmentIndex(seq)];
+        return segment ? segment.get() + offset : nullptr;
+    }
+
+private:
+    // Reference-counted block of segmentSize() values. Unlike
+    // shared_ptr::use_count(), isShared() is an acquire load: once it sees
+    // the other copies gone, their reads of the block happened before any
+    // write that follows. A count read while a copy is being released may
+    // be stale high, which only costs a needless copy; it cannot rise here,
+    // see above.
+    class Segment
+    {
+    public:
+        Segment() = default;
+
+        // Zeroed, or a copy of source
+        Segment(int64_t size, const T* source) : m_block(new Block)
+        {
+            if (source) {
+                m_block->values.reset(new T[static_cast<size_t>(size)]);
+                std::copy(source, source + size, m_block->values.get());
+            } else {
+                m_block->values.reset(new T[static_cast<size_t>(size)]());
+            }
+        }
+
+        Segment(const Segment& other) : m_block(other.m_block)
+        {
+            if (m_block) {
+                m_block->refs.fetch_add(1, std::memory_order_relaxed);
+            }
+        }
+
+        Segment(Segment&& other) noexcept : m_block(other.m_block) { other.m_block = nullptr; }
+
+        Segment& operator=(Segment other) noexcept
+        {
+            std::swap(m_block, other.m_block);
+            return *this;
+        }
+
+        ~Segment()
+        {
+            if (m_block && m_block->refs.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+                delete m_block;
+            }
+        }
+
+        explicit operator bool() const { return m_block != nullptr; }
+        bool isShared() const { return m_block->refs.load(std::memory_order_acquire) > 1; }
+        T* get() const { return m_block->values.get(); }
+
+    private:
+        struct Block
+        {
+            std::atomic<int> refs{1};
+            std::unique_ptr<T[]> values;
+        };
+
+        Block* m_block = nullptr;
+    };
+
+    size_t segmentIndex(int64_t seq) const
+    {
+        return static_cast<size_t>((seq >> m_shift) % static_cast<int64_t>(m_segments.size()));
+    }
+
+    int m_shift = kMinSegmentShift;
+    std::vector<Segment> m_segments;
+};
+
+#endif // COLUMN_RING_H
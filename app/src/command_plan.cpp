@@ -0,0 +1,139 @@
+#include "command_plan.h"
+#include "bit_extractor.h"
+
+#include <algorithm>
+#include <cstring>
+
+namespace {
+// CAN-FD payload lengths for DLC 9-15
+constexpr int kFdLengths[] = {12, 16, 20, 24, 32, 48, 64};
+}
+
+int CommandPlan::groupForCanId(uint32_t canId) const
+{
+    for (size_t i = 0; i < m_groups.size(); ++i) {
+        if (m_groups[i].head.can_id == canId) {
+            return static_cast<int>(i);
+        }
+    }
+    return -1;
+}
+
+int CommandPlan::fdLength(int length)
+{
+    if (length <= 8) {
+        return std::max(length, 0);
+    }
+    for (int fd : kFdLengths) {
+        if (length <= fd) {
+            return fd;
+        }
+    }
+    return BitExtractor::kMaxPayloadSize;
+}
+
+int CommandPlan::valueCount(const MotorCommandGroup& group)
+{
+    int count = 0;
+    if (!group.fields.isEmpty()) {
+        for (const CommandField& field : group.fields) {
+            count = std::max(count, field.valueIndex + 1);
+        }
+    } else {
+        // Legacy layout: consecutive 16-bit values, one per motor
+        const int length = group.canfd ? fdLength(group.payloadLength) : std::clamp(group.payloadLength, 0, 8);
+        count = std::min(group.motorIndices.isEmpty() ? 4 : static_cast<int>(group.motorIndices.size()), length / 2);
+    }
+    return std::clamp(count, 0, kMaxCommandValues);
+}
+
+uint8_t CommandPlan::dlcForLength(int length)
+{
+    length = fdLength(length);
+    if (length <= 8) {
+        return static_cast<uint8_t>(length);
+    }
+    uint8_t dlc = 9;
+    for (int fd : kFdLengths) {
+        if (length == fd) {
+            break;
+        }
+        ++dlc;
+    }
+    return dlc;
+}
+
+CommandPlan CommandPlan::compile(const MotorProfile& profile)
+{
+    CommandPlan plan;
+    plan.m_groups.reserve(profile.commandGroups.size());
+
+    for (const MotorCommandGroup& group : profile.commandGroups) {
+        GroupPlan groupPlan;
+        std::memset(&groupPlan.head, 0, sizeof(groupPlan.head));
+        groupPlan.payloadLength = group.canfd ? fdLength(group.payloadLength)
+                                              : std::clamp(group.payloadLength, 0, 8);
+        groupPlan.head.can_id = group.canId & 0x1FFFFFFF;
+        groupPlan.head.ext = group.canId > 0x7FF ? 1 : 0;
+        groupPlan.head.canfd = group.canfd ? 1 : 0;
+        groupPlan.head.brs = (group.canfd && group.brs) ? 1 : 0;
+        groupPlan.head.dlc = dlcForLength(groupPlan.payloadLength) & 0xF;
+        groupPlan.head.send_times = 1;
+        groupPlan.first = static_cast<int>(plan.m_ops.size());
+
+        auto addOp = [&](const CommandField& field) {
+            CommandOp op;
+            op.valueIndex = static_cast<uint8_t>(field.valueIndex);
+            op.byteOffset = static_cast<uint8_t>(field.byteOffset);
+            op.bitStart = static_cast<uint8_t>(field.bits.start);
+            op.bitLength = static_cast<uint8_t>(field.bits.length);
+            op.littleEndian = field.littleEndian;
+            const ControlLimits& limits = field.hasLimits ? field.limits : profile.controlLimits;
+            op.min = limits.min;
+            op.max = std::max(limits.min, limits.max);
+            plan.m_ops.push_back(op);
+        };
+
+        if (!group.fields.isEmpty()) {
+            for (const CommandField& field : group.fields) {
+                addOp(field);
+            }
+        } else {
+            const int values = valueCount(group);
+            for (int i = 0; i < values; ++i) {
+                CommandField field;
+                field.valueIndex = i;
+                field.byteOffset = i * 2;
+                field.littleEndian = group.littleEndian;
+                addOp(field);
+            }
+        }
+
+        groupPlan.count = static_cast<int>(plan.m_ops.size()) - groupPlan.first;
+        plan.m_groups.push_back(groupPlan);
+    }
+
+    return plan;
+}
+
+bool CommandPlan::encode(int group, const int32_t* values, int count, usb_tx_frame_t& frame) const
+{
+    if (group < 0 || group >= groupCount()) {
+        return false;
+    }
+
+    const GroupPlan& groupPlan = m_groups[group];
+    frame.head = groupPlan.head;
+    std::memset(frame.payload, 0, sizeof(frame.payload));
+
+    const CommandOp* op = m_ops.data() + groupPlan.first;
+    const CommandOp* end = op + groupPlan.count;
+    for (; op != end; ++op) {
+        int32_t value = op->valueIndex < count ? values[op->valueIndex] : 0;
+        value = std::clamp(value, op->min, op->max);
+        BitExtractor::pack(frame.payload, op->byteOffset, op->bitStart, op->bitLength,
+                           op->littleEndian, value, groupPlan.payloadLength);
+    }
+
+    return true;
+}
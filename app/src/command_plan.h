@@ -0,0 +1,62 @@
+#ifndef COMMAND_PLAN_H
+#define COMMAND_PLAN_H
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "pub_user.h"
+#include "motor_profile.h"
+
+// Pre-resolved packing op for one value of one command group
+struct CommandOp
+{
+    uint8_t valueIndex = 0;  // Source index in the values array
+    uint8_t byteOffset = 0;
+    uint8_t bitStart = 0;
+    uint8_t bitLength = 16;
+    bool littleEndian = false;
+    int32_t min = 0;         // Clamp applied before packing
+    int32_t max = 0;
+};
+
+// Command encoders compiled once per active profile. Each group keeps a
+// ready-made frame header, so encoding is a header copy plus a few packs
+// straight into the caller's usb_tx_frame_t.
+class CommandPlan
+{
+public:
+    static CommandPlan compile(const MotorProfile& profile);
+
+    int groupCount() const { return static_cast<int>(m_groups.size()); }
+
+    // The group whose frames carry canId, or -1
+    int groupForCanId(uint32_t canId) const;
+
+    // Fill frame for a group; values past count encode as 0 and the whole
+    // payload past the group's length is zeroed.
+    // Returns false for an unknown group. Never allocates.
+    bool encode(int group, const int32_t* values, int count, usb_tx_frame_t& frame) const;
+
+    // Number of values a group's layout reads: the highest valueIndex + 1,
+    // or one per motor index for the legacy layout. At most kMaxCommandValues.
+    static int valueCount(const MotorCommandGroup& group);
+
+    // Smallest valid CAN-FD payload length >= length, and its DLC code
+    static int fdLength(int length);
+    static uint8_t dlcForLength(int length);
+
+private:
+    struct GroupPlan
+    {
+        usb_tx_frame_head_t head;
+        int payloadLength = 8;
+        int first = 0;
+        int count = 0;
+    };
+
+    std::vector<CommandOp> m_ops;
+    std::vector<GroupPlan> m_groups;
+};
+
+#endif // COMMAND_PLAN_H
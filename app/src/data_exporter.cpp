@@ -0,0 +1,482 @@
+#include "data_exporter.h"
+#include "capture_file.h"
+
+#include <QFile>
+#include <QThread>
+
+#include <algorithm>
+#include <charconv>
+#include <chrono>
+#include <cmath>
+#include <cstring>
+
+namespace {
+constexpr size_t kChunkBytes = 4 << 20;     // Capture records per chunk
+constexpr int kChunkRows = 65536;           // History rows per chunk
+constexpr int kCompressionLevel = 1;        // Favour speed: the disk is the limit
+constexpr int kMaxCsvField = 48;            // Longest formatted fixed-width value
+
+int64_t hostNowNs()
+{
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+template <typename T>
+T readValue(const std::vector<uint8_t>& column, uint32_t row)
+{
+    T value;
+    std::memcpy(&value, column.data() + size_t(row) * sizeof(T), sizeof(T));
+    return value;
+}
+
+template <typename T>
+char* formatInteger(char* p, T value, bool hex)
+{
+    if (hex) {
+        *p++ = '0';
+        *p++ = 'x';
+    }
+    return std::to_chars(p, p + kMaxCsvField, value, hex ? 16 : 10).ptr;
+}
+}
+
+DataExporter::DataExporter(std::function<void()> finished)
+    : m_finished(std::move(finished))
+{
+    // Leave a core to the receive path and keep below it in priority
+    m_pool.setMaxThreadCount(std::max(1, QThread::idealThreadCount() - 1));
+    m_pool.setThreadPriority(QThread::LowPriority);
+}
+
+DataExporter::~DataExporter()
+{
+    cancel();
+    if (m_thread.joinable()) {
+        m_thread.join();
+    }
+}
+
+DataExporter::Format DataExporter::formatFor(const QString& path)
+{
+    return path.endsWith(QStringLiteral(".csv"), Qt::CaseInsensitive) ? Format::Csv : Format::Columns;
+}
+
+bool DataExporter::exportCapture(const QString& capturePath, const QString& path, QString* error)
+{
+    if (isRunning()) {
+        if (error) {
+            *error = QStringLiteral("An export is already running");
+        }
+        return false;
+    }
+    // The index scan and the chunking read the whole file: leave them to the pool
+    struct Source
+    {
+        CaptureFile capture;
+        std::vector<CaptureBlockEntry> blocks;  // File order
+        std::vector<size_t> chunks;             // First block of each chunk, then the end
+        int64_t origin = 0;
+    };
+    auto source = std::make_shared<Source>();
+    if (!source->capture.open(capturePath, error)) {
+        return false;
+    }
+
+    auto counter = [source]() {
+        source->capture.scanIndex();
+        // Whole blocks in file order, so each chunk reads one stretch of the file
+        source->blocks = source->capture.blocks();
+        std::sort(source->blocks.begin(), source->blocks.end(),
+                  [](const CaptureBlockEntry& a, const CaptureBlockEntry& b) { return a.offset < b.offset; });
+        size_t bytes = kChunkBytes;
+        for (size_t i = 0; i < source->blocks.size(); ++i) {
+            if (bytes >= kChunkBytes) {
+                source->chunks.push_back(i);
+                bytes = 0;
+            }
+            bytes += source->blocks[i].size;
+        }
+        source->chunks.push_back(source->blocks.size());
+        source->origin = source->capture.firstTimeNs();
+        return static_cast<int>(source->chunks.size()) - 1;
+    };
+
+    std::vector<ColumnSpec> columns = {
+        {QStringLiteral("time_s"), ColumnType::Float64},
+        {QStringLiteral("device_time"), ColumnType::UInt64},
+        {QStringLiteral("bus"), ColumnType::UInt8},
+        {QStringLiteral("flags"), ColumnType::UInt8, true},
+        {QStringLiteral("can_id"), ColumnType::UInt32, true},
+        {QStringLiteral("dlc"), ColumnType::UInt8},
+        {QStringLiteral("data"), ColumnType::Bytes},
+    };
+
+    auto reader = [source](int index, ColumnChunk& chunk) {
+        const size_t begin = source->chunks[index];
+        const size_t end = source->chunks[index + 1];
+        for (size_t i = begin; i < end; ++i) {
+            source->capture.forEachRecord(source->blocks[i], [&](const CaptureRecord& record, const uint8_t* payload) {
+                chunk.append(0, static_cast<double>(record.hostTimeNs - source->origin) * 1e-9);
+                chunk.append(1, record.deviceTime);
+                chunk.append(2, record.bus);
+                chunk.append(3, record.flags);
+                chunk.append(4, record.canId);
+                chunk.append(5, record.dlc);
+                chunk.appendBytes(6, payload, record.length);
+                ++chunk.rows;
+            });
+        }
+    };
+    return start(path, std::move(columns), std::move(counter), std::move(reader), error);
+}
+
+bool DataExporter::exportHistory(TelemetryDataStore::SnapshotPtr snapshot, const QString& path,
+                                 QString* error)
+{
+    if (isRunning() || !snapshot) {
+        if (error) {
+            *error = snapshot ? QStringLiteral("An export is already running") : QStringLiteral("No history");
+        }
+        return false;
+    }
+
+    // Every field any motor holds, in the order the first motor holding it lists it
+    const QList<int> motors = snapshot->motors();
+    QStringList fieldIds;
+    for (int motor : motors) {
+        for (const QString& id : snapshot->fieldIds(motor)) {
+            if (!fieldIds.contains(id)) {
+                fieldIds.append(id);
+            }
+        }
+    }
+    std::vector<ColumnSpec> columns = {
+        {QStringLiteral("time_s"), ColumnType::Float64},
+        {QStringLiteral("motor"), ColumnType::UInt32},
+    };
+    for (const QString& id : fieldIds) {
+        columns.push_back({id, ColumnType::Float32});
+    }
+
+    struct Chunk
+    {
+        int motorIndex;
+        int first;
+        int count;
+    };
+    auto chunks = std::make_shared<std::vector<Chunk>>();
+    for (int motor : motors) {
+        const int rows = snapshot->sampleCount(motor);
+        for (int first = 0; first < rows; first += kChunkRows) {
+            chunks->push_back(Chunk{motor, first, std::min(kChunkRows, rows - first)});
+        }
+    }
+
+    auto reader = [snapshot, chunks, fieldIds](int index, ColumnChunk& chunk) {
+        const Chunk& part = (*chunks)[index];
+        QVector<double> times;
+        QVector<float> values;
+        const int rows = snapshot->readRows(part.motorIndex, fieldIds, part.first, part.count, times, values);
+        const int fields = static_cast<int>(fieldIds.size());
+        for (int row = 0; row < rows; ++row) {
+            chunk.append(0, times[row]);
+            chunk.append(1, static_cast<uint32_t>(part.motorIndex));
+            for (int field = 0; field < fields; ++field) {
+                chunk.append(2 + field, values[static_cast<qsizetype>(row) * fields + field]);
+            }
+        }
+        chunk.rows = static_cast<uint32_t>(rows);
+    };
+    const int chunkCount = static_cast<int>(chunks->size());
+    return start(path, std::move(columns), [chunkCount]() { return chunkCount; }, std::move(reader), error);
+}
+
+bool DataExporter::start(const QString& path, std::vector<ColumnSpec> columns, ChunkCounter counter,
+                         ChunkReader reader, QString* error)
+{
+    if (m_thread.joinable()) {
+        m_thread.join();
+    }
+    auto file = std::make_unique<QFile>(path);
+    if (!file->open(QIODevice::WriteOnly | QIODevice::Truncate)) {
+        if (error) {
+            *error = file->errorString();
+        }
+        return false;
+    }
+
+    m_file = std::move(file);
+    m_path = path;
+    m_format = formatFor(path);
+    m_columns = std::move(columns);
+    m_counter = std::move(counter);
+    m_reader = std::move(reader);
+    m_chunkCount.store(0, std::memory_order_relaxed);
+    m_window = 2 * std::max(1, m_pool.maxThreadCount());
+    m_slots.assign(m_window, Slot());
+    {
+        std::lock_guard<std::mutex> lock(m_errorMutex);
+        m_error.clear();
+    }
+
+    m_rows.store(0, std::memory_order_relaxed);
+    m_bytesWritten.store(0, std::memory_order_relaxed);
+    m_chunksWritten.store(0, std::memory_order_relaxed);
+    m_startNs.store(hostNowNs(), std::memory_order_relaxed);
+    m_endNs.store(0, std::memory_order_relaxed);
+    m_failed.store(false, std::memory_order_relaxed);
+    m_cancel.store(false, std::memory_order_relaxed);
+
+    m_running.store(true, std::memory_order_release);
+    m_thread = std::thread(&DataExporter::run, this);
+    return true;
+}
+
+void DataExporter::cancel()
+{
+    m_cancel.store(true, std::memory_order_relaxed);
+}
+
+QString DataExporter::errorString() const
+{
+    std::lock_guard<std::mutex> lock(m_errorMutex);
+    return m_error;
+}
+
+DataExporter::Stats DataExporter::stats() const
+{
+    Stats stats;
+    stats.rows = m_rows.load(std::memory_order_relaxed);
+    stats.bytesWritten = m_bytesWritten.load(std::memory_order_relaxed);
+    stats.chunksWritten = m_chunksWritten.load(std::memory_order_relaxed);
+    stats.chunkCount = m_chunkCount.load(std::memory_order_relaxed);
+    stats.failed = m_failed.load(std::memory_order_relaxed);
+    stats.cancelled = m_cancel.load(std::memory_order_relaxed);
+
+    const int64_t start = m_startNs.load(std::memory_order_relaxed);
+    const int64_t end = m_endNs.load(std::memory_order_relaxed);
+    stats.elapsedSeconds = start ? static_cast<double>((end ? end : hostNowNs()) - start) * 1e-9 : 0.0;
+    stats.bytesPerSecond = stats.elapsedSeconds > 0.0 ? stats.bytesWritten / stats.elapsedSeconds : 0.0;
+    return stats;
+}
+
+void DataExporter::run()
+{
+    bool ok = write(header());
+    std::vector<uint64_t> groupOffsets;
+
+    int chunkCount = 0;
+    m_pool.start([this, &chunkCount]() { chunkCount = m_counter(); });
+    m_pool.waitForDone();
+    m_chunkCount.store(chunkCount, std::memory_order_relaxed);
+
+    // Chunk i + window is only handed out once chunk i has been written,
+    // which bounds the memory held by formatted chunks
+    int submitted = 0;
+    for (int next = 0; ok && next < chunkCount && !m_cancel.load(std::memory_order_relaxed); ++next) {
+        while (submitted < chunkCount && submitted < next + m_window) {
+            submit(submitted++);
+        }
+
+        Slot& slot = m_slots[next % m_window];
+        QByteArray data;
+        uint32_t rows = 0;
+        {
+            std::unique_lock<std::mutex> lock(m_slotMutex);
+            m_slotReady.wait(lock, [&slot]() { return slot.ready; });
+            data.swap(slot.data);
+            rows = slot.rows;
+            slot.ready = false;
+        }
+        if (m_cancel.load(std::memory_order_relaxed)) {
+            break;
+        }
+
+        groupOffsets.push_back(m_bytesWritten.load(std::memory_order_relaxed));
+        ok = write(data);
+        m_rows.fetch_add(rows, std::memory_order_relaxed);
+        m_chunksWritten.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    // Chunks still being formatted use this object
+    m_pool.waitForDone();
+
+    if (ok && !m_cancel.load(std::memory_order_relaxed) && m_format == Format::Columns) {
+        ColumnFileTrailer trailer = {};
+        trailer.rows = m_rows.load(std::memory_order_relaxed);
+        trailer.groupIndexOffset = m_bytesWritten.load(std::memory_order_relaxed);
+        trailer.groupCount = static_cast<uint32_t>(groupOffsets.size());
+        std::memcpy(trailer.magic, ColumnFile::kTrailerMagic, sizeof(trailer.magic));
+        ok = write(QByteArray(reinterpret_cast<const char*>(groupOffsets.data()),
+                              static_cast<qsizetype>(groupOffsets.size() * sizeof(uint64_t))))
+             && write(QByteArray(reinterpret_cast<const char*>(&trailer), sizeof(trailer)));
+    }
+    m_file->close();
+    m_file.reset();
+    m_slots.clear();
+    m_counter = nullptr;
+    m_reader = nullptr;
+
+    m_endNs.store(hostNowNs(), std::memory_order_relaxed);
+    m_running.store(false, std::memory_order_release);
+    if (m_finished) {
+        m_finished();
+    }
+}
+
+void DataExporter::submit(int index)
+{
+    m_pool.start([this, index]() {
+        QByteArray out;
+        uint32_t rows = 0;
+        if (!m_cancel.load(std::memory_order_relaxed)) {
+            ColumnChunk chunk;
+            chunk.data.resize(m_columns.size());
+            chunk.ends.resize(m_columns.size());
+            m_reader(index, chunk);
+            rows = chunk.rows;
+            if (m_format == Format::Csv) {
+                formatCsv(chunk, out);
+            } else {
+                encodeColumns(chunk, out);
+            }
+        }
+
+        std::lock_guard<std::mutex> lock(m_slotMutex);
+        Slot& slot = m_slots[index % m_window];
+        slot.data = std::move(out);
+        slot.rows = rows;
+        slot.ready = true;
+        m_slotReady.notify_all();
+    });
+}
+
+QByteArray DataExporter::header() const
+{
+    QByteArray out;
+    if (m_format == Format::Csv) {
+        for (size_t c = 0; c < m_columns.size(); ++c) {
+            out += m_columns[c].name.toUtf8();
+            out += c + 1 < m_columns.size() ? ',' : '\n';
+        }
+        return out;
+    }
+
+    ColumnFileHeader header;
+    std::memcpy(header.magic, ColumnFile::kMagic, sizeof(header.magic));
+    header.version = ColumnFile::kVersion;
+    header.columnCount = static_cast<uint32_t>(m_columns.size());
+    out.append(reinterpret_cast<const char*>(&header), sizeof(header));
+    for (const ColumnSpec& spec : m_columns) {
+        const QByteArray name = spec.name.toUtf8();
+        ColumnFileColumn column;
+        column.type = static_cast<uint8_t>(spec.type);
+        column.flags = spec.hex ? ColumnFile::Hex : 0;
+        column.nameBytes = static_cast<uint16_t>(name.size());
+        out.append(reinterpret_cast<const char*>(&column), sizeof(column));
+        out += name;
+    }
+    return out;
+}
+
+void DataExporter::formatCsv(const ColumnChunk& chunk, QByteArray& out) const
+{
+    // One row is formatted into line, then appended whole
+    size_t maxRow = 0;
+    for (const ColumnSpec& spec : m_columns) {
+        maxRow += (spec.type == ColumnType::Bytes ? 2 * 255 : kMaxCsvField) + 1;
+    }
+    std::vector<char> line(maxRow);
+    static constexpr char kHex[] = "0123456789abcdef";
+
+    out.reserve(static_cast<qsizetype>(chunk.rows) * static_cast<qsizetype>(m_columns.size()) * 8);
+    for (uint32_t row = 0; row < chunk.rows; ++row) {
+        char* p = line.data();
+        for (size_t c = 0; c < m_columns.size(); ++c) {
+            const ColumnSpec& spec = m_columns[c];
+            const std::vector<uint8_t>& column = chunk.data[c];
+            switch (spec.type) {
+            case ColumnType::Int64:
+                p = formatInteger(p, readValue<int64_t>(column, row), spec.hex);
+                break;
+            case ColumnType::UInt64:
+                p = formatInteger(p, readValue<uint64_t>(column, row), spec.hex);
+                break;
+            case ColumnType::UInt32:
+                p = formatInteger(p, readValue<uint32_t>(column, row), spec.hex);
+                break;
+            case ColumnType::UInt8:
+                p = formatInteger(p, readValue<uint8_t>(column, row), spec.hex);
+                break;
+            case ColumnType::Float64:
+                // Times: nanosecond resolution, without exponents
+                p = std::to_chars(p, p + kMaxCsvField, readValue<double>(column, row), std::chars_format::fixed, 9).ptr;
+                break;
+            case ColumnType::Float32: {
+                // Missing values stay empty
+                const float value = readValue<float>(column, row);
+                if (!std::isnan(value)) {
+                    p = std::to_chars(p, p + kMaxCsvField, value).ptr;
+                }
+                break;
+            }
+            case ColumnType::Bytes: {
+                const uint32_t begin = row ? chunk.ends[c][row - 1] : 0;
+                for (uint32_t i = begin; i < chunk.ends[c][row]; ++i) {
+                    *p++ = kHex[column[i] >> 4];
+                    *p++ = kHex[column[i] & 0xF];
+                }
+                break;
+            }
+            }
+            *p++ = c + 1 < m_columns.size() ? ',' : '\n';
+        }
+        out.append(line.data(), static_cast<qsizetype>(p - line.data()));
+    }
+}
+
+void DataExporter::encodeColumns(const ColumnChunk& chunk, QByteArray& out) const
+{
+    out.append(reinterpret_cast<const char*>(&chunk.rows), sizeof(chunk.rows));
+    std::vector<uint8_t> raw;
+    for (size_t c = 0; c < m_columns.size(); ++c) {
+        const std::vector<uint8_t>* data = &chunk.data[c];
+        if (m_columns[c].type == ColumnType::Bytes) {
+            const std::vector<uint32_t>& ends = chunk.ends[c];
+            raw.resize(ends.size() * sizeof(uint32_t) + data->size());
+            std::memcpy(raw.data(), ends.data(), ends.size() * sizeof(uint32_t));
+            std::memcpy(raw.data() + ends.size() * sizeof(uint32_t), data->data(), data->size());
+            data = &raw;
+        }
+
+        ColumnFileBlock block;
+        block.rawBytes = static_cast<uint32_t>(data->size());
+        const QByteArray compressed = qCompress(data->data(), static_cast<qsizetype>(data->size()), kCompressionLevel);
+        const bool useCompressed = static_cast<size_t>(compressed.size()) < data->size();
+        block.storedBytes = useCompressed ? static_cast<uint32_t>(compressed.size()) : block.rawBytes;
+        out.append(reinterpret_cast<const char*>(&block), sizeof(block));
+        if (useCompressed) {
+            out += compressed;
+        } else {
+            out.append(reinterpret_cast<const char*>(data->data()), static_cast<qsizetype>(data->size()));
+        }
+    }
+}
+
+bool DataExporter::write(const QByteArray& data)
+{
+    if (m_file->write(data) != data.size()) {
+        fail(m_file->errorString());
+        return false;
+    }
+    m_bytesWritten.fetch_add(static_cast<uint64_t>(data.size()), std::memory_order_relaxed);
+    return true;
+}
+
+void DataExporter::fail(const QString& error)
+{
+    std::lock_guard<std::mutex> lock(m_errorMutex);
+    m_error = error;
+    m_failed.store(true, std::memory_order_relaxed);
+}
@@ -0,0 +1,160 @@
+#ifndef DATA_EXPORTER_H
+#define DATA_EXPORTER_H
+
+#include <QByteArray>
+#include <QString>
+#include <QThreadPool>
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "column_file.h"
+#include "telemetry_data_store.h"
+
+class QFile;
+
+// Exports telemetry history or a raw capture to CSV or a column file (see
+// column_file.h). The source is cut into chunks that a low-priority worker
+// pool reads, formats and compresses; the export thread writes the results
+// in order. At most a few chunks per worker are in flight, so memory stays
+// bounded whatever the size of the source. Capture files are read through
+// their mapping and history through a snapshot, so live acquisition keeps
+// running untouched. Whatever has to read the whole source up front, like
+// indexing a capture without a footer, runs on the pool too.
+class DataExporter
+{
+public:
+    enum class Format
+    {
+        Csv,
+        Columns
+    };
+
+    struct Stats
+    {
+        uint64_t rows = 0;
+        uint64_t bytesWritten = 0;
+        int chunksWritten = 0;
+        int chunkCount = 0;
+        double elapsedSeconds = 0.0;
+        double bytesPerSecond = 0.0;    // Over the whole export so far
+        bool failed = false;
+        bool cancelled = false;
+    };
+
+    // finished runs on the export thread once the file is complete or abandoned
+    explicit DataExporter(std::function<void()> finished);
+    ~DataExporter();
+
+    DataExporter(const DataExporter&) = delete;
+    DataExporter& operator=(const DataExporter&) = delete;
+
+    // .csv exports CSV, anything else a column file
+    static Format formatFor(const QString& path);
+
+    // Every frame of a capture, one row each, in capture order
+    bool exportCapture(const QString& capturePath, const QString& path, QString* error = nullptr);
+
+    // Every held sample, motor by motor, with a column for each field held
+    // for any motor; empty where a motor has no such field
+    bool exportHistory(TelemetryDataStore::SnapshotPtr snapshot, const QString& path,
+                       QString* error = nullptr);
+
+    // Stop early; the partial file is left behind
+    void cancel();
+
+    bool isRunning() const { return m_running.load(std::memory_order_relaxed); }
+    QString path() const { return m_path; }
+    QString errorString() const;
+    Stats stats() const;
+
+private:
+    struct ColumnSpec
+    {
+        QString name;
+        ColumnType type;
+        bool hex = false;
+    };
+
+    // One chunk's values, column by column
+    struct ColumnChunk
+    {
+        uint32_t rows = 0;
+        std::vector<std::vector<uint8_t>> data;
+        std::vector<std::vector<uint32_t>> ends;   // Bytes columns: end offset per row
+
+        template <typename T>
+        void append(int column, T value)
+        {
+            const uint8_t* bytes = reinterpret_cast<const uint8_t*>(&value);
+            data[column].insert(data[column].end(), bytes, bytes + sizeof(T));
+        }
+
+        void appendBytes(int column, const uint8_t* bytes, size_t size)
+        {
+            data[column].insert(data[column].end(), bytes, bytes + size);
+            ends[column].push_back(static_cast<uint32_t>(data[column].size()));
+        }
+    };
+
+    // Prepares the source and returns its chunk count; runs on the pool
+    // before any chunk is read
+    using ChunkCounter = std::function<int()>;
+
+    // Fills chunk `index` of the source; runs on the pool
+    using ChunkReader = std::function<void(int index, ColumnChunk& chunk)>;
+
+    struct Slot
+    {
+        QByteArray data;
+        uint32_t rows = 0;
+        bool ready = false;
+    };
+
+    bool start(const QString& path, std::vector<ColumnSpec> columns, ChunkCounter counter,
+               ChunkReader reader, QString* error);
+    void run();
+    void submit(int index);
+    QByteArray header() const;
+    void formatCsv(const ColumnChunk& chunk, QByteArray& out) const;
+    void encodeColumns(const ColumnChunk& chunk, QByteArray& out) const;
+    bool write(const QByteArray& data);
+    void fail(const QString& error);
+
+    std::function<void()> m_finished;
+    QThreadPool m_pool;
+    std::unique_ptr<QFile> m_file;      // Export thread only while running
+    QString m_path;
+    Format m_format = Format::Csv;
+    std::vector<ColumnSpec> m_columns;
+    ChunkCounter m_counter;
+    ChunkReader m_reader;
+    std::atomic<int> m_chunkCount{0};   // 0 until counted
+    int m_window = 0;                   // Chunks in flight at most
+
+    std::mutex m_slotMutex;
+    std::condition_variable m_slotReady;
+    std::vector<Slot> m_slots;          // Chunk i lands in m_slots[i % m_window]
+
+    std::atomic<bool> m_running{false};
+    std::atomic<bool> m_cancel{false};
+    std::thread m_thread;
+
+    mutable std::mutex m_errorMutex;
+    QString m_error;
+
+    std::atomic<uint64_t> m_rows{0};
+    std::atomic<uint64_t> m_bytesWritten{0};
+    std::atomic<int> m_chunksWritten{0};
+    std::atomic<int64_t> m_startNs{0};
+    std::atomic<int64_t> m_endNs{0};    // 0 while exporting
+    std::atomic<bool> m_failed{false};
+};
+
+#endif // DATA_EXPORTER_H
@@ -0,0 +1,163 @@
+#include "decode_plan.h"
+
+namespace {
+constexpr int kPayloadBytes = 8;
+}
+
+QStringList DecodePlan::internFieldIds(const MotorProfile& profile)
+{
+    QStringList ids;
+
+    // MotorProfileLoader rejects profiles past the cap, so only a builtin
+    // profile could lose fields here
+    auto intern = [&ids](const QString& id) {
+        if (id.isEmpty() || ids.contains(id) || ids.size() >= kMaxMeasureFields) {
+            return;
+        }
+        ids.append(id);
+    };
+
+    for (const FieldDefinition& field : profile.defaultFields) {
+        intern(field.id);
+    }
+    for (const MotorDescriptor& motor : profile.motors) {
+        for (const FieldDefinition& field : motor.fields) {
+            intern(field.id);
+        }
+    }
+
+    return ids;
+}
+
+DecodeOp DecodePlan::compileField(const FieldDefinition& field, int slot)
+{
+    DecodeOp op;
+    op.slot = static_cast<uint8_t>(slot);
+    op.littleEndian = field.littleEndian;
+    op.scale = field.scale;
+
+    // Legacy slot resolution happens here instead of per frame
+    if (field.id == QStringLiteral("ecd")) {
+        op.legacy = DecodeOp::Legacy::Ecd;
+    } else if (field.id == QStringLiteral("speed")) {
+        op.legacy = DecodeOp::Legacy::Speed;
+    } else if (field.id == QStringLiteral("current")) {
+        op.legacy = DecodeOp::Legacy::Current;
+    } else if (field.id == QStringLiteral("rotor_temp")) {
+        op.legacy = DecodeOp::Legacy::RotorTemp;
+    } else if (field.id == QStringLiteral("pcb_temp")) {
+        op.legacy = DecodeOp::Legacy::PcbTemp;
+    }
+
+    const int bitStart = field.bits.start;
+    const int bitLength = field.bits.length;
+
+    // Invalid layouts decode to 0, matching BitExtractor::extract
+    if (bitLength <= 0 || bitLength > 32 || field.byteOffset < 0 || bitStart < 0) {
+        return op;
+    }
+
+    const int totalBits = bitStart + bitLength;
+    const int bytesNeeded = (totalBits + 7) / 8;
+    const int available = field.byteOffset < kPayloadBytes ? kPayloadBytes - field.byteOffset : 0;
+
+    // Big endian puts the wanted bits at the top of the assembled word
+    int shift = bitStart;
+    if (!field.littleEndian) {
+        shift += (bytesNeeded * 8) - totalBits;
+    }
+    if (shift >= 32) {
+        return op;
+    }
+
+    op.byteOffset = static_cast<uint8_t>(available > 0 ? field.byteOffset : 0);
+    op.byteCount = static_cast<uint8_t>(bytesNeeded < available ? bytesNeeded : available);
+    op.shift = static_cast<uint8_t>(shift);
+    op.mask = (bitLength == 32) ? 0xFFFFFFFF : ((1U << bitLength) - 1);
+    if (field.signedValue && bitLength < 32) {
+        op.signBit = 1U << (bitLength - 1);
+    }
+
+    return op;
+}
+
+DecodePlan DecodePlan::compile(const MotorProfile& profile)
+{
+    DecodePlan plan;
+    plan.m_fieldIds = internFieldIds(profile);
+    for (int i = 0; i < plan.m_fieldIds.size(); ++i) {
+        plan.m_slots.insert(plan.m_fieldIds[i], i);
+    }
+
+    plan.m_motors.reserve(profile.motors.size());
+    for (const MotorDescriptor& motor : profile.motors) {
+        MotorOps range;
+        range.first = static_cast<int>(plan.m_ops.size());
+        for (const FieldDefinition& field : motor.fields) {
+            int slot = plan.slotOf(field.id);
+            if (slot < 0) {
+                continue;
+            }
+            plan.m_ops.push_back(compileField(field, slot));
+        }
+        range.count = static_cast<int>(plan.m_ops.size()) - range.first;
+        plan.m_motors.push_back(range);
+    }
+
+    return plan;
+}
+
+void DecodePlan::decode(int motorIndex, const uint8_t* payload, MotorMeasure& measure) const
+{
+    if (motorIndex < 0 || motorIndex >= motorCount()) {
+        return;
+    }
+
+    const MotorOps& range = m_motors[motorIndex];
+    const DecodeOp* op = m_ops.data() + range.first;
+    const DecodeOp* end = op + range.count;
+
+    for (; op != end; ++op) {
+        const uint8_t* bytes = payload + op->byteOffset;
+
+        uint64_t word = 0;
+        if (op->littleEndian) {
+            for (int i = op->byteCount - 1; i >= 0; --i) {
+                word = (word << 8) | bytes[i];
+            }
+        } else {
+            for (int i = 0; i < op->byteCount; ++i) {
+                word = (word << 8) | bytes[i];
+            }
+        }
+
+        uint32_t raw = (static_cast<uint32_t>(word) >> op->shift) & op->mask;
+        if (raw & op->signBit) {
+            raw |= ~op->mask;
+        }
+        const int32_t rawValue = static_cast<int32_t>(raw);
+
+        measure.values[op->slot] = static_cast<double>(rawValue) * op->scale;
+        measure.validMask |= 1U << op->slot;
+
+        switch (op->legacy) {
+        case DecodeOp::Legacy::Ecd:
+            measure.ecd = static_cast<uint16_t>(rawValue);
+            break;
+        case DecodeOp::Legacy::Speed:
+            measure.speed_rpm = static_cast<int16_t>(rawValue);
+            break;
+        case DecodeOp::Legacy::Current:
+            measure.current = static_cast<int16_t>(rawValue);
+            break;
+        case DecodeOp::Legacy::RotorTemp:
+            measure.rotor_temperature = static_cast<uint8_t>(rawValue);
+            break;
+        case DecodeOp::Legacy::PcbTemp:
+            measure.pcb_temperature = static_cast<uint8_t>(rawValue);
+            break;
+        case DecodeOp::Legacy::None:
+            break;
+        }
+    }
+}
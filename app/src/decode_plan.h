@@ -0,0 +1,68 @@
+#ifndef DECODE_PLAN_H
+#define DECODE_PLAN_H
+
+#include <QHash>
+#include <QString>
+#include <QStringList>
+
+#include <cstdint>
+#include <vector>
+
+#include "motor_profile.h"
+
+// Pre-resolved extraction op for a single field of a single motor.
+// Produces exactly the same value as BitExtractor::extract with the
+// original FieldDefinition, without any per-frame branching on layout.
+struct DecodeOp
+{
+    enum class Legacy : int8_t { None = -1, Ecd, Speed, Current, RotorTemp, PcbTemp };
+
+    uint8_t byteOffset = 0;  // First payload byte
+    uint8_t byteCount = 0;   // Bytes to assemble (already clipped to payload)
+    uint8_t shift = 0;       // Right shift applied to the assembled word
+    uint8_t slot = 0;        // Destination index in MotorMeasure::values
+    bool littleEndian = false;
+    Legacy legacy = Legacy::None;
+    uint32_t mask = 0;       // Value mask (0 disables the op)
+    uint32_t signBit = 0;    // Sign bit to extend from (0 = unsigned)
+    double scale = 1.0;
+};
+
+// Decode plan compiled once per active profile. Field IDs are interned to
+// slot indices so the receive path only touches flat arrays.
+class DecodePlan
+{
+public:
+    // Compile all motor field definitions of a profile into flat ops
+    static DecodePlan compile(const MotorProfile& profile);
+
+    // Field IDs in slot order. Defaults first, then any extra IDs
+    // introduced by per-motor overrides. Capped at kMaxMeasureFields.
+    static QStringList internFieldIds(const MotorProfile& profile);
+
+    int motorCount() const { return static_cast<int>(m_motors.size()); }
+    int fieldCount() const { return m_fieldIds.size(); }
+    const QStringList& fieldIds() const { return m_fieldIds; }
+
+    // Slot index for a field ID, or -1 if the profile has no such field
+    int slotOf(const QString& fieldId) const { return m_slots.value(fieldId, -1); }
+
+    // Decode an 8-byte payload into measure (no allocation)
+    void decode(int motorIndex, const uint8_t* payload, MotorMeasure& measure) const;
+
+private:
+    struct MotorOps
+    {
+        int first = 0;
+        int count = 0;
+    };
+
+    static DecodeOp compileField(const FieldDefinition& field, int slot);
+
+    std::vector<DecodeOp> m_ops;
+    std::vector<MotorOps> m_motors;
+    QStringList m_fieldIds;
+    QHash<QString, int> m_slots;
+};
+
+#endif // DECODE_PLAN_H
@@ -1,35 +1,174 @@
 #include "dm_device_wrapper.h"
-#include "bit_extractor.h"
 
 #include <QMetaObject>
 #include <QMutexLocker>
 #include <QString>
 
-DmDeviceWrapper* DmDeviceWrapper::s_instance = nullptr;
+#include <algorithm>
+#include <chrono>
+#include <thread>
+
+namespace {
+int64_t hostNowNs()
+{
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+// Unit of usb_tx_frame_head_t::interval. Not documented by the SDK;
+// microseconds assumed, and checked by TxScheduler against the TX echoes
+// of the first offloaded window.
+constexpr int64_t kTxIntervalUnitNs = 1000;
+}
+
+std::atomic<DmDeviceWrapper::DeviceContext*> DmDeviceWrapper::s_routes[kMaxDevices] = {};
+std::atomic<int> DmDeviceWrapper::s_routeBusy[kMaxDevices] = {};
+
+template <int Route>
+void DmDeviceWrapper::recCallbackThunk(usb_rx_frame_t* frame)
+{
+    routeFrame(Route, frame, false);
+}
+
+template <int Route>
+void DmDeviceWrapper::sentCallbackThunk(usb_rx_frame_t* frame)
+{
+    routeFrame(Route, frame, true);
+}
+
+const dev_rec_callback DmDeviceWrapper::s_recThunks[kMaxDevices] = {
+    &DmDeviceWrapper::recCallbackThunk<0>,
+    &DmDeviceWrapper::recCallbackThunk<1>,
+    &DmDeviceWrapper::recCallbackThunk<2>,
+    &DmDeviceWrapper::recCallbackThunk<3>,
+    &DmDeviceWrapper::recCallbackThunk<4>,
+    &DmDeviceWrapper::recCallbackThunk<5>,
+    &DmDeviceWrapper::recCallbackThunk<6>,
+    &DmDeviceWrapper::recCallbackThunk<7>,
+};
+
+const dev_sent_callback DmDeviceWrapper::s_sentThunks[kMaxDevices] = {
+    &DmDeviceWrapper::sentCallbackThunk<0>,
+    &DmDeviceWrapper::sentCallbackThunk<1>,
+    &DmDeviceWrapper::sentCallbackThunk<2>,
+    &DmDeviceWrapper::sentCallbackThunk<3>,
+    &DmDeviceWrapper::sentCallbackThunk<4>,
+    &DmDeviceWrapper::sentCallbackThunk<5>,
+    &DmDeviceWrapper::sentCallbackThunk<6>,
+    &DmDeviceWrapper::sentCallbackThunk<7>,
+};
+
+static_assert(FrameRecorder::kMaxLanes >= DmDeviceWrapper::kMaxDevices * DmDeviceWrapper::kChannelsPerDevice * 2,
+              "one receive and one sent lane per bus");
 
 DmDeviceWrapper::DmDeviceWrapper(QObject* parent)
     : QObject(parent)
+    , m_batchTimer(new QTimer(this))
+    , m_txScheduler([this](int group, const int32_t* values, int count, const TxRepeat& repeat) {
+        sendGroup(group, values, count, repeat);
+    })
+    , m_replayer([this](int bus, const usb_rx_frame_t& frame, int64_t hostTimeNs) {
+                     return replayFrame(bus, frame, hostTimeNs);
+                 },
+                 [this]() {
+                     QMetaObject::invokeMethod(this, &DmDeviceWrapper::replayFinished, Qt::QueuedConnection);
+                 })
 {
-    s_instance = this;
+    m_batchTimer->setSingleShot(true);
+    m_batchTimer->setTimerType(Qt::PreciseTimer);
+    m_batchTimer->setInterval(2);
+    connect(m_batchTimer, &QTimer::timeout, this, &DmDeviceWrapper::drainSamples);
+
     // Load default profile
     QVector<MotorProfile> profiles = defaultMotorProfiles();
-    if (!profiles.isEmpty()) {
-        m_activeProfile = profiles.first();
-    }
+    setActiveProfile(profiles.isEmpty() ? MotorProfile() : profiles.first());
 }
 
 DmDeviceWrapper::~DmDeviceWrapper()
 {
+    stopReplay();
     close();
-    if (s_instance == this) {
-        s_instance = nullptr;
-    }
 }
 
 void DmDeviceWrapper::setActiveProfile(const MotorProfile& profile)
+{
+    // Compiled outside any lock; readers switch over atomically
+    m_profile.publish(ProfileSnapshot::build(profile));
+}
+
+MotorProfile DmDeviceWrapper::activeProfile() const
+{
+    auto snapshot = m_profile.pin();
+    return snapshot ? snapshot->profile : MotorProfile();
+}
+
+void DmDeviceWrapper::setDropPolicy(SampleQueue::DropPolicy policy)
+{
+    QMutexLocker locker(&m_mutex);
+    m_dropPolicy = policy;
+    for (const auto& context : m_devices) {
+        for (const auto& worker : context->channels) {
+            if (worker) {
+                worker->samples().setDropPolicy(policy);
+            }
+        }
+    }
+}
+
+SampleQueue::DropPolicy DmDeviceWrapper::dropPolicy() const
+{
+    QMutexLocker locker(&m_mutex);
+    return m_dropPolicy;
+}
+
+size_t DmDeviceWrapper::queueDepth() const
+{
+    QMutexLocker locker(&m_mutex);
+    size_t depth = 0;
+    for (const auto& context : m_devices) {
+        for (const auto& worker : context->channels) {
+            if (worker) {
+                depth += worker->framesPending() + worker->samples().depth();
+            }
+        }
+    }
+    return depth;
+}
+
+uint64_t DmDeviceWrapper::queueOverflows() const
+{
+    QMutexLocker locker(&m_mutex);
+    uint64_t overflows = 0;
+    for (const auto& context : m_devices) {
+        for (const auto& worker : context->channels) {
+            if (worker) {
+                overflows += worker->framesDropped() + worker->samples().overflowCount();
+            }
+        }
+    }
+    return overflows;
+}
+
+int DmDeviceWrapper::hostClockBuses() const
 {
     QMutexLocker locker(&m_mutex);
-    m_activeProfile = profile;
+    int buses = 0;
+    for (const auto& context : m_devices) {
+        for (const auto& worker : context->channels) {
+            buses += worker && worker->clockOnHostTime() ? 1 : 0;
+        }
+    }
+    return buses;
+}
+
+void DmDeviceWrapper::setBatchInterval(int ms)
+{
+    m_batchTimer->setInterval(qBound(kMinBatchIntervalMs, ms, kMaxBatchIntervalMs));
+}
+
+int DmDeviceWrapper::batchInterval() const
+{
+    return m_batchTimer->interval();
 }
 
 void DmDeviceWrapper::setDeviceType(device_def_t type)
@@ -47,17 +186,101 @@ void DmDeviceWrapper::setChannel(uint8_t channel)
     m_channel = channel;
 }
 
+void DmDeviceWrapper::setCaptureAllChannels(bool enabled)
+{
+    QMutexLocker locker(&m_mutex);
+    m_captureAll = enabled;
+}
+
+bool DmDeviceWrapper::captureAllChannels() const
+{
+    QMutexLocker locker(&m_mutex);
+    return m_captureAll;
+}
+
+int DmDeviceWrapper::openBusCount() const
+{
+    QMutexLocker locker(&m_mutex);
+    int count = 0;
+    for (const auto& context : m_devices) {
+        for (const auto& worker : context->channels) {
+            if (worker) {
+                ++count;
+            }
+        }
+    }
+    return count;
+}
+
 void DmDeviceWrapper::setBaud(int arbitration, int data, float can_sp, float canfd_sp)
 {
     QMutexLocker locker(&m_mutex);
-    if (!m_device) {
-        return;
+    for (const auto& context : m_devices) {
+        for (int ch = 0; ch < kChannelsPerDevice; ++ch) {
+            if (context->channels[ch]) {
+                device_channel_set_baud_with_sp(context->device, static_cast<uint8_t>(ch), true,
+                                                arbitration, data, can_sp, canfd_sp);
+            }
+        }
+    }
+}
+
+int DmDeviceWrapper::channelCount(device_handle* device) const
+{
+    device_def_t type = m_deviceType;
+    device_get_type(device, &type);
+    return type == DEV_USB2CANFD_DUAL ? 2 : 1;
+}
+
+bool DmDeviceWrapper::openDevice(device_handle* device, int deviceIndex)
+{
+    if (!device_open(device)) {
+        return false;
+    }
+
+    std::unique_ptr<DeviceContext> context(new DeviceContext);
+    context->owner = this;
+    context->deviceIndex = deviceIndex;
+    context->device = device;
+    context->recorder = &m_recorder;
+
+    QVector<int> channels;
+    if (m_captureAll) {
+        for (int ch = 0; ch < channelCount(device); ++ch) {
+            channels.push_back(ch);
+        }
+    } else if (m_channel < kChannelsPerDevice) {
+        channels.push_back(m_channel);
+    }
+
+    for (int ch : channels) {
+        const int bus = deviceIndex * kChannelsPerDevice + ch;
+        auto worker = std::make_unique<ChannelWorker>(bus, m_profile, [this]() { requestDrain(); });
+        worker->samples().setDropPolicy(m_dropPolicy);
+        worker->start();
+        context->channels[ch] = std::move(worker);
+    }
+
+    context->route = claimRoute(context.get());
+    if (context->route < 0) {
+        device_close(device);
+        return false;
     }
-    device_channel_set_baud_with_sp(m_device, m_channel, true, arbitration, data, can_sp, canfd_sp);
+
+    device_hook_to_rec(device, s_recThunks[context->route]);
+    device_hook_to_sent(device, s_sentThunks[context->route]);
+    for (int ch : channels) {
+        device_open_channel(device, static_cast<uint8_t>(ch));
+    }
+
+    m_devices.push_back(std::move(context));
+    return true;
 }
 
 bool DmDeviceWrapper::open()
 {
+    stopReplay();
+
     QMutexLocker locker(&m_mutex);
     if (m_open) {
         return true;
@@ -87,32 +310,57 @@ bool DmDeviceWrapper::open()
         return false;
     }
 
-    m_device = dev_list[0];
-    if (!device_open(m_device)) {
+    const int wanted = m_captureAll ? std::min(handle_cnt, kMaxDevices) : 1;
+    for (int i = 0; i < wanted; ++i) {
+        openDevice(dev_list[i], i);
+    }
+
+    if (m_devices.empty()) {
         damiao_handle_destroy(m_handle);
         m_handle = nullptr;
-        m_device = nullptr;
         emit deviceStatusChanged(false, QStringLiteral("Open device failed"));
         return false;
     }
 
-    device_hook_to_rec(m_device, &DmDeviceWrapper::recCallbackThunk);
-    device_open_channel(m_device, m_channel);
+    m_device = m_devices.front()->device;
     m_open = true;
-    emit deviceStatusChanged(true, QStringLiteral("Device opened"));
+    m_hostClockBuses = 0;
+    m_txScheduler.start();
+
+    int buses = 0;
+    for (const auto& context : m_devices) {
+        for (const auto& worker : context->channels) {
+            buses += worker ? 1 : 0;
+        }
+    }
+    emit deviceStatusChanged(true, m_devices.size() == 1 && buses == 1
+                                       ? QStringLiteral("Device opened")
+                                       : QStringLiteral("Opened %1 device(s), %2 bus(es)")
+                                             .arg(static_cast<int>(m_devices.size()))
+                                             .arg(buses));
     return true;
 }
 
 void DmDeviceWrapper::close()
 {
+    // Joined before taking the lock its sends contend for
+    m_txScheduler.stop();
+
     QMutexLocker locker(&m_mutex);
     if (!m_open) {
         return;
     }
-    if (m_device) {
-        device_close_channel(m_device, m_channel);
-        device_close(m_device);
+    for (const auto& context : m_devices) {
+        for (int ch = 0; ch < kChannelsPerDevice; ++ch) {
+            if (context->channels[ch]) {
+                device_close_channel(context->device, static_cast<uint8_t>(ch));
+            }
+        }
+        device_close(context->device);
+        releaseRoute(context->route);
     }
+    // Workers are joined by their destructors once no callback can reach them
+    m_devices.clear();
     if (m_handle) {
         damiao_handle_destroy(m_handle);
     }
@@ -127,122 +375,234 @@ bool DmDeviceWrapper::isOpen() const
     return m_open;
 }
 
-int16_t DmDeviceWrapper::clampValue(int value) const
+void DmDeviceWrapper::sendGroup(int groupIndex, const int32_t* values, int count,
+                                const TxRepeat& repeat)
 {
-    int32_t min = m_activeProfile.controlLimits.min;
-    int32_t max = m_activeProfile.controlLimits.max;
-    if (value > max) {
-        return static_cast<int16_t>(max);
+    if (!values) {
+        return;
+    }
+
+    // Encoded on the stack from the compiled plan; nothing allocates per send
+    usb_tx_frame_t frame{};
+    {
+        auto snapshot = m_profile.pin();
+        if (!snapshot || !snapshot->commandPlan.encode(groupIndex, values, count, frame)) {
+            return;
+        }
     }
-    if (value < min) {
-        return static_cast<int16_t>(min);
+
+    // send_advanced has no interval argument, so periodic frames go through
+    // the full frame header as well
+    if (repeat.times > 1) {
+        frame.head.interval = static_cast<uint32_t>(std::max<int64_t>(repeat.intervalNs / kTxIntervalUnitNs, 1));
+        frame.head.send_times = repeat.times;
     }
-    return static_cast<int16_t>(value);
-}
 
-void DmDeviceWrapper::sendGroup(int groupIndex, const QVector<int16_t>& values)
-{
+    // Only the device handle needs the lock
     QMutexLocker locker(&m_mutex);
     if (!m_open || !m_device) {
         return;
     }
-    if (values.size() < 4) {
-        return;
+    frame.head.channel = m_channel;
+    device_channel_send(m_device, frame);
+}
+
+bool DmDeviceWrapper::startReplay(const QString& path, FrameReplayer::Mode mode, double speed,
+                                  QString* error)
+{
+    stopReplay();
+    {
+        QMutexLocker locker(&m_mutex);
+        if (m_open) {
+            if (error) {
+                *error = QStringLiteral("Close the device before replaying");
+            }
+            return false;
+        }
     }
+    return m_replayer.start(path, mode, speed, error);
+}
+
+void DmDeviceWrapper::stopReplay()
+{
+    m_replayer.stop();
 
-    // Get command group from profile
-    if (groupIndex < 0 || groupIndex >= m_activeProfile.commandGroups.size()) {
+    QMutexLocker locker(&m_mutex);
+    if (m_open) {
         return;
     }
-    const MotorCommandGroup& group = m_activeProfile.commandGroups[groupIndex];
+    // Let the workers decode what was handed to them, then deliver it
+    for (const auto& context : m_devices) {
+        for (const auto& worker : context->channels) {
+            if (!worker) {
+                continue;
+            }
+            while (worker->framesPending() > 0) {
+                std::this_thread::yield();
+            }
+            worker->stop();
+        }
+    }
+    locker.unlock();
+    drainSamples();
 
-    uint8_t payload[8];
+    locker.relock();
+    m_devices.clear();
+    std::fill(std::begin(m_replayWorkers), std::end(m_replayWorkers), nullptr);
+}
 
-    for (int i = 0; i < 4; ++i) {
-        int16_t v = clampValue(values[i]);
-        if (group.littleEndian) {
-            // Little endian: LSB first
-            payload[i * 2] = static_cast<uint8_t>(v & 0xFF);
-            payload[i * 2 + 1] = static_cast<uint8_t>((v >> 8) & 0xFF);
-        } else {
-            // Big endian: MSB first
-            payload[i * 2] = static_cast<uint8_t>((v >> 8) & 0xFF);
-            payload[i * 2 + 1] = static_cast<uint8_t>(v & 0xFF);
+ChannelWorker* DmDeviceWrapper::replayWorker(int bus)
+{
+    // First frame of a bus: set up a worker the way openDevice() does
+    QMutexLocker locker(&m_mutex);
+    const int deviceIndex = bus / kChannelsPerDevice;
+    DeviceContext* context = nullptr;
+    for (const auto& existing : m_devices) {
+        if (existing->deviceIndex == deviceIndex) {
+            context = existing.get();
         }
     }
-
-    device_channel_send_fast(m_device, m_channel, group.canId, 1, false, false, false, 8, payload);
+    if (!context) {
+        m_devices.push_back(std::make_unique<DeviceContext>());
+        context = m_devices.back().get();
+        context->owner = this;
+        context->deviceIndex = deviceIndex;
+    }
+    auto worker = std::make_unique<ChannelWorker>(bus, m_profile, [this]() { requestDrain(); });
+    worker->samples().setDropPolicy(m_dropPolicy);
+    worker->start();
+    context->channels[bus % kChannelsPerDevice] = std::move(worker);
+    return context->channels[bus % kChannelsPerDevice].get();
 }
 
-void DmDeviceWrapper::recCallbackThunk(usb_rx_frame_t* frame)
+bool DmDeviceWrapper::replayFrame(int bus, const usb_rx_frame_t& frame, int64_t hostTimeNs)
 {
-    if (!s_instance || !frame) {
-        return;
+    if (bus < 0 || bus >= kMaxDevices * kChannelsPerDevice) {
+        return true;
+    }
+    ChannelWorker*& worker = m_replayWorkers[bus];
+    if (!worker) {
+        worker = replayWorker(bus);
     }
-    s_instance->handleRecFrame(frame);
+    return worker->offer(frame, hostTimeNs);
 }
 
-int DmDeviceWrapper::matchMotor(uint32_t canId) const
+int DmDeviceWrapper::claimRoute(DeviceContext* context)
 {
-    for (int i = 0; i < m_activeProfile.motors.size(); ++i) {
-        if (m_activeProfile.motors[i].canIdMatcher.matches(canId)) {
+    for (int i = 0; i < kMaxDevices; ++i) {
+        DeviceContext* expected = nullptr;
+        if (s_routes[i].compare_exchange_strong(expected, context)) {
             return i;
         }
     }
     return -1;
 }
 
-MotorMeasure DmDeviceWrapper::parseFrame(int motorIndex, const uint8_t* payload) const
+void DmDeviceWrapper::releaseRoute(int route)
 {
-    MotorMeasure measure;
-
-    if (motorIndex < 0 || motorIndex >= m_activeProfile.motors.size()) {
-        return measure;
+    if (route < 0 || route >= kMaxDevices) {
+        return;
     }
+    s_routes[route].store(nullptr, std::memory_order_seq_cst);
+    // Wait out a callback that picked up the context before it was cleared
+    while (s_routeBusy[route].load(std::memory_order_seq_cst) > 0) {
+        std::this_thread::yield();
+    }
+}
 
-    const MotorDescriptor& motor = m_activeProfile.motors[motorIndex];
-
-    // Parse each field using bit extractor
-    for (const FieldDefinition& field : motor.fields) {
-        int32_t rawValue = BitExtractor::extract(
-            payload,
-            field.byteOffset,
-            field.bits.start,
-            field.bits.length,
-            field.littleEndian,
-            field.signedValue
-        );
+void DmDeviceWrapper::routeFrame(int route, usb_rx_frame_t* frame, bool sent)
+{
+    if (!frame) {
+        return;
+    }
+    const int64_t now = hostNowNs();
+
+    s_routeBusy[route].fetch_add(1, std::memory_order_seq_cst);
+    DeviceContext* context = s_routes[route].load(std::memory_order_seq_cst);
+    if (context) {
+        const uint8_t channel = frame->head.channel;
+        if (channel < kChannelsPerDevice) {
+            // One lane per bus and direction, whichever threads the SDK calls from
+            context->recorder->record((route * kChannelsPerDevice + channel) * 2 + (sent ? 1 : 0),
+                                      context->deviceIndex * kChannelsPerDevice + channel, *frame, now, sent);
+            if (!sent && context->channels[channel]) {
+                context->channels[channel]->submit(*frame, now);
+            }
+            if (sent) {
+                context->owner->checkTxEcho(*frame, now);
+            }
+        }
+    }
+    s_routeBusy[route].fetch_sub(1, std::memory_order_release);
+}
 
-        double scaledValue = static_cast<double>(rawValue) * field.scale;
-        measure.fields.insert(field.id, scaledValue);
+void DmDeviceWrapper::checkTxEcho(const usb_rx_frame_t& frame, int64_t hostTimeNs)
+{
+    // Only the first offloaded window is timed against its echoes
+    if (!m_txScheduler.checkingOffload()) {
+        return;
+    }
+    auto snapshot = m_profile.pin();
+    const int group = snapshot ? snapshot->commandPlan.groupForCanId(frame.head.can_id) : -1;
+    if (group >= 0) {
+        m_txScheduler.onTxEcho(group, hostTimeNs);
+    }
+}
 
-        // Also populate legacy fields for backward compatibility
-        if (field.id == QStringLiteral("ecd")) {
-            measure.ecd = static_cast<uint16_t>(rawValue);
-        } else if (field.id == QStringLiteral("speed")) {
-            measure.speed_rpm = static_cast<int16_t>(rawValue);
-        } else if (field.id == QStringLiteral("current")) {
-            measure.current = static_cast<int16_t>(rawValue);
-        } else if (field.id == QStringLiteral("rotor_temp")) {
-            measure.rotor_temperature = static_cast<uint8_t>(rawValue);
-        } else if (field.id == QStringLiteral("pcb_temp")) {
-            measure.pcb_temperature = static_cast<uint8_t>(rawValue);
-        }
+void DmDeviceWrapper::requestDrain()
+{
+    // One queued hop per batch interval instead of one event per frame
+    if (!m_drainPending.exchange(true, std::memory_order_acq_rel)) {
+        QMetaObject::invokeMethod(this, &DmDeviceWrapper::scheduleDrain, Qt::QueuedConnection);
     }
+}
 
-    return measure;
+void DmDeviceWrapper::scheduleDrain()
+{
+    if (!m_batchTimer->isActive()) {
+        m_batchTimer->start();
+    }
 }
 
-void DmDeviceWrapper::handleRecFrame(usb_rx_frame_t* frame)
+void DmDeviceWrapper::drainSamples()
 {
-    int motorIndex = matchMotor(frame->head.can_id);
-    if (motorIndex < 0) {
-        return;
+    m_drainPending.store(false, std::memory_order_release);
+
+    m_drainBuffer.clear();
+    int hostClockBuses = 0;
+    {
+        QMutexLocker locker(&m_mutex);
+        auto byTime = [](const MotorSample& a, const MotorSample& b) {
+            return a.timestampNs < b.timestampNs;
+        };
+        // Each bus is already in time order; merge them into one timeline
+        for (const auto& context : m_devices) {
+            for (const auto& worker : context->channels) {
+                if (!worker) {
+                    continue;
+                }
+                hostClockBuses += worker->clockOnHostTime() ? 1 : 0;
+                const size_t mid = m_drainBuffer.size();
+                worker->samples().drain(m_drainBuffer);
+                std::inplace_merge(m_drainBuffer.begin(), m_drainBuffer.begin() + mid,
+                                   m_drainBuffer.end(), byTime);
+            }
+        }
     }
 
-    MotorMeasure measure = parseFrame(motorIndex, frame->payload);
+    if (hostClockBuses != m_hostClockBuses) {
+        m_hostClockBuses = hostClockBuses;
+        emit deviceStatusChanged(hostClockBuses == 0,
+                                 hostClockBuses == 0
+                                     ? QStringLiteral("Adapter clock in use")
+                                     : QStringLiteral("Adapter clock rejected on %1 bus(es), "
+                                                      "using host time")
+                                           .arg(hostClockBuses));
+    }
+    if (m_drainBuffer.empty()) {
+        return;
+    }
 
-    QMetaObject::invokeMethod(this, [this, motorIndex, measure]() {
-        emit motorUpdated(motorIndex, measure);
-    }, Qt::QueuedConnection);
+    MotorSampleBatch batch(m_drainBuffer.begin(), m_drainBuffer.end());
+    emit motorsUpdated(batch);
 }
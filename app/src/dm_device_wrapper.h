@@ -3,17 +3,36 @@
 
 #include <QObject>
 #include <QMutex>
+#include <QTimer>
 #include <QVector>
 #include <QString>
+#include <atomic>
 #include <cstdint>
+#include <memory>
+#include <vector>
 
 #include "pub_user.h"
 #include "motor_profile.h"
+#include "channel_worker.h"
+#include "frame_recorder.h"
+#include "frame_replayer.h"
+#include "profile_snapshot.h"
+#include "sample_queue.h"
+#include "snapshot_cell.h"
+#include "tx_scheduler.h"
 
 class DmDeviceWrapper : public QObject
 {
     Q_OBJECT
 public:
+    // Bus index = device index * kChannelsPerDevice + channel
+    static constexpr int kChannelsPerDevice = 2;
+    static constexpr int kMaxDevices = 8;
+
+    // Range of setBatchInterval()
+    static constexpr int kMinBatchIntervalMs = 1;
+    static constexpr int kMaxBatchIntervalMs = 100;
+
     explicit DmDeviceWrapper(QObject* parent = nullptr);
     ~DmDeviceWrapper() override;
 
@@ -26,40 +45,119 @@ public:
     void setChannel(uint8_t channel);
     void setBaud(int arbitration, int data, float can_sp = 0.75f, float canfd_sp = 0.75f);
 
-    // Profile management
-    void setActiveProfile(const MotorProfile& profile);
-    const MotorProfile& activeProfile() const { return m_activeProfile; }
+    // Open every enumerated device and all of its channels instead of
+    // device 0 / setChannel() only. Takes effect on the next open().
+    void setCaptureAllChannels(bool enabled);
+    bool captureAllChannels() const;
+    int openBusCount() const;
 
-    // Send motor command group (uses profile for CAN ID and endianness)
-    void sendGroup(int groupIndex, const QVector<int16_t>& values);
+    // Profile management. The profile and its compiled decode/dispatch
+    // tables are published as one immutable snapshot; safe from any thread.
+    void setActiveProfile(const MotorProfile& profile);
+    MotorProfile activeProfile() const;
+
+    // Receive queues between the channel workers and the GUI thread
+    void setDropPolicy(SampleQueue::DropPolicy policy);
+    SampleQueue::DropPolicy dropPolicy() const;
+    size_t queueDepth() const;
+    uint64_t queueOverflows() const;
+
+    // Buses whose adapter clock fit was rejected (see ClockSync), so their
+    // samples are timestamped on receipt by the host
+    int hostClockBuses() const;
+
+    // Minimum spacing between motorsUpdated emissions, clamped to
+    // [kMinBatchIntervalMs, kMaxBatchIntervalMs]
+    void setBatchInterval(int ms);
+    int batchInterval() const;
+
+    // Send motor command group, encoded with the profile's command layout.
+    // A repeat with times > 1 is handed to the adapter as one periodic frame.
+    void sendGroup(int groupIndex, const int32_t* values, int count,
+                   const TxRepeat& repeat = TxRepeat());
+
+    // Periodic group transmission; runs while the device is open
+    TxScheduler& txScheduler() { return m_txScheduler; }
+
+    // Raw capture of every received frame and TX echo; may run whether or
+    // not a device is open
+    FrameRecorder& recorder() { return m_recorder; }
+
+    // Play a capture file through the channel workers in place of a device,
+    // so it is decoded and delivered exactly like live frames. Not while a
+    // device is open; open() ends a replay.
+    bool startReplay(const QString& path, FrameReplayer::Mode mode, double speed = 1.0,
+                     QString* error = nullptr);
+    void stopReplay();
+    bool isReplaying() const { return m_replayer.isRunning(); }
+    FrameReplayer::Stats replayStats() const { return m_replayer.stats(); }
 
 signals:
     void deviceStatusChanged(bool ok, const QString& message);
-    void motorUpdated(int motorIndex, MotorMeasure measure);
+    void motorsUpdated(const MotorSampleBatch& batch);
+    void replayFinished();
 
 private:
+    // One opened adapter and the workers of its open channels
+    struct DeviceContext
+    {
+        DmDeviceWrapper* owner = nullptr;
+        int route = -1;
+        int deviceIndex = 0;
+        device_handle* device = nullptr;
+        FrameRecorder* recorder = nullptr;
+        std::unique_ptr<ChannelWorker> channels[kChannelsPerDevice];
+    };
+
+    // The SDK callback carries no user pointer, so each opened device is
+    // hooked to its own thunk and routed through a process-wide table.
+    template <int Route>
     static void recCallbackThunk(usb_rx_frame_t* frame);
-    void handleRecFrame(usb_rx_frame_t* frame);
-
-    // Find motor index by CAN ID using profile matchers
-    int matchMotor(uint32_t canId) const;
-
-    // Parse frame using profile field definitions
-    MotorMeasure parseFrame(int motorIndex, const uint8_t* payload) const;
-
-    // Clamp value to profile control limits
-    int16_t clampValue(int value) const;
-
-    QMutex m_mutex;
+    template <int Route>
+    static void sentCallbackThunk(usb_rx_frame_t* frame);
+    static void routeFrame(int route, usb_rx_frame_t* frame, bool sent);
+    void checkTxEcho(const usb_rx_frame_t& frame, int64_t hostTimeNs);
+    static int claimRoute(DeviceContext* context);
+    static void releaseRoute(int route);
+    static const dev_rec_callback s_recThunks[kMaxDevices];
+    static const dev_sent_callback s_sentThunks[kMaxDevices];
+    static std::atomic<DeviceContext*> s_routes[kMaxDevices];
+    static std::atomic<int> s_routeBusy[kMaxDevices];
+
+    bool openDevice(device_handle* device, int deviceIndex);
+    int channelCount(device_handle* device) const;
+
+    bool replayFrame(int bus, const usb_rx_frame_t& frame, int64_t hostTimeNs);
+    ChannelWorker* replayWorker(int bus);
+
+    void requestDrain();
+    void scheduleDrain();
+    void drainSamples();
+
+    // Guards device handles, contexts and channel state
+    mutable QMutex m_mutex;
     damiao_handle* m_handle = nullptr;
-    device_handle* m_device = nullptr;
+    device_handle* m_device = nullptr;          // Transmit device (device 0)
     device_def_t m_deviceType = DEV_USB2CANFD_DUAL;
     uint8_t m_channel = 0;
+    bool m_captureAll = false;
     bool m_open = false;
+    std::vector<std::unique_ptr<DeviceContext>> m_devices;
+
+    SnapshotCell<ProfileSnapshot> m_profile;
+
+    SampleQueue::DropPolicy m_dropPolicy = SampleQueue::DropPolicy::DropOldest;
+    std::atomic<bool> m_drainPending{false};
+    std::vector<MotorSample> m_drainBuffer;
+    QTimer* m_batchTimer = nullptr;
+    int m_hostClockBuses = 0;                   // GUI thread; as last reported
 
-    MotorProfile m_activeProfile;
+    TxScheduler m_txScheduler;
+    FrameRecorder m_recorder;
 
-    static DmDeviceWrapper* s_instance;
+    // Replay thread only; the workers are owned by m_devices
+    ChannelWorker* m_replayWorkers[kMaxDevices * kChannelsPerDevice] = {};
+    FrameReplayer m_replayer;
 };
 
 #endif
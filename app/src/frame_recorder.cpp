@@ -0,0 +1,261 @@
+#include "frame_recorder.h"
+#include "capture_format.h"
+
+#include <QFile>
+
+#include <chrono>
+#include <cstring>
+
+namespace {
+constexpr auto kWriterPollInterval = std::chrono::milliseconds(5);
+constexpr auto kRateWindow = std::chrono::seconds(1);
+}
+
+FrameRecorder::FrameRecorder() = default;
+
+FrameRecorder::~FrameRecorder()
+{
+    stop();
+}
+
+bool FrameRecorder::start(const QString& path, QString* error)
+{
+    stop();
+
+    // Blocks are written whole, so Qt's own buffering would only add a copy
+    auto file = std::make_unique<QFile>(path);
+    if (!file->open(QIODevice::WriteOnly | QIODevice::Truncate | QIODevice::Unbuffered)) {
+        if (error) {
+            *error = file->errorString();
+        }
+        return false;
+    }
+    const CaptureFileHeader header = CaptureFormat::fileHeader();
+    if (file->write(reinterpret_cast<const char*>(&header), sizeof(header)) != sizeof(header)) {
+        if (error) {
+            *error = file->errorString();
+        }
+        return false;
+    }
+
+    // Allocated up front; the callback side never allocates
+    m_lanes.reset(new Lane[kMaxLanes]);
+    for (int i = 0; i < kMaxLanes; ++i) {
+        for (Block& block : m_lanes[i].blocks) {
+            block.data.reset(new uint8_t[kBlockSize]);
+        }
+    }
+
+    m_file = std::move(file);
+    m_path = path;
+    m_index.clear();
+    m_writeOffset = sizeof(header);
+    m_frames.store(0, std::memory_order_relaxed);
+    m_bytesWritten.store(sizeof(header), std::memory_order_relaxed);
+    m_droppedBlocks.store(0, std::memory_order_relaxed);
+    m_droppedFrames.store(0, std::memory_order_relaxed);
+    m_bytesPerSecond.store(0.0, std::memory_order_relaxed);
+    m_writeFailed.store(false, std::memory_order_relaxed);
+
+    m_running.store(true, std::memory_order_release);
+    m_thread = std::thread(&FrameRecorder::run, this);
+    m_recording.store(true, std::memory_order_seq_cst);
+    return true;
+}
+
+void FrameRecorder::stop()
+{
+    if (!m_recording.exchange(false, std::memory_order_seq_cst)) {
+        return;
+    }
+    // Wait out producers that saw recording still on
+    while (m_producers.load(std::memory_order_seq_cst) > 0) {
+        std::this_thread::yield();
+    }
+
+    // The writer drains the partly filled blocks on its way out
+    m_running.store(false, std::memory_order_release);
+    if (m_thread.joinable()) {
+        m_thread.join();
+    }
+    m_file->close();
+    m_file.reset();
+    m_lanes.reset();
+}
+
+FrameRecorder::Stats FrameRecorder::stats() const
+{
+    Stats stats;
+    stats.frames = m_frames.load(std::memory_order_relaxed);
+    stats.bytesWritten = m_bytesWritten.load(std::memory_order_relaxed);
+    stats.droppedBlocks = m_droppedBlocks.load(std::memory_order_relaxed);
+    stats.droppedFrames = m_droppedFrames.load(std::memory_order_relaxed);
+    stats.bytesPerSecond = m_bytesPerSecond.load(std::memory_order_relaxed);
+    stats.writeFailed = m_writeFailed.load(std::memory_order_relaxed);
+    return stats;
+}
+
+void FrameRecorder::record(int lane, int bus, const usb_rx_frame_t& frame, int64_t hostTimeNs, bool tx)
+{
+    if (lane < 0 || lane >= kMaxLanes) {
+        return;
+    }
+    m_producers.fetch_add(1, std::memory_order_seq_cst);
+    if (!m_recording.load(std::memory_order_seq_cst)) {
+        m_producers.fetch_sub(1, std::memory_order_release);
+        return;
+    }
+
+    // The active block is ours until the writer claims it; the writer only
+    // claims while the other block is free and empty, so we move there
+    Lane& l = m_lanes[lane];
+    Block* block = &l.blocks[l.active];
+    uint64_t fill = block->fill.load(std::memory_order_acquire);
+    for (;;) {
+        if (fill & kFillClaimed) {
+            l.active ^= 1;
+            block = &l.blocks[l.active];
+            fill = block->fill.load(std::memory_order_acquire);
+            continue;
+        }
+        if (fill == 0) {
+            block->firstTimeNs.store(hostTimeNs, std::memory_order_relaxed);
+        }
+        const size_t used = fillBytes(fill);
+        const size_t size = CaptureFormat::encode(frame, bus, hostTimeNs, tx, block->data.get() + used);
+        const uint64_t next = fill + size + (uint64_t(1) << kFillFrameShift);
+        if (block->fill.compare_exchange_strong(fill, next, std::memory_order_acq_rel)) {
+            fill = next;
+            break;
+        }
+        // Claimed meanwhile; fill now holds the claimed value
+    }
+    m_frames.fetch_add(1, std::memory_order_relaxed);
+
+    const bool full = fillBytes(fill) + CaptureFormat::kMaxRecordSize > kBlockSize;
+    const int64_t firstTimeNs = block->firstTimeNs.load(std::memory_order_relaxed);
+    if (full || hostTimeNs - firstTimeNs >= kFlushAgeNs) {
+        Block& next = l.blocks[l.active ^ 1];
+        if (next.state.load(std::memory_order_acquire) == Free && next.fill.load(std::memory_order_acquire) == 0) {
+            block->state.store(Full, std::memory_order_release);
+            l.active ^= 1;
+        } else if (full && block->fill.compare_exchange_strong(fill, 0, std::memory_order_acq_rel)) {
+            // The writer still has the other block: lose this one, not the callback's time
+            m_droppedBlocks.fetch_add(1, std::memory_order_relaxed);
+            m_droppedFrames.fetch_add(fillFrames(fill), std::memory_order_relaxed);
+        }
+    }
+
+    m_producers.fetch_sub(1, std::memory_order_release);
+}
+
+void FrameRecorder::run()
+{
+    auto windowStart = std::chrono::steady_clock::now();
+    uint64_t windowBytes = m_bytesWritten.load(std::memory_order_relaxed);
+
+    while (m_running.load(std::memory_order_acquire)) {
+        const bool wroteFull = writeFullBlocks();
+        const bool wroteQuiet = claimQuietBlocks();
+        if (!wroteFull && !wroteQuiet) {
+            std::this_thread::sleep_for(kWriterPollInterval);
+        }
+
+        const auto now = std::chrono::steady_clock::now();
+        if (now - windowStart >= kRateWindow) {
+            const uint64_t bytes = m_bytesWritten.load(std::memory_order_relaxed);
+            const double seconds = std::chrono::duration<double>(now - windowStart).count();
+            m_bytesPerSecond.store(static_cast<double>(bytes - windowBytes) / seconds, std::memory_order_relaxed);
+            windowStart = now;
+            windowBytes = bytes;
+        }
+    }
+
+    // stop() has waited out the producers, so the active blocks are ours too
+    writeFullBlocks();
+    for (int i = 0; i < kMaxLanes; ++i) {
+        Lane& lane = m_lanes[i];
+        Block& block = lane.blocks[lane.active];
+        const uint64_t fill = block.fill.load(std::memory_order_acquire);
+        if (fillBytes(fill) > 0) {
+            writeBlock(block, fill);
+        }
+    }
+    writeIndex();
+}
+
+bool FrameRecorder::writeFullBlocks()
+{
+    bool wrote = false;
+    for (int i = 0; i < kMaxLanes; ++i) {
+        for (Block& block : m_lanes[i].blocks) {
+            if (block.state.load(std::memory_order_acquire) == Full) {
+                writeBlock(block, block.fill.load(std::memory_order_acquire));
+                block.state.store(Free, std::memory_order_release);
+                wrote = true;
+            }
+        }
+    }
+    return wrote;
+}
+
+bool FrameRecorder::claimQuietBlocks()
+{
+    // A free block holding frames is its lane's active one. With the other
+    // block free and empty the producer can always move on, so setting the
+    // claim flag hands the committed frames to us without waiting for it.
+    const int64_t now = std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+    bool wrote = false;
+    for (int i = 0; i < kMaxLanes; ++i) {
+        for (int b = 0; b < 2; ++b) {
+            Block& block = m_lanes[i].blocks[b];
+            const Block& other = m_lanes[i].blocks[b ^ 1];
+            uint64_t fill = block.fill.load(std::memory_order_acquire);
+            if (fill == 0 || (fill & kFillClaimed) || block.state.load(std::memory_order_acquire) != Free
+                || now - block.firstTimeNs.load(std::memory_order_relaxed) < kFlushAgeNs
+                || other.state.load(std::memory_order_acquire) != Free
+                || other.fill.load(std::memory_order_acquire) != 0) {
+                continue;
+            }
+            if (block.fill.compare_exchange_strong(fill, fill | kFillClaimed, std::memory_order_acq_rel)) {
+                writeBlock(block, fill);
+                wrote = true;
+            }
+        }
+    }
+    return wrote;
+}
+
+void FrameRecorder::writeBlock(Block& block, uint64_t fill)
+{
+    // After a failed write the rest is discarded; the flag tells the user
+    const size_t used = fillBytes(fill);
+    if (!m_writeFailed.load(std::memory_order_relaxed)) {
+        const qint64 size = static_cast<qint64>(used);
+        if (m_file->write(reinterpret_cast<const char*>(block.data.get()), size) == size) {
+            m_index.addBlock(m_writeOffset, block.data.get(), used);
+            m_writeOffset += used;
+            m_bytesWritten.fetch_add(used, std::memory_order_relaxed);
+        } else {
+            m_writeFailed.store(true, std::memory_order_relaxed);
+        }
+    }
+    block.fill.store(0, std::memory_order_release);
+}
+
+void FrameRecorder::writeIndex()
+{
+    // A file with lost writes keeps no index; readers scan what is there
+    if (m_writeFailed.load(std::memory_order_relaxed)) {
+        return;
+    }
+    const std::vector<uint8_t> footer = m_index.footer(m_writeOffset);
+    const qint64 size = static_cast<qint64>(footer.size());
+    if (m_file->write(reinterpret_cast<const char*>(footer.data()), size) == size) {
+        m_bytesWritten.fetch_add(footer.size(), std::memory_order_relaxed);
+    } else {
+        m_writeFailed.store(true, std::memory_order_relaxed);
+    }
+    m_index.clear();
+}
@@ -0,0 +1,115 @@
+#ifndef FRAME_RECORDER_H
+#define FRAME_RECORDER_H
+
+#include <QString>
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <thread>
+
+#include "pub_user.h"
+#include "capture_index.h"
+
+class QFile;
+
+// Streams every raw frame to a capture file (see capture_format.h).
+// Each producer (one SDK callback thread per lane) fills one of two blocks
+// of its lane and hands it to the writer thread when full, by flipping an
+// atomic state; recording never locks, allocates or waits on the callback.
+// When the writer has not freed the other block yet, the full one is
+// discarded and counted, so a slow disk loses whole blocks, never stalls.
+// A block whose first frame is kFlushAgeNs old is handed off by the next
+// frame of its lane, or claimed by the writer when the lane has gone quiet.
+// The writer indexes each block it writes and appends the index footer on
+// stop, so a finished capture can be opened at any time range.
+class FrameRecorder
+{
+public:
+    static constexpr int kMaxLanes = 32;
+    static constexpr size_t kBlockSize = 128 * 1024;
+
+    // A partly filled block is handed off once its first frame is this old,
+    // so a quiet bus still reaches the file within about this long
+    static constexpr int64_t kFlushAgeNs = 200000000;
+
+    struct Stats
+    {
+        uint64_t frames = 0;            // Frames accepted into blocks
+        uint64_t bytesWritten = 0;
+        uint64_t droppedBlocks = 0;
+        uint64_t droppedFrames = 0;     // Frames in dropped blocks
+        double bytesPerSecond = 0.0;    // Over the last second of writing
+        bool writeFailed = false;
+    };
+
+    FrameRecorder();
+    ~FrameRecorder();
+
+    FrameRecorder(const FrameRecorder&) = delete;
+    FrameRecorder& operator=(const FrameRecorder&) = delete;
+
+    // Create path and start the writer. Returns false with error set when
+    // the file cannot be created.
+    bool start(const QString& path, QString* error = nullptr);
+
+    // Write out everything recorded so far plus the index, and close the file
+    void stop();
+
+    bool isRecording() const { return m_recording.load(std::memory_order_relaxed); }
+    QString path() const { return m_path; }
+    Stats stats() const;
+
+    // Producer side. A lane must only be fed from one thread at a time.
+    void record(int lane, int bus, const usb_rx_frame_t& frame, int64_t hostTimeNs, bool tx);
+
+private:
+    enum BlockState : int { Free, Full };
+
+    // Block::fill packs the committed bytes, the frame count and a flag the
+    // writer sets to claim a partly filled block from a quiet lane
+    static constexpr uint64_t kFillFrameShift = 32;
+    static constexpr uint64_t kFillClaimed = uint64_t(1) << 63;
+    static size_t fillBytes(uint64_t fill) { return static_cast<size_t>(fill & 0xFFFFFFFFu); }
+    static uint32_t fillFrames(uint64_t fill) { return static_cast<uint32_t>((fill & ~kFillClaimed) >> kFillFrameShift); }
+
+    struct Block
+    {
+        std::unique_ptr<uint8_t[]> data;
+        std::atomic<uint64_t> fill{0};
+        std::atomic<int64_t> firstTimeNs{0};
+        std::atomic<int> state{Free};
+    };
+
+    struct alignas(64) Lane
+    {
+        Block blocks[2];
+        int active = 0;                 // Producer only
+    };
+
+    void run();
+    bool writeFullBlocks();
+    bool claimQuietBlocks();
+    void writeBlock(Block& block, uint64_t fill);
+    void writeIndex();
+
+    std::unique_ptr<Lane[]> m_lanes;
+    std::unique_ptr<QFile> m_file;      // Writer thread only while recording
+    CaptureIndexBuilder m_index;        // Writer thread only
+    uint64_t m_writeOffset = 0;         // Writer thread only
+    QString m_path;
+
+    std::atomic<bool> m_recording{false};
+    std::atomic<int> m_producers{0};    // Producers inside record()
+    std::atomic<bool> m_running{false};
+    std::thread m_thread;
+
+    std::atomic<uint64_t> m_frames{0};
+    std::atomic<uint64_t> m_bytesWritten{0};
+    std::atomic<uint64_t> m_droppedBlocks{0};
+    std::atomic<uint64_t> m_droppedFrames{0};
+    std::atomic<double> m_bytesPerSecond{0.0};
+    std::atomic<bool> m_writeFailed{false};
+};
+
+#endif // FRAME_RECORDER_H
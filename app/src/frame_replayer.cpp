@@ -0,0 +1,186 @@
+#include "frame_replayer.h"
+#include "capture_file.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <limits>
+#include <queue>
+#include <vector>
+
+namespace {
+constexpr int64_t kMaxSleepNs = 50000000;     // Longest sleep between stop checks
+constexpr int64_t kMinSleepNs = 200000;       // Closer deadlines are sent right away
+constexpr auto kSinkRetry = std::chrono::microseconds(50);
+
+int64_t hostNowNs()
+{
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+struct Pending
+{
+    int64_t time;
+    uint64_t order;              // File order, keeps equal times stable
+    int bus;
+    usb_rx_frame_t frame;
+};
+
+struct Later
+{
+    bool operator()(const Pending& a, const Pending& b) const
+    {
+        return a.time != b.time ? a.time > b.time : a.order > b.order;
+    }
+};
+}
+
+FrameReplayer::FrameReplayer(FrameSink sink, std::function<void()> finished)
+    : m_sink(std::move(sink))
+    , m_finished(std::move(finished))
+{
+}
+
+FrameReplayer::~FrameReplayer()
+{
+    stop();
+}
+
+bool FrameReplayer::start(const QString& path, Mode mode, double speed, QString* error)
+{
+    stop();
+
+    auto capture = std::make_unique<CaptureFile>();
+    if (!capture->open(path, error)) {
+        return false;
+    }
+
+    m_capture = std::move(capture);
+    m_frames.store(0, std::memory_order_relaxed);
+    m_skipped.store(0, std::memory_order_relaxed);
+    m_bytesRead.store(m_capture->recordsBegin(), std::memory_order_relaxed);
+    m_fileSize.store(m_capture->recordsEnd(), std::memory_order_relaxed);
+    m_startNs.store(hostNowNs(), std::memory_order_relaxed);
+    m_endNs.store(0, std::memory_order_relaxed);
+    m_truncated.store(false, std::memory_order_relaxed);
+
+    m_running.store(true, std::memory_order_release);
+    m_thread = std::thread(&FrameReplayer::run, this, mode, mode == Mode::Scaled ? std::max(speed, 1e-3) : 1.0);
+    return true;
+}
+
+void FrameReplayer::stop()
+{
+    m_running.store(false, std::memory_order_release);
+    if (m_thread.joinable()) {
+        m_thread.join();
+    }
+    m_capture.reset();
+}
+
+FrameReplayer::Stats FrameReplayer::stats() const
+{
+    Stats stats;
+    stats.frames = m_frames.load(std::memory_order_relaxed);
+    stats.skipped = m_skipped.load(std::memory_order_relaxed);
+    stats.bytesRead = m_bytesRead.load(std::memory_order_relaxed);
+    stats.fileSize = m_fileSize.load(std::memory_order_relaxed);
+    stats.truncated = m_truncated.load(std::memory_order_relaxed);
+
+    const int64_t start = m_startNs.load(std::memory_order_relaxed);
+    const int64_t end = m_endNs.load(std::memory_order_relaxed);
+    stats.elapsedSeconds = start ? static_cast<double>((end ? end : hostNowNs()) - start) * 1e-9 : 0.0;
+    stats.framesPerSecond = stats.elapsedSeconds > 0.0 ? stats.frames / stats.elapsedSeconds : 0.0;
+    return stats;
+}
+
+void FrameReplayer::run(Mode mode, double speed)
+{
+    // Records are read in file order straight from the mapping
+    const uint8_t* data = m_capture->data();
+    const uint64_t end = m_capture->recordsEnd();
+    uint64_t pos = m_capture->recordsBegin();
+
+    std::priority_queue<Pending, std::vector<Pending>, Later> pending;
+    uint64_t order = 0;
+    int64_t newest = std::numeric_limits<int64_t>::min();
+    bool endOfFile = false;
+
+    // Read the next receive record into the window; false at end of file
+    auto readNext = [&]() {
+        for (;;) {
+            CaptureRecord record;
+            if (end - pos < sizeof(record)) {
+                m_truncated.store(end > pos, std::memory_order_relaxed);
+                return false;
+            }
+            std::memcpy(&record, data + pos, sizeof(record));
+            if (end - pos < sizeof(record) + record.length || !CaptureFormat::isConsistent(record)) {
+                m_truncated.store(true, std::memory_order_relaxed);
+                return false;
+            }
+            const uint8_t* payload = data + pos + sizeof(record);
+            pos += sizeof(record) + record.length;
+            m_bytesRead.store(pos, std::memory_order_relaxed);
+
+            if (record.flags & CaptureFormat::Tx) {
+                m_skipped.fetch_add(1, std::memory_order_relaxed);
+                continue;
+            }
+            Pending next;
+            next.time = record.hostTimeNs;
+            next.order = order++;
+            next.bus = record.bus;
+            CaptureFormat::decode(record, payload, next.frame);
+            pending.push(next);
+            newest = std::max(newest, record.hostTimeNs);
+            return true;
+        }
+    };
+
+    const int64_t replayStart = hostNowNs();
+    int64_t firstTime = 0;
+    bool started = false;
+
+    while (m_running.load(std::memory_order_acquire)) {
+        while (!endOfFile && (pending.empty() || newest - pending.top().time < kReorderWindowNs)) {
+            endOfFile = !readNext();
+        }
+        if (pending.empty()) {
+            break;
+        }
+        const Pending next = pending.top();
+        pending.pop();
+
+        if (!started) {
+            firstTime = next.time;
+            started = true;
+        }
+        const int64_t offset = next.time - firstTime;
+
+        if (mode != Mode::Unpaced) {
+            const int64_t due = replayStart + static_cast<int64_t>(offset / speed);
+            int64_t wait = due - hostNowNs();
+            while (wait > kMinSleepNs && m_running.load(std::memory_order_acquire)) {
+                std::this_thread::sleep_for(std::chrono::nanoseconds(std::min(wait, kMaxSleepNs)));
+                wait = due - hostNowNs();
+            }
+        }
+
+        // Host times keep the recorded spacing at any speed
+        bool delivered = m_sink(next.bus, next.frame, replayStart + offset);
+        while (!delivered && m_running.load(std::memory_order_acquire)) {
+            std::this_thread::sleep_for(kSinkRetry);
+            delivered = m_sink(next.bus, next.frame, replayStart + offset);
+        }
+        if (delivered) {
+            m_frames.fetch_add(1, std::memory_order_relaxed);
+        }
+    }
+
+    m_endNs.store(hostNowNs(), std::memory_order_relaxed);
+    if (m_running.exchange(false, std::memory_order_acq_rel) && m_finished) {
+        m_finished();
+    }
+}
@@ -0,0 +1,83 @@
+#ifndef FRAME_REPLAYER_H
+#define FRAME_REPLAYER_H
+
+#include <QString>
+
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <thread>
+
+#include "pub_user.h"
+
+class CaptureFile;
+
+// Plays a capture file (see capture_format.h) back into a frame sink on its
+// own thread, paced by the recorded host times. The recorder writes each
+// bus's blocks as they fill, so records are put back in time order within
+// a short reorder window first. TX echoes are skipped: live, they never
+// reach the decoders either. The file is read through a memory mapping.
+class FrameReplayer
+{
+public:
+    enum class Mode
+    {
+        RealTime,   // Recorded spacing
+        Scaled,     // Recorded spacing divided by the speed factor
+        Unpaced     // As fast as the sink accepts frames
+    };
+
+    // Receives each frame with its host time on the replay timeline, which
+    // keeps the recorded spacing whatever the mode. Returning false means
+    // the sink is full; the frame is offered again shortly.
+    using FrameSink = std::function<bool(int bus, const usb_rx_frame_t& frame, int64_t hostTimeNs)>;
+
+    // Records may appear this far out of time order in a capture
+    static constexpr int64_t kReorderWindowNs = 1000000000;
+
+    struct Stats
+    {
+        uint64_t frames = 0;            // Handed to the sink
+        uint64_t skipped = 0;           // TX echoes
+        uint64_t bytesRead = 0;
+        uint64_t fileSize = 0;          // Up to the end of the records
+        double elapsedSeconds = 0.0;
+        double framesPerSecond = 0.0;   // Over the whole replay so far
+        bool truncated = false;         // File ended inside a record
+    };
+
+    // finished runs on the replay thread when the end of the file is reached
+    FrameReplayer(FrameSink sink, std::function<void()> finished);
+    ~FrameReplayer();
+
+    FrameReplayer(const FrameReplayer&) = delete;
+    FrameReplayer& operator=(const FrameReplayer&) = delete;
+
+    // Open path and start playing. speed only applies to Mode::Scaled.
+    bool start(const QString& path, Mode mode, double speed = 1.0, QString* error = nullptr);
+    void stop();
+
+    bool isRunning() const { return m_running.load(std::memory_order_relaxed); }
+    Stats stats() const;
+
+private:
+    void run(Mode mode, double speed);
+
+    FrameSink m_sink;
+    std::function<void()> m_finished;
+    std::unique_ptr<CaptureFile> m_capture;   // Replay thread only while running
+
+    std::atomic<bool> m_running{false};
+    std::thread m_thread;
+
+    std::atomic<uint64_t> m_frames{0};
+    std::atomic<uint64_t> m_skipped{0};
+    std::atomic<uint64_t> m_bytesRead{0};
+    std::atomic<uint64_t> m_fileSize{0};
+    std::atomic<int64_t> m_startNs{0};
+    std::atomic<int64_t> m_endNs{0};    // 0 while playing
+    std::atomic<bool> m_truncated{false};
+};
+
+#endif // FRAME_REPLAYER_H
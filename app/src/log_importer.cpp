@@ -0,0 +1,679 @@
+#include "log_importer.h"
+#include "capture_file.h"
+#include "frame_recorder.h"
+
+#include <QFile>
+#include <QFileInfo>
+#include <QThread>
+
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+
+namespace {
+constexpr uint64_t kChunkBytes = 8 << 20;   // Log bytes per chunk
+constexpr size_t kSniffBytes = 64 * 1024;   // Searched for the format
+constexpr uint32_t kBlockFrames = 4096;     // Keeps a block's CAN IDs within summaryCount
+constexpr int kMaxBus = 255;                // CaptureRecord::bus is a uint8_t
+constexpr int kLaneCount = 2 * (kMaxBus + 1);
+
+int64_t hostNowNs()
+{
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+int hexDigit(char c)
+{
+    if (c >= '0' && c <= '9') {
+        return c - '0';
+    }
+    c = static_cast<char>(c | 0x20);
+    return c >= 'a' && c <= 'f' ? c - 'a' + 10 : -1;
+}
+
+bool isDigit(char c)
+{
+    return c >= '0' && c <= '9';
+}
+
+bool isSpace(char c)
+{
+    return c == ' ' || c == '\t';
+}
+
+const char* skipSpaces(const char* p, const char* end)
+{
+    while (p < end && isSpace(*p)) {
+        ++p;
+    }
+    return p;
+}
+
+bool atTokenEnd(const char* p, const char* end)
+{
+    return p == end || isSpace(*p);
+}
+
+bool startsWith(const char* p, const char* end, const char* word)
+{
+    const size_t length = std::strlen(word);
+    return static_cast<size_t>(end - p) >= length && std::memcmp(p, word, length) == 0;
+}
+
+// Seconds with up to nanosecond resolution, e.g. "1436509052.249713"
+bool parseSeconds(const char*& p, const char* end, int64_t& ns)
+{
+    const char* start = p;
+    int64_t seconds = 0;
+    while (p < end && isDigit(*p) && p - start < 11) {
+        seconds = seconds * 10 + (*p++ - '0');
+    }
+    if (p == start) {
+        return false;
+    }
+    int64_t fraction = 0;
+    int64_t scale = 1000000000;
+    if (p < end && *p == '.') {
+        ++p;
+        for (; p < end && isDigit(*p); ++p) {
+            if (scale > 1) {
+                scale /= 10;
+                fraction += (*p - '0') * scale;
+            }
+        }
+    }
+    ns = seconds * 1000000000 + fraction;
+    return atTokenEnd(p, end) || *p == ')';
+}
+
+// A whole token of at most 8 hex or 10 decimal digits
+bool parseNumber(const char*& p, const char* end, bool decimal, uint32_t& value)
+{
+    const char* start = p;
+    uint64_t result = 0;
+    for (; p < end && p - start < (decimal ? 10 : 8); ++p) {
+        const int digit = decimal ? (isDigit(*p) ? *p - '0' : -1) : hexDigit(*p);
+        if (digit < 0) {
+            break;
+        }
+        result = result * (decimal ? 10 : 16) + digit;
+    }
+    value = static_cast<uint32_t>(result);
+    return p > start && result <= 0xFFFFFFFFu;
+}
+
+// DLC of a payload length, -1 when no DLC carries it
+int dlcForLength(int length, bool canfd)
+{
+    if (length <= 8) {
+        return length;
+    }
+    if (!canfd) {
+        return -1;
+    }
+    static constexpr uint8_t kFdLengths[] = {12, 16, 20, 24, 32, 48, 64};
+    for (int i = 0; i < 7; ++i) {
+        if (kFdLengths[i] == length) {
+            return 9 + i;
+        }
+    }
+    return -1;
+}
+}
+
+LogImporter::LogImporter(std::function<void()> finished)
+    : m_finished(std::move(finished))
+{
+    // Leave a core to the receive path and keep below it in priority
+    m_pool.setMaxThreadCount(std::max(1, QThread::idealThreadCount() - 1));
+    m_pool.setThreadPriority(QThread::LowPriority);
+}
+
+LogImporter::~LogImporter()
+{
+    cancel();
+    if (m_thread.joinable()) {
+        m_thread.join();
+    }
+}
+
+bool LogImporter::isLog(const QString& path)
+{
+    return path.endsWith(QStringLiteral(".log"), Qt::CaseInsensitive)
+           || path.endsWith(QStringLiteral(".asc"), Qt::CaseInsensitive);
+}
+
+QString LogImporter::capturePathFor(const QString& logPath)
+{
+    return logPath + QStringLiteral(".dmcap");
+}
+
+bool LogImporter::isImported(const QString& logPath, const QString& capturePath)
+{
+    // An import writes the footer last, so an indexed capture is complete
+    const QFileInfo log(logPath);
+    const QFileInfo capture(capturePath);
+    if (!capture.exists() || capture.lastModified() < log.lastModified()) {
+        return false;
+    }
+    CaptureFile file;
+    return file.open(capturePath) && file.isIndexed();
+}
+
+bool LogImporter::start(const QString& logPath, const QString& capturePath, QString* error)
+{
+    auto fail = [&](const QString& message) {
+        if (error) {
+            *error = message;
+        }
+        return false;
+    };
+    if (isRunning()) {
+        return fail(QStringLiteral("An import is already running"));
+    }
+    if (m_thread.joinable()) {
+        m_thread.join();
+    }
+
+    auto log = std::make_unique<QFile>(logPath);
+    if (!log->open(QIODevice::ReadOnly)) {
+        return fail(log->errorString());
+    }
+    const qint64 size = log->size();
+    if (size <= 0) {
+        return fail(QStringLiteral("The log is empty"));
+    }
+    const char* data = reinterpret_cast<const char*>(log->map(0, size));
+    if (!data) {
+        return fail(log->errorString());
+    }
+
+    // The format and, for ASC, the number base come from the first lines
+    bool known = false;
+    const char* sniffEnd = data + std::min<uint64_t>(static_cast<uint64_t>(size), kSniffBytes);
+    for (const char* line = data; line < sniffEnd && !known;) {
+        const char* eol = static_cast<const char*>(std::memchr(line, '\n', sniffEnd - line));
+        eol = eol ? eol : sniffEnd;
+        const char* p = skipSpaces(line, eol);
+        if (p < eol && *p == '(') {
+            m_format = Format::CanDump;
+            known = true;
+        } else if (startsWith(p, eol, "base ")) {
+            const char* base = skipSpaces(p + 5, eol);
+            static constexpr char kRelative[] = "relative";
+            if (std::search(p, eol, kRelative, kRelative + sizeof(kRelative) - 1) != eol) {
+                return fail(QStringLiteral("ASC logs with relative time stamps are not supported"));
+            }
+            m_format = Format::Asc;
+            m_decimal = startsWith(base, eol, "dec");
+            known = true;
+        }
+        line = eol + 1;
+    }
+    if (!known) {
+        return fail(QStringLiteral("Neither a candump -l nor a Vector ASC log"));
+    }
+
+    auto capture = std::make_unique<QFile>(capturePath);
+    if (!capture->open(QIODevice::WriteOnly | QIODevice::Truncate | QIODevice::Unbuffered)) {
+        return fail(capture->errorString());
+    }
+
+    // Chunks end after a newline, so no line is split between two
+    m_bounds.assign(1, 0);
+    for (uint64_t pos = 0; pos < static_cast<uint64_t>(size);) {
+        uint64_t next = pos + kChunkBytes;
+        if (next >= static_cast<uint64_t>(size)) {
+            next = static_cast<uint64_t>(size);
+        } else {
+            const void* newline = std::memchr(data + next, '\n', static_cast<size_t>(size - next));
+            next = newline ? static_cast<const char*>(newline) - data + 1 : static_cast<uint64_t>(size);
+        }
+        m_bounds.push_back(next);
+        pos = next;
+    }
+
+    m_log = std::move(log);
+    m_capture = std::move(capture);
+    m_logPath = logPath;
+    m_capturePath = capturePath;
+    m_data = data;
+    m_size = static_cast<uint64_t>(size);
+    m_window = 2 * std::max(1, m_pool.maxThreadCount());
+    m_slots.assign(m_window, Slot());
+    m_index.clear();
+    m_writeOffset = 0;
+    {
+        std::lock_guard<std::mutex> lock(m_errorMutex);
+        m_error.clear();
+    }
+
+    m_frames.store(0, std::memory_order_relaxed);
+    m_skipped.store(0, std::memory_order_relaxed);
+    m_bytesRead.store(0, std::memory_order_relaxed);
+    m_startNs.store(hostNowNs(), std::memory_order_relaxed);
+    m_endNs.store(0, std::memory_order_relaxed);
+    m_failed.store(false, std::memory_order_relaxed);
+    m_cancel.store(false, std::memory_order_relaxed);
+
+    m_running.store(true, std::memory_order_release);
+    m_thread = std::thread(&LogImporter::run, this);
+    return true;
+}
+
+void LogImporter::cancel()
+{
+    m_cancel.store(true, std::memory_order_relaxed);
+}
+
+QString LogImporter::errorString() const
+{
+    std::lock_guard<std::mutex> lock(m_errorMutex);
+    return m_error;
+}
+
+LogImporter::Stats LogImporter::stats() const
+{
+    Stats stats;
+    stats.frames = m_frames.load(std::memory_order_relaxed);
+    stats.skippedLines = m_skipped.load(std::memory_order_relaxed);
+    stats.bytesRead = m_bytesRead.load(std::memory_order_relaxed);
+    stats.fileSize = m_size;
+    stats.failed = m_failed.load(std::memory_order_relaxed);
+    stats.cancelled = m_cancel.load(std::memory_order_relaxed);
+
+    const int64_t start = m_startNs.load(std::memory_order_relaxed);
+    const int64_t end = m_endNs.load(std::memory_order_relaxed);
+    stats.elapsedSeconds = start ? static_cast<double>((end ? end : hostNowNs()) - start) * 1e-9 : 0.0;
+    stats.bytesPerSecond = stats.elapsedSeconds > 0.0 ? stats.bytesRead / stats.elapsedSeconds : 0.0;
+    return stats;
+}
+
+void LogImporter::run()
+{
+    const CaptureFileHeader header = CaptureFormat::fileHeader();
+    bool ok = write(&header, sizeof(header));
+    const int chunkCount = static_cast<int>(m_bounds.size()) - 1;
+
+    // Chunk i + window is only handed out once chunk i has been written,
+    // which bounds the memory held by parsed chunks
+    int submitted = 0;
+    for (int next = 0; ok && next < chunkCount && !m_cancel.load(std::memory_order_relaxed); ++next) {
+        while (submitted < chunkCount && submitted < next + m_window) {
+            submit(submitted++);
+        }
+
+        Slot& slot = m_slots[next % m_window];
+        {
+            std::unique_lock<std::mutex> lock(m_slotMutex);
+            m_slotReady.wait(lock, [&slot]() { return slot.ready; });
+            slot.ready = false;
+        }
+        if (m_cancel.load(std::memory_order_relaxed)) {
+            break;
+        }
+
+        // The slot is not handed out again before the next round
+        const uint64_t offset = m_writeOffset;
+        ok = write(slot.records.data(), slot.records.size());
+        m_index.append(slot.index, offset);
+        m_frames.fetch_add(slot.frames, std::memory_order_relaxed);
+        m_skipped.fetch_add(slot.skipped, std::memory_order_relaxed);
+        m_bytesRead.store(m_bounds[next + 1], std::memory_order_relaxed);
+    }
+
+    // Chunks still being parsed read the mapping
+    m_pool.waitForDone();
+
+    const bool complete = ok && !m_cancel.load(std::memory_order_relaxed);
+    if (complete) {
+        const std::vector<uint8_t> footer = m_index.footer(m_writeOffset);
+        ok = write(footer.data(), footer.size());
+    }
+    m_capture->close();
+    m_capture.reset();
+    if (!complete || !ok) {
+        QFile::remove(m_capturePath);
+    }
+    m_log->unmap(reinterpret_cast<uchar*>(const_cast<char*>(m_data)));
+    m_log->close();
+    m_log.reset();
+    m_data = nullptr;
+    m_slots.clear();
+    m_index.clear();
+
+    m_endNs.store(hostNowNs(), std::memory_order_relaxed);
+    m_running.store(false, std::memory_order_release);
+    if (m_finished) {
+        m_finished();
+    }
+}
+
+void LogImporter::submit(int index)
+{
+    m_pool.start([this, index]() {
+        Slot& slot = m_slots[index % m_window];
+        slot.records.clear();
+        slot.index.clear();
+        slot.frames = 0;
+        slot.skipped = 0;
+        if (!m_cancel.load(std::memory_order_relaxed)) {
+            parseChunk(m_data + m_bounds[index], m_data + m_bounds[index + 1], slot);
+        }
+
+        std::lock_guard<std::mutex> lock(m_slotMutex);
+        slot.ready = true;
+        m_slotReady.notify_all();
+    });
+}
+
+void LogImporter::parseChunk(const char* begin, const char* end, Slot& slot) const
+{
+    if (slot.lanes.empty()) {
+        slot.lanes.resize(kLaneCount);
+    }
+
+    uint8_t payload[64];
+    for (const char* line = begin; line < end;) {
+        const char* eol = static_cast<const char*>(std::memchr(line, '\n', end - line));
+        eol = eol ? eol : end;
+        const char* last = (eol > line && eol[-1] == '\r') ? eol - 1 : eol;
+
+        CaptureRecord record;
+        const bool parsed = m_format == Format::CanDump ? parseCanDumpLine(line, last, record, payload)
+                                                        : parseAscLine(line, last, record, payload);
+        if (parsed) {
+            addRecord(slot, record, payload);
+        } else if (skipSpaces(line, last) != last) {
+            ++slot.skipped;
+        }
+        line = eol + 1;
+    }
+
+    // What is left goes out oldest first
+    std::sort(slot.openLanes.begin(), slot.openLanes.end(), [&slot](int a, int b) {
+        return slot.lanes[a].firstTimeNs < slot.lanes[b].firstTimeNs;
+    });
+    while (!slot.openLanes.empty()) {
+        flushLane(slot, slot.openLanes.front());
+    }
+}
+
+bool LogImporter::parseCanDumpLine(const char* p, const char* end, CaptureRecord& record, uint8_t* payload) const
+{
+    // (seconds.fraction) interface id#data [T|R]
+    p = skipSpaces(p, end);
+    int64_t time = 0;
+    if (p == end || *p != '(') {
+        return false;
+    }
+    ++p;
+    if (!parseSeconds(p, end, time) || p == end || *p != ')') {
+        return false;
+    }
+    p = skipSpaces(p + 1, end);
+    const char* name = p;
+    while (p < end && !isSpace(*p)) {
+        ++p;
+    }
+    const char* digits = p;
+    while (digits > name && isDigit(digits[-1])) {
+        --digits;
+    }
+    int bus = 0;
+    for (const char* d = digits; d < p; ++d) {
+        bus = bus * 10 + (*d - '0');
+        if (bus > kMaxBus) {
+            return false;
+        }
+    }
+
+    // Three digits for a standard ID, eight for an extended one; error
+    // frames carry CAN_ERR_FLAG in the top bits and are left out
+    p = skipSpaces(p, end);
+    const char* id = p;
+    uint32_t canId = 0;
+    if (!parseNumber(p, end, false, canId) || p == end || *p != '#' || (canId & 0xE0000000u)) {
+        return false;
+    }
+    uint8_t flags = p - id > 3 ? CaptureFormat::Ext : 0;
+    ++p;
+
+    bool canfd = false;
+    bool rtr = false;
+    int dlc = -1;
+    if (p < end && *p == '#') {
+        // CAN FD: one hex digit of BRS / ESI flags, then the data
+        const int fdFlags = p + 1 < end ? hexDigit(p[1]) : -1;
+        if (fdFlags < 0) {
+            return false;
+        }
+        canfd = true;
+        flags |= CaptureFormat::CanFd | ((fdFlags & 0x1) ? CaptureFormat::Brs : 0)
+                 | ((fdFlags & 0x2) ? CaptureFormat::Esi : 0);
+        p += 2;
+    } else if (p < end && *p == 'R') {
+        rtr = true;
+        flags |= CaptureFormat::Rtr;
+        dlc = 0;
+        if (++p < end && isDigit(*p) && *p <= '8') {
+            dlc = *p++ - '0';
+        }
+    }
+
+    int length = 0;
+    while (!rtr && p + 1 < end && hexDigit(p[0]) >= 0 && hexDigit(p[1]) >= 0) {
+        if (length == 64) {
+            return false;
+        }
+        payload[length++] = static_cast<uint8_t>(hexDigit(p[0]) << 4 | hexDigit(p[1]));
+        p += 2;
+        if (p < end && *p == '.') {
+            ++p;
+        }
+    }
+    if (!rtr) {
+        dlc = dlcForLength(length, canfd);
+        if (dlc < 0) {
+            return false;
+        }
+    }
+    // Classic frames of 8 bytes may give a DLC of 9 to 15 as _X
+    if (!canfd && p + 1 < end && *p == '_') {
+        const int raw = hexDigit(p[1]);
+        if (raw < 9 || dlc != 8) {
+            return false;
+        }
+        dlc = raw;
+        p += 2;
+    }
+    if (!atTokenEnd(p, end)) {
+        return false;
+    }
+    p = skipSpaces(p, end);
+    if (p < end && *p == 'T') {
+        flags |= CaptureFormat::Tx;
+    }
+
+    record.hostTimeNs = time;
+    record.deviceTime = 0;
+    record.canId = canId & 0x1FFFFFFF;
+    record.bus = static_cast<uint8_t>(bus);
+    record.flags = flags;
+    record.dlc = static_cast<uint8_t>(dlc);
+    record.length = static_cast<uint8_t>(rtr ? 0 : length);
+    return true;
+}
+
+bool LogImporter::parseAscLine(const char* p, const char* end, CaptureRecord& record, uint8_t* payload) const
+{
+    // time channel id[x] Rx|Tx d dlc bytes...
+    // time CANFD channel Rx|Tx id[x] [name] brs esi dlc length bytes...
+    p = skipSpaces(p, end);
+    int64_t time = 0;
+    if (!parseSeconds(p, end, time)) {
+        return false;
+    }
+    p = skipSpaces(p, end);
+    const bool canfd = startsWith(p, end, "CANFD") && atTokenEnd(p + 5, end);
+    if (canfd) {
+        p = skipSpaces(p + 5, end);
+    }
+    uint32_t channel = 0;
+    if (!parseNumber(p, end, true, channel) || !atTokenEnd(p, end) || channel < 1 || channel > kMaxBus + 1) {
+        return false;
+    }
+
+    uint8_t flags = canfd ? CaptureFormat::CanFd : 0;
+    uint32_t canId = 0;
+    auto readId = [&]() {
+        p = skipSpaces(p, end);
+        if (!parseNumber(p, end, m_decimal, canId)) {
+            return false;
+        }
+        if (p < end && *p == 'x') {
+            flags |= CaptureFormat::Ext;
+            ++p;
+        }
+        return atTokenEnd(p, end) && canId <= 0x1FFFFFFF;
+    };
+    auto readDirection = [&]() {
+        p = skipSpaces(p, end);
+        if (startsWith(p, end, "Tx")) {
+            flags |= CaptureFormat::Tx;
+        } else if (!startsWith(p, end, "Rx")) {
+            return false;
+        }
+        p += 2;
+        return atTokenEnd(p, end);
+    };
+    auto readValue = [&](bool decimal, uint32_t& value) {
+        p = skipSpaces(p, end);
+        return parseNumber(p, end, decimal, value) && atTokenEnd(p, end);
+    };
+    if (canfd ? !(readDirection() && readId()) : !(readId() && readDirection())) {
+        return false;
+    }
+
+    uint32_t dlc = 0;
+    uint32_t length = 0;
+    if (canfd) {
+        // The symbolic name is optional; BRS and ESI are single 0/1 digits
+        uint32_t brs = 0;
+        uint32_t esi = 0;
+        p = skipSpaces(p, end);
+        if (p == end) {
+            return false;
+        }
+        if (!((*p == '0' || *p == '1') && atTokenEnd(p + 1, end))) {
+            while (p < end && !isSpace(*p)) {
+                ++p;
+            }
+        }
+        if (!readValue(true, brs) || !readValue(true, esi) || !readValue(false, dlc) || !readValue(true, length)
+            || brs > 1 || esi > 1 || dlc > 0xF
+            || length != static_cast<uint32_t>(CaptureFormat::payloadLength(static_cast<uint8_t>(dlc), true))) {
+            return false;
+        }
+        flags |= (brs ? CaptureFormat::Brs : 0) | (esi ? CaptureFormat::Esi : 0);
+    } else {
+        p = skipSpaces(p, end);
+        if (p == end || (*p != 'd' && *p != 'r') || !atTokenEnd(p + 1, end)) {
+            return false;
+        }
+        const bool rtr = *p++ == 'r';
+        if (rtr) {
+            // The DLC of a remote frame is optional
+            flags |= CaptureFormat::Rtr;
+            const char* q = skipSpaces(p, end);
+            uint32_t value = 0;
+            if (parseNumber(q, end, false, value) && atTokenEnd(q, end)) {
+                dlc = value;
+                p = q;
+            }
+        } else if (!readValue(false, dlc)) {
+            return false;
+        }
+        if (dlc > 0xF) {
+            return false;
+        }
+        length = rtr ? 0 : static_cast<uint32_t>(CaptureFormat::payloadLength(static_cast<uint8_t>(dlc), false));
+    }
+
+    for (uint32_t i = 0; i < length; ++i) {
+        uint32_t value = 0;
+        if (!readValue(m_decimal, value) || value > 0xFF) {
+            return false;
+        }
+        payload[i] = static_cast<uint8_t>(value);
+    }
+
+    record.hostTimeNs = time;
+    record.deviceTime = 0;
+    record.canId = canId;
+    record.bus = static_cast<uint8_t>(channel - 1);
+    record.flags = flags;
+    record.dlc = static_cast<uint8_t>(dlc);
+    record.length = static_cast<uint8_t>(length);
+    return true;
+}
+
+void LogImporter::addRecord(Slot& slot, const CaptureRecord& record, const uint8_t* payload)
+{
+    // Blocks follow the recorder's rules: one lane, time order, and a lane
+    // that has gone quiet is closed, so the file stays near time order
+    for (size_t i = 0; i < slot.openLanes.size();) {
+        const int open = slot.openLanes[i];
+        if (record.hostTimeNs - slot.lanes[open].firstTimeNs >= FrameRecorder::kFlushAgeNs) {
+            flushLane(slot, open);
+        } else {
+            ++i;
+        }
+    }
+    const int index = record.bus * 2 + ((record.flags & CaptureFormat::Tx) ? 1 : 0);
+    Lane& lane = slot.lanes[index];
+    if (lane.frames > 0 && (record.hostTimeNs < lane.lastTimeNs || lane.frames >= kBlockFrames)) {
+        flushLane(slot, index);
+    }
+    if (lane.frames == 0) {
+        lane.firstTimeNs = record.hostTimeNs;
+        slot.openLanes.push_back(index);
+    }
+    lane.lastTimeNs = record.hostTimeNs;
+    ++lane.frames;
+    ++slot.frames;
+
+    const uint8_t* bytes = reinterpret_cast<const uint8_t*>(&record);
+    lane.data.insert(lane.data.end(), bytes, bytes + sizeof(record));
+    lane.data.insert(lane.data.end(), payload, payload + record.length);
+}
+
+void LogImporter::flushLane(Slot& slot, int index)
+{
+    Lane& lane = slot.lanes[index];
+    const uint64_t offset = slot.records.size();
+    slot.records.insert(slot.records.end(), lane.data.begin(), lane.data.end());
+    slot.index.addBlock(offset, slot.records.data() + offset, lane.data.size());
+    lane.data.clear();
+    lane.frames = 0;
+    slot.openLanes.erase(std::find(slot.openLanes.begin(), slot.openLanes.end(), index));
+}
+
+bool LogImporter::write(const void* data, size_t size)
+{
+    const qint64 bytes = static_cast<qint64>(size);
+    if (m_capture->write(static_cast<const char*>(data), bytes) != bytes) {
+        fail(m_capture->errorString());
+        return false;
+    }
+    m_writeOffset += size;
+    return true;
+}
+
+void LogImporter::fail(const QString& error)
+{
+    std::lock_guard<std::mutex> lock(m_errorMutex);
+    m_error = error;
+    m_failed.store(true, std::memory_order_relaxed);
+}
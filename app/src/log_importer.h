@@ -0,0 +1,152 @@
+#ifndef LOG_IMPORTER_H
+#define LOG_IMPORTER_H
+
+#include <QString>
+#include <QThreadPool>
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "capture_index.h"
+
+class QFile;
+
+// Converts CAN logs of other tools into an indexed capture file (see
+// capture_format.h), which the replayer and the dashboard then read like a
+// recording of this tool:
+//   candump -l   "(1436509052.249713) can0 123#DEADBEEF", CAN FD "##"
+//                frames included; the bus is the interface's number
+//   Vector ASC   classic and CANFD lines of "base hex" or "base dec" logs
+//                with absolute time stamps; channel n is bus n - 1
+// The log is mapped and cut into chunks at line boundaries. A low-priority
+// worker pool parses the chunks in place, into buffers that are reused
+// from chunk to chunk, and the import thread writes them out in order.
+// Lines without a frame (headers, comments, error frames, events) are
+// counted and skipped.
+class LogImporter
+{
+public:
+    enum class Format
+    {
+        CanDump,
+        Asc
+    };
+
+    struct Stats
+    {
+        uint64_t frames = 0;
+        uint64_t skippedLines = 0;
+        uint64_t bytesRead = 0;         // Of the log, in chunks written out
+        uint64_t fileSize = 0;
+        double elapsedSeconds = 0.0;
+        double bytesPerSecond = 0.0;    // Log bytes over the whole import so far
+        bool failed = false;
+        bool cancelled = false;
+    };
+
+    // finished runs on the import thread once the capture is complete or abandoned
+    explicit LogImporter(std::function<void()> finished);
+    ~LogImporter();
+
+    LogImporter(const LogImporter&) = delete;
+    LogImporter& operator=(const LogImporter&) = delete;
+
+    // Whether path names a log (.log or .asc) rather than a capture
+    static bool isLog(const QString& path);
+
+    // The capture a log is imported to: next to it, with .dmcap appended
+    static QString capturePathFor(const QString& logPath);
+
+    // Whether capturePath is a complete import of the log's current contents
+    static bool isImported(const QString& logPath, const QString& capturePath);
+
+    // Map logPath, create capturePath and start converting. Returns false
+    // with error set when either file cannot be opened or the log is not
+    // in a supported format.
+    bool start(const QString& logPath, const QString& capturePath, QString* error = nullptr);
+
+    // Stop early; the incomplete capture is removed
+    void cancel();
+
+    bool isRunning() const { return m_running.load(std::memory_order_relaxed); }
+    QString logPath() const { return m_logPath; }
+    QString capturePath() const { return m_capturePath; }
+    QString errorString() const;
+    Stats stats() const;
+
+private:
+    // Open block of one bus and direction while a chunk is parsed
+    struct Lane
+    {
+        std::vector<uint8_t> data;
+        uint32_t frames = 0;
+        int64_t firstTimeNs = 0;
+        int64_t lastTimeNs = 0;
+    };
+
+    // One chunk's records in blocks, with their index. Chunk i uses slot
+    // i % m_window, whose buffers keep their capacity for the next chunk.
+    struct Slot
+    {
+        std::vector<uint8_t> records;
+        CaptureIndexBuilder index;      // Offsets relative to records
+        std::vector<Lane> lanes;        // By bus * 2 + tx
+        std::vector<int> openLanes;
+        uint64_t frames = 0;
+        uint64_t skipped = 0;
+        bool ready = false;
+    };
+
+    void run();
+    void submit(int index);
+    void parseChunk(const char* begin, const char* end, Slot& slot) const;
+    bool parseCanDumpLine(const char* p, const char* end, CaptureRecord& record, uint8_t* payload) const;
+    bool parseAscLine(const char* p, const char* end, CaptureRecord& record, uint8_t* payload) const;
+    static void addRecord(Slot& slot, const CaptureRecord& record, const uint8_t* payload);
+    static void flushLane(Slot& slot, int lane);
+    bool write(const void* data, size_t size);
+    void fail(const QString& error);
+
+    std::function<void()> m_finished;
+    QThreadPool m_pool;
+    std::unique_ptr<QFile> m_log;
+    std::unique_ptr<QFile> m_capture;   // Import thread only while running
+    QString m_logPath;
+    QString m_capturePath;
+    const char* m_data = nullptr;       // Mapped log
+    uint64_t m_size = 0;
+
+    Format m_format = Format::CanDump;
+    bool m_decimal = false;             // ASC "base dec"
+    std::vector<uint64_t> m_bounds;     // Chunk i is [m_bounds[i], m_bounds[i + 1])
+    int m_window = 0;                   // Chunks in flight at most
+
+    std::mutex m_slotMutex;
+    std::condition_variable m_slotReady;
+    std::vector<Slot> m_slots;
+
+    CaptureIndexBuilder m_index;        // Import thread only
+    uint64_t m_writeOffset = 0;         // Import thread only
+
+    std::atomic<bool> m_running{false};
+    std::atomic<bool> m_cancel{false};
+    std::thread m_thread;
+
+    mutable std::mutex m_errorMutex;
+    QString m_error;
+
+    std::atomic<uint64_t> m_frames{0};
+    std::atomic<uint64_t> m_skipped{0};
+    std::atomic<uint64_t> m_bytesRead{0};
+    std::atomic<int64_t> m_startNs{0};
+    std::atomic<int64_t> m_endNs{0};    // 0 while importing
+    std::atomic<bool> m_failed{false};
+};
+
+#endif // LOG_IMPORTER_H
@@ -1,9 +1,12 @@
 #include "main_window.h"
+#include "command_plan.h"
 #include "motor_profile_loader.h"
+#include "receive_table_model.h"
 #include "telemetry_data_store.h"
 #include "telemetry_dashboard.h"
 
 #include <QApplication>
+#include <QFileDialog>
 #include <QGridLayout>
 #include <QGroupBox>
 #include <QHeaderView>
@@ -14,23 +17,30 @@
 namespace {
 constexpr int kGroupCount = 2;
 constexpr int kMotorsPerGroup = 4;
-constexpr int kMotorCount = 8;
 }
 
 MainWindow::MainWindow(QWidget* parent)
     : QMainWindow(parent)
     , m_device(new DmDeviceWrapper(this))
+    , m_importer([this]() {
+        QMetaObject::invokeMethod(this, &MainWindow::finishImport, Qt::QueuedConnection);
+    })
+    , m_exporter([this]() {
+        QMetaObject::invokeMethod(this, &MainWindow::finishExport, Qt::QueuedConnection);
+    })
     , m_dataStore(new TelemetryDataStore(this))
 {
     setWindowTitle(QStringLiteral("DM CAN Control"));
 
     // Load profiles
     loadProfiles();
+    m_dataStore->setActiveProfile(m_activeProfile);
 
     QWidget* root = new QWidget(this);
     QVBoxLayout* layout = new QVBoxLayout(root);
 
     layout->addWidget(buildConnectionBar());
+    layout->addWidget(buildCaptureBar());
 
     // Create tab widget
     m_tabWidget = new QTabWidget(this);
@@ -47,8 +57,25 @@ MainWindow::MainWindow(QWidget* parent)
     setCentralWidget(root);
 
     connect(m_device, &DmDeviceWrapper::deviceStatusChanged, this, &MainWindow::updateStatus);
-    connect(m_device, &DmDeviceWrapper::motorUpdated, this, &MainWindow::updateMotorRow);
-    connect(m_device, &DmDeviceWrapper::motorUpdated, m_dataStore, &TelemetryDataStore::onMotorUpdated);
+    connect(m_device, &DmDeviceWrapper::motorsUpdated, m_receiveModel, &ReceiveTableModel::onMotorsUpdated);
+    connect(m_device, &DmDeviceWrapper::motorsUpdated, m_dataStore, &TelemetryDataStore::onMotorsUpdated);
+
+    m_txStatsTimer = new QTimer(this);
+    m_txStatsTimer->setInterval(500);
+    connect(m_txStatsTimer, &QTimer::timeout, this, &MainWindow::updateTxStats);
+
+    m_recordStatsTimer = new QTimer(this);
+    m_recordStatsTimer->setInterval(500);
+    connect(m_recordStatsTimer, &QTimer::timeout, this, &MainWindow::updateRecordStats);
+
+    m_replayStatsTimer = new QTimer(this);
+    m_replayStatsTimer->setInterval(500);
+    connect(m_replayStatsTimer, &QTimer::timeout, this, &MainWindow::updateReplayStats);
+    connect(m_device, &DmDeviceWrapper::replayFinished, this, &MainWindow::finishReplay);
+
+    m_exportStatsTimer = new QTimer(this);
+    m_exportStatsTimer->setInterval(500);
+    connect(m_exportStatsTimer, &QTimer::timeout, this, &MainWindow::updateExportStats);
 }
 
 void MainWindow::loadProfiles()
@@ -72,18 +99,17 @@ void MainWindow::applyProfile(const MotorProfile& profile)
 {
     m_activeProfile = profile;
     m_device->setActiveProfile(profile);
+    m_dataStore->setActiveProfile(profile);
+    m_receiveModel->setProfile(profile);
 
-    // Update control limits
-    int min = profile.controlLimits.min;
-    int max = profile.controlLimits.max;
+    // The layout decides how many values each group sends
     for (int g = 0; g < kGroupCount; ++g) {
-        for (int i = 0; i < kMotorsPerGroup; ++i) {
-            if (i < m_groups[g].sliders.size()) {
-                m_groups[g].sliders[i]->setRange(min, max);
-            }
-            if (i < m_groups[g].spins.size()) {
-                m_groups[g].spins[i]->setRange(min, max);
+        if (m_groups[g].box) {
+            if (g < profile.commandGroups.size()) {
+                m_groups[g].box->setTitle(profile.commandGroups[g].label);
             }
+            buildGroupValues(g);
+            postSetpoints(g);
         }
     }
 
@@ -116,6 +142,9 @@ QWidget* MainWindow::buildConnectionBar()
     m_channelSpin->setRange(0, 1);
     m_channelSpin->setValue(0);
 
+    m_allChannels = new QCheckBox(QStringLiteral("All devices"), bar);
+    m_allChannels->setToolTip(QStringLiteral("Capture every channel of every connected device"));
+
     m_baudArb = new QSpinBox(bar);
     m_baudArb->setRange(1000, 2000000);
     m_baudArb->setValue(1000000);
@@ -124,6 +153,18 @@ QWidget* MainWindow::buildConnectionBar()
     m_baudData->setRange(1000, 8000000);
     m_baudData->setValue(5000000);
 
+    m_batchSpin = new QSpinBox(bar);
+    m_batchSpin->setRange(DmDeviceWrapper::kMinBatchIntervalMs, DmDeviceWrapper::kMaxBatchIntervalMs);
+    m_batchSpin->setValue(m_device->batchInterval());
+    m_batchSpin->setSuffix(QStringLiteral(" ms"));
+    m_batchSpin->setToolTip(QStringLiteral("Receive batch interval"));
+    connect(m_batchSpin, QOverload<int>::of(&QSpinBox::valueChanged), this, [this](int value) {
+        m_device->setBatchInterval(value);
+    });
+
+    m_realtimeTx = new QCheckBox(QStringLiteral("RT TX"), bar);
+    m_realtimeTx->setToolTip(QStringLiteral("Run the transmit scheduler with realtime priority (may need privileges)"));
+
     m_openButton = new QPushButton(QStringLiteral("Open"), bar);
     m_closeButton = new QPushButton(QStringLiteral("Close"), bar);
     m_statusLabel = new QLabel(QStringLiteral("Disconnected"), bar);
@@ -134,29 +175,97 @@ QWidget* MainWindow::buildConnectionBar()
     layout->addWidget(m_deviceType);
     layout->addWidget(new QLabel(QStringLiteral("Channel"), bar));
     layout->addWidget(m_channelSpin);
+    layout->addWidget(m_allChannels);
     layout->addWidget(new QLabel(QStringLiteral("Arb Baud"), bar));
     layout->addWidget(m_baudArb);
     layout->addWidget(new QLabel(QStringLiteral("Data Baud"), bar));
     layout->addWidget(m_baudData);
+    layout->addWidget(new QLabel(QStringLiteral("Batch"), bar));
+    layout->addWidget(m_batchSpin);
+    layout->addWidget(m_realtimeTx);
     layout->addWidget(m_openButton);
     layout->addWidget(m_closeButton);
     layout->addWidget(m_statusLabel);
     layout->addStretch(1);
 
     connect(m_openButton, &QPushButton::clicked, this, [this]() {
+        // Opening ends a replay
+        m_replayButton->setChecked(false);
         m_device->setDeviceType(static_cast<device_def_t>(m_deviceType->currentData().toInt()));
         m_device->setChannel(static_cast<uint8_t>(m_channelSpin->value()));
+        m_device->setCaptureAllChannels(m_allChannels->isChecked());
+        m_device->txScheduler().setRealtime(m_realtimeTx->isChecked());
         m_device->open();
         m_device->setBaud(m_baudArb->value(), m_baudData->value());
+        // TX stats only change while a device is open; idle stays timer-free
+        m_txStatsTimer->start();
     });
 
     connect(m_closeButton, &QPushButton::clicked, this, [this]() {
         m_device->close();
+        m_txStatsTimer->stop();
+        updateTxStats();
     });
 
     return bar;
 }
 
+QWidget* MainWindow::buildCaptureBar()
+{
+    QWidget* bar = new QWidget(this);
+    QHBoxLayout* layout = new QHBoxLayout(bar);
+    layout->setContentsMargins(0, 0, 0, 0);
+
+    m_recordButton = new QPushButton(QStringLiteral("Record..."), bar);
+    m_recordButton->setCheckable(true);
+    m_recordButton->setToolTip(QStringLiteral("Write every received frame and TX echo to a capture file"));
+    connect(m_recordButton, &QPushButton::toggled, this, &MainWindow::toggleRecording);
+
+    m_recordLabel = new QLabel(QStringLiteral("Not recording"), bar);
+
+    // Speed factor; 0 replays as fast as the decoders keep up
+    m_replaySpeed = new QComboBox(bar);
+    m_replaySpeed->addItem(QStringLiteral("1x"), 1.0);
+    m_replaySpeed->addItem(QStringLiteral("2x"), 2.0);
+    m_replaySpeed->addItem(QStringLiteral("5x"), 5.0);
+    m_replaySpeed->addItem(QStringLiteral("10x"), 10.0);
+    m_replaySpeed->addItem(QStringLiteral("Unpaced"), 0.0);
+
+    m_replayButton = new QPushButton(QStringLiteral("Replay..."), bar);
+    m_replayButton->setCheckable(true);
+    m_replayButton->setToolTip(
+        QStringLiteral("Decode a capture file, candump -l log or Vector ASC log as if it came from the device"));
+    connect(m_replayButton, &QPushButton::toggled, this, &MainWindow::toggleReplay);
+
+    m_replayLabel = new QLabel(bar);
+
+    m_exportSource = new QComboBox(bar);
+    m_exportSource->addItem(QStringLiteral("History"));
+    m_exportSource->addItem(QStringLiteral("Capture file"));
+    m_exportSource->setToolTip(QStringLiteral("Export the decoded telemetry history or the frames of a capture file"));
+
+    m_exportButton = new QPushButton(QStringLiteral("Export..."), bar);
+    m_exportButton->setCheckable(true);
+    m_exportButton->setToolTip(QStringLiteral("Write to CSV (.csv) or a compressed column file (.dmcol)"));
+    connect(m_exportButton, &QPushButton::toggled, this, &MainWindow::toggleExport);
+
+    m_exportLabel = new QLabel(bar);
+
+    layout->addWidget(m_recordButton);
+    layout->addWidget(m_recordLabel);
+    layout->addSpacing(16);
+    layout->addWidget(m_replaySpeed);
+    layout->addWidget(m_replayButton);
+    layout->addWidget(m_replayLabel);
+    layout->addSpacing(16);
+    layout->addWidget(m_exportSource);
+    layout->addWidget(m_exportButton);
+    layout->addWidget(m_exportLabel);
+    layout->addStretch(1);
+
+    return bar;
+}
+
 QWidget* MainWindow::buildControlsTab()
 {
     QWidget* container = new QWidget(this);
@@ -173,9 +282,6 @@ QWidget* MainWindow::buildControls()
     QWidget* container = new QWidget(this);
     QHBoxLayout* layout = new QHBoxLayout(container);
 
-    int valueMin = m_activeProfile.controlLimits.min;
-    int valueMax = m_activeProfile.controlLimits.max;
-
     for (int g = 0; g < kGroupCount; ++g) {
         QString groupLabel;
         if (g < m_activeProfile.commandGroups.size()) {
@@ -188,71 +294,49 @@ QWidget* MainWindow::buildControls()
         QGroupBox* box = new QGroupBox(groupLabel, container);
         QVBoxLayout* boxLayout = new QVBoxLayout(box);
 
-        QGridLayout* grid = new QGridLayout();
-        for (int i = 0; i < kMotorsPerGroup; ++i) {
-            QString motorLabel;
-            int motorIdx = g * kMotorsPerGroup + i;
-            if (motorIdx < m_activeProfile.motors.size()) {
-                motorLabel = m_activeProfile.motors[motorIdx].label;
-            } else {
-                motorLabel = QStringLiteral("Motor %1").arg(motorIdx + 1);
-            }
-
-            QLabel* label = new QLabel(motorLabel, box);
-            QSlider* slider = new QSlider(Qt::Horizontal, box);
-            slider->setRange(valueMin, valueMax);
-            slider->setValue(0);
-
-            QSpinBox* spin = new QSpinBox(box);
-            spin->setRange(valueMin, valueMax);
-            spin->setValue(0);
-
-            grid->addWidget(label, i, 0);
-            grid->addWidget(slider, i, 1);
-            grid->addWidget(spin, i, 2);
-
-            m_groups[g].sliders.push_back(slider);
-            m_groups[g].spins.push_back(spin);
-
-            connect(slider, &QSlider::valueChanged, this, [this, g, i](int value) {
-                applyValuePair(g, i, value);
-            });
-            connect(spin, QOverload<int>::of(&QSpinBox::valueChanged), this, [this, g, i](int value) {
-                applyValuePair(g, i, value);
-            });
-        }
+        m_groups[g].box = box;
+        buildGroupValues(g);
 
         m_groups[g].sendOnChange = new QCheckBox(QStringLiteral("Auto send"), box);
         m_groups[g].sendOnChange->setChecked(true);
         m_groups[g].rateSpin = new QSpinBox(box);
-        m_groups[g].rateSpin->setRange(1, 500);
+        m_groups[g].rateSpin->setRange(1, 5000);
         m_groups[g].rateSpin->setValue(20);
         m_groups[g].rateSpin->setSuffix(QStringLiteral(" Hz"));
         m_groups[g].sendButton = new QPushButton(QStringLiteral("Send now"), box);
-        m_groups[g].timer = new QTimer(box);
-        m_groups[g].timer->setInterval(50);
+        m_groups[g].offload = new QCheckBox(QStringLiteral("Offload to adapter"), box);
+        m_groups[g].offload->setToolTip(QStringLiteral("Let the adapter repeat the frame in 50 ms windows; changes apply at the next window"));
+        m_groups[g].statsLabel = new QLabel(QStringLiteral("-"), box);
 
-        boxLayout->addLayout(grid);
         boxLayout->addWidget(m_groups[g].sendOnChange);
         boxLayout->addWidget(m_groups[g].rateSpin);
+        boxLayout->addWidget(m_groups[g].offload);
         boxLayout->addWidget(m_groups[g].sendButton);
+        boxLayout->addWidget(m_groups[g].statsLabel);
 
         connect(m_groups[g].sendButton, &QPushButton::clicked, this, [this, g]() {
             sendGroup(g);
         });
 
-        connect(m_groups[g].timer, &QTimer::timeout, this, [this, g]() {
-            if (!m_groups[g].sendOnChange->isChecked()) {
-                return;
-            }
-            sendGroup(g);
-            m_groups[g].dirty = false;
+        // Periodic sending runs on the device's TX scheduler thread
+        TxScheduler& scheduler = m_device->txScheduler();
+        scheduler.setGroupRate(g, m_groups[g].rateSpin->value());
+        scheduler.setGroupEnabled(g, m_groups[g].sendOnChange->isChecked());
+        postSetpoints(g);
+
+        connect(m_groups[g].sendOnChange, &QCheckBox::toggled, this, [this, g](bool checked) {
+            m_device->txScheduler().setGroupEnabled(g, checked);
+            m_device->txScheduler().resetStats(g);
         });
         connect(m_groups[g].rateSpin, QOverload<int>::of(&QSpinBox::valueChanged), this, [this, g](int value) {
-            int interval = 1000 / value;
-            m_groups[g].timer->setInterval(interval);
+            m_device->txScheduler().setGroupRate(g, value);
+            m_device->txScheduler().resetStats(g);
+        });
+        connect(m_groups[g].offload, &QCheckBox::toggled, this, [this, g](bool checked) {
+            m_device->txScheduler().setGroupMode(g, checked ? TxScheduler::Mode::Offloaded
+                                                            : TxScheduler::Mode::Host);
+            m_device->txScheduler().resetStats(g);
         });
-        m_groups[g].timer->start();
 
         layout->addWidget(box, 1);
     }
@@ -260,35 +344,82 @@ QWidget* MainWindow::buildControls()
     return container;
 }
 
+void MainWindow::buildGroupValues(int group)
+{
+    ControlGroup& controls = m_groups[group];
+    // Deleting the panel takes the old rows and their connections with it
+    delete controls.valuePanel;
+    controls.sliders.clear();
+    controls.spins.clear();
+
+    int count = kMotorsPerGroup;
+    const MotorCommandGroup* commandGroup = nullptr;
+    if (group < m_activeProfile.commandGroups.size()) {
+        commandGroup = &m_activeProfile.commandGroups[group];
+        count = CommandPlan::valueCount(*commandGroup);
+    }
+
+    const int valueMin = m_activeProfile.controlLimits.min;
+    const int valueMax = m_activeProfile.controlLimits.max;
+    controls.valuePanel = new QWidget(controls.box);
+    QGridLayout* grid = new QGridLayout(controls.valuePanel);
+    grid->setContentsMargins(0, 0, 0, 0);
+    for (int i = 0; i < count; ++i) {
+        QString valueLabel;
+        int motorIdx = group * kMotorsPerGroup + i;
+        if (commandGroup && !commandGroup->fields.isEmpty()) {
+            motorIdx = -1;
+            valueLabel = QStringLiteral("Value %1").arg(i + 1);
+        } else if (commandGroup && i < commandGroup->motorIndices.size()) {
+            motorIdx = commandGroup->motorIndices[i];
+        }
+        if (motorIdx >= 0 && motorIdx < m_activeProfile.motors.size()) {
+            valueLabel = m_activeProfile.motors[motorIdx].label;
+        } else if (motorIdx >= 0) {
+            valueLabel = QStringLiteral("Motor %1").arg(motorIdx + 1);
+        }
+
+        QLabel* label = new QLabel(valueLabel, controls.valuePanel);
+        QSlider* slider = new QSlider(Qt::Horizontal, controls.valuePanel);
+        slider->setRange(valueMin, valueMax);
+        slider->setValue(0);
+
+        QSpinBox* spin = new QSpinBox(controls.valuePanel);
+        spin->setRange(valueMin, valueMax);
+        spin->setValue(0);
+
+        grid->addWidget(label, i, 0);
+        grid->addWidget(slider, i, 1);
+        grid->addWidget(spin, i, 2);
+
+        controls.sliders.push_back(slider);
+        controls.spins.push_back(spin);
+
+        connect(slider, &QSlider::valueChanged, this, [this, group, i](int value) {
+            applyValuePair(group, i, value);
+        });
+        connect(spin, QOverload<int>::of(&QSpinBox::valueChanged), this, [this, group, i](int value) {
+            applyValuePair(group, i, value);
+        });
+    }
+    static_cast<QVBoxLayout*>(controls.box->layout())->insertWidget(0, controls.valuePanel);
+}
+
 QWidget* MainWindow::buildReceiveTable()
 {
     QWidget* container = new QWidget(this);
     QVBoxLayout* layout = new QVBoxLayout(container);
 
-    m_table = new QTableWidget(kMotorCount, 6, container);
-    m_table->setHorizontalHeaderLabels({
-        QStringLiteral("Motor"),
-        QStringLiteral("ECD"),
-        QStringLiteral("Speed"),
-        QStringLiteral("Current"),
-        QStringLiteral("Rotor Temp"),
-        QStringLiteral("PCB Temp")
-    });
+    m_receiveModel = new ReceiveTableModel(this);
+    m_receiveModel->setProfile(m_activeProfile);
+
+    m_table = new QTableView(container);
+    m_table->setModel(m_receiveModel);
     m_table->verticalHeader()->setVisible(false);
+    // Fixed geometry: updates never trigger a relayout, however many rows
+    m_table->verticalHeader()->setSectionResizeMode(QHeaderView::Fixed);
     m_table->horizontalHeader()->setSectionResizeMode(QHeaderView::Stretch);
-
-    for (int i = 0; i < kMotorCount; ++i) {
-        QString motorLabel;
-        if (i < m_activeProfile.motors.size()) {
-            motorLabel = m_activeProfile.motors[i].label;
-        } else {
-            motorLabel = QString::number(i + 1);
-        }
-        m_table->setItem(i, 0, new QTableWidgetItem(motorLabel));
-        for (int c = 1; c < 6; ++c) {
-            m_table->setItem(i, c, new QTableWidgetItem(QStringLiteral("-")));
-        }
-    }
+    m_table->setEditTriggers(QAbstractItemView::NoEditTriggers);
 
     layout->addWidget(m_table);
     return container;
@@ -300,16 +431,16 @@ void MainWindow::applyValuePair(int group, int index, int value)
     QSignalBlocker blocker2(m_groups[group].spins[index]);
     m_groups[group].sliders[index]->setValue(value);
     m_groups[group].spins[index]->setValue(value);
-    m_groups[group].dirty = true;
+    postSetpoints(group);
 }
 
-QVector<int16_t> MainWindow::groupValues(int group) const
+int MainWindow::groupValues(int group, int32_t* values) const
 {
-    QVector<int16_t> values;
-    for (int i = 0; i < kMotorsPerGroup; ++i) {
-        values.push_back(static_cast<int16_t>(m_groups[group].spins[i]->value()));
+    const QVector<QSpinBox*>& spins = m_groups[group].spins;
+    for (int i = 0; i < spins.size(); ++i) {
+        values[i] = spins[i]->value();
     }
-    return values;
+    return spins.size();
 }
 
 void MainWindow::sendGroup(int group)
@@ -317,31 +448,281 @@ void MainWindow::sendGroup(int group)
     if (!m_device) {
         return;
     }
-    m_device->sendGroup(group, groupValues(group));
+    int32_t values[kMaxCommandValues];
+    int count = groupValues(group, values);
+    m_device->sendGroup(group, values, count);
 }
 
-void MainWindow::updateStatus(bool ok, const QString& message)
+void MainWindow::postSetpoints(int group)
 {
-    m_statusLabel->setText(message);
-    if (ok) {
-        m_statusLabel->setStyleSheet(QStringLiteral("color: green;"));
-    } else {
-        m_statusLabel->setStyleSheet(QStringLiteral("color: red;"));
+    if (!m_device) {
+        return;
     }
+    int32_t values[kMaxCommandValues];
+    int count = groupValues(group, values);
+    m_device->txScheduler().setSetpoints(group, values, count);
 }
 
-void MainWindow::updateMotorRow(int motorIndex, const MotorMeasure& measure)
+void MainWindow::updateTxStats()
 {
-    if (!m_table) {
+    if (!m_device) {
         return;
     }
-    // motorIndex is now 0-based
-    if (motorIndex < 0 || motorIndex >= kMotorCount) {
+    const TxScheduler& scheduler = m_device->txScheduler();
+    const QString mode = scheduler.realtimeActive() ? QStringLiteral(" RT") : QString();
+    for (int g = 0; g < kGroupCount; ++g) {
+        if (!m_groups[g].statsLabel) {
+            continue;
+        }
+        if (!scheduler.isRunning()) {
+            m_groups[g].statsLabel->setText(QStringLiteral("-"));
+            continue;
+        }
+        const TxScheduler::GroupStats stats = scheduler.groupStats(g);
+        if (scheduler.groupMode(g) == TxScheduler::Mode::Offloaded
+            && scheduler.offloadCheck() != TxScheduler::OffloadCheck::Failed) {
+            // Host-timed frames: low rates, or while another group's window is checked
+            m_groups[g].statsLabel->setText(
+                QStringLiteral("Offloaded, armed %1 window(s), %2 host-timed, %3 lost between windows (max gap %4 us)")
+                    .arg(stats.rearms)
+                    .arg(stats.sent)
+                    .arg(stats.windowGapFrames)
+                    .arg(stats.maxWindowGapUs, 0, 'f', 1));
+            continue;
+        }
+        const QString fallback = scheduler.groupMode(g) == TxScheduler::Mode::Offloaded
+                                     ? QStringLiteral("Adapter repeat unconfirmed, host-timed: ")
+                                     : QString();
+        m_groups[g].statsLabel->setText(
+            QStringLiteral("%1Sent %2, missed %3, jitter %4 us (max %5 us)%6")
+                .arg(fallback)
+                .arg(stats.sent)
+                .arg(stats.missedDeadlines)
+                .arg(stats.jitterUs, 0, 'f', 1)
+                .arg(stats.maxLatenessUs, 0, 'f', 1)
+                .arg(mode));
+    }
+}
+
+void MainWindow::toggleRecording(bool enabled)
+{
+    FrameRecorder& recorder = m_device->recorder();
+    if (!enabled) {
+        m_recordStatsTimer->stop();
+        recorder.stop();
+        updateRecordStats();
+        m_recordButton->setText(QStringLiteral("Record..."));
+        return;
+    }
+
+    const QString path = QFileDialog::getSaveFileName(this, QStringLiteral("Record Capture"), QString(),
+                                                      QStringLiteral("Frame captures (*.dmcap)"));
+    QString error;
+    if (path.isEmpty() || !recorder.start(path, &error)) {
+        if (!error.isEmpty()) {
+            m_recordLabel->setText(QStringLiteral("Record failed: %1").arg(error));
+        }
+        const QSignalBlocker blocker(m_recordButton);
+        m_recordButton->setChecked(false);
+        return;
+    }
+    m_recordButton->setText(QStringLiteral("Stop"));
+    updateRecordStats();
+    m_recordStatsTimer->start();
+}
+
+void MainWindow::updateRecordStats()
+{
+    const FrameRecorder& recorder = m_device->recorder();
+    const FrameRecorder::Stats stats = recorder.stats();
+    const QString state = recorder.isRecording() ? QStringLiteral("Recording") : QStringLiteral("Recorded");
+    QString text = QStringLiteral("%1 %2: %3 frames, %4 MB, %5 MB/s, %6 block(s) dropped")
+                       .arg(state, recorder.path())
+                       .arg(stats.frames - stats.droppedFrames)
+                       .arg(static_cast<double>(stats.bytesWritten) / 1e6, 0, 'f', 1)
+                       .arg(stats.bytesPerSecond / 1e6, 0, 'f', 2)
+                       .arg(stats.droppedBlocks);
+    if (stats.writeFailed) {
+        text += QStringLiteral(", write failed");
+    }
+    m_recordLabel->setText(text);
+}
+
+void MainWindow::toggleReplay(bool enabled)
+{
+    if (!enabled) {
+        // A running import ends in finishImport()
+        m_importer.cancel();
+        m_replayStatsTimer->stop();
+        m_device->stopReplay();
+        updateReplayStats();
         return;
     }
-    m_table->item(motorIndex, 1)->setText(QString::number(measure.ecd));
-    m_table->item(motorIndex, 2)->setText(QString::number(measure.speed_rpm));
-    m_table->item(motorIndex, 3)->setText(QString::number(measure.current));
-    m_table->item(motorIndex, 4)->setText(QString::number(measure.rotor_temperature));
-    m_table->item(motorIndex, 5)->setText(QString::number(measure.pcb_temperature));
+
+    const QString path = QFileDialog::getOpenFileName(
+        this, QStringLiteral("Replay Capture"), QString(),
+        QStringLiteral("Captures and CAN logs (*.dmcap *.log *.asc);;Frame captures (*.dmcap);;"
+                       "candump -l and Vector ASC logs (*.log *.asc)"));
+
+    // A log plays from its imported capture, which is kept for next time
+    const QString capturePath = LogImporter::capturePathFor(path);
+    if (LogImporter::isLog(path) && !LogImporter::isImported(path, capturePath)) {
+        QString error;
+        if (!m_importer.start(path, capturePath, &error)) {
+            m_replayLabel->setText(QStringLiteral("Import failed: %1").arg(error));
+            const QSignalBlocker blocker(m_replayButton);
+            m_replayButton->setChecked(false);
+            return;
+        }
+        updateReplayStats();
+        m_replayStatsTimer->start();
+        return;
+    }
+    beginReplay(LogImporter::isLog(path) ? capturePath : path);
+}
+
+void MainWindow::beginReplay(const QString& path)
+{
+    const double speed = m_replaySpeed->currentData().toDouble();
+    const FrameReplayer::Mode mode = speed <= 0.0   ? FrameReplayer::Mode::Unpaced
+                                     : speed == 1.0 ? FrameReplayer::Mode::RealTime
+                                                    : FrameReplayer::Mode::Scaled;
+
+    // Replayed time starts from zero like a fresh capture
+    m_dataStore->clear();
+    QString error;
+    if (path.isEmpty() || !m_device->startReplay(path, mode, speed, &error)) {
+        m_replayLabel->setText(error.isEmpty() ? QString() : QStringLiteral("Replay failed: %1").arg(error));
+        const QSignalBlocker blocker(m_replayButton);
+        m_replayButton->setChecked(false);
+        return;
+    }
+    updateReplayStats();
+    m_replayStatsTimer->start();
+}
+
+void MainWindow::finishImport()
+{
+    const LogImporter::Stats stats = m_importer.stats();
+    if (m_replayButton->isChecked() && !stats.failed && !stats.cancelled) {
+        beginReplay(m_importer.capturePath());
+        return;
+    }
+    const QSignalBlocker blocker(m_replayButton);
+    m_replayButton->setChecked(false);
+    m_replayStatsTimer->stop();
+    m_replayLabel->setText(stats.failed ? QStringLiteral("Import failed: %1").arg(m_importer.errorString())
+                                        : QStringLiteral("Import cancelled"));
+}
+
+void MainWindow::finishReplay()
+{
+    // Delivers the frames still being decoded before the stats are final
+    const QSignalBlocker blocker(m_replayButton);
+    m_replayButton->setChecked(false);
+    m_replayStatsTimer->stop();
+    m_device->stopReplay();
+    updateReplayStats();
+}
+
+void MainWindow::updateReplayStats()
+{
+    if (m_importer.isRunning()) {
+        const LogImporter::Stats stats = m_importer.stats();
+        const double progress = stats.fileSize ? 100.0 * stats.bytesRead / stats.fileSize : 0.0;
+        m_replayLabel->setText(QStringLiteral("Importing %1: %2 frames, %3 MB/s, %4%")
+                                   .arg(m_importer.logPath())
+                                   .arg(stats.frames)
+                                   .arg(stats.bytesPerSecond / 1e6, 0, 'f', 1)
+                                   .arg(progress, 0, 'f', 0));
+        return;
+    }
+    const FrameReplayer::Stats stats = m_device->replayStats();
+    const double progress = stats.fileSize ? 100.0 * stats.bytesRead / stats.fileSize : 0.0;
+    QString text = QStringLiteral("%1: %2 frames in %3 s (%4 frames/s), %5%")
+                       .arg(m_device->isReplaying() ? QStringLiteral("Replaying") : QStringLiteral("Replayed"))
+                       .arg(stats.frames)
+                       .arg(stats.elapsedSeconds, 0, 'f', 1)
+                       .arg(stats.framesPerSecond, 0, 'f', 0)
+                       .arg(progress, 0, 'f', 0);
+    if (stats.truncated) {
+        text += QStringLiteral(", file truncated");
+    }
+    m_replayLabel->setText(text);
+}
+
+void MainWindow::toggleExport(bool enabled)
+{
+    if (!enabled) {
+        // finishExport() follows once the export thread has stopped
+        m_exporter.cancel();
+        return;
+    }
+
+    const bool fromCapture = m_exportSource->currentIndex() == 1;
+    const QString capturePath = fromCapture
+                                    ? QFileDialog::getOpenFileName(this, QStringLiteral("Export Capture"), QString(),
+                                                                   QStringLiteral("Frame captures (*.dmcap)"))
+                                    : QString();
+    const QString path = (fromCapture && capturePath.isEmpty())
+                             ? QString()
+                             : QFileDialog::getSaveFileName(this, QStringLiteral("Export"), QString(),
+                                                            QStringLiteral("CSV (*.csv);;Column files (*.dmcol)"));
+
+    // History is exported from a snapshot, so capture keeps appending meanwhile
+    QString error;
+    const bool started = !path.isEmpty()
+                         && (fromCapture ? m_exporter.exportCapture(capturePath, path, &error)
+                                         : m_exporter.exportHistory(m_dataStore->snapshot(), path, &error));
+    if (!started) {
+        m_exportLabel->setText(error.isEmpty() ? QString() : QStringLiteral("Export failed: %1").arg(error));
+        const QSignalBlocker blocker(m_exportButton);
+        m_exportButton->setChecked(false);
+        return;
+    }
+    m_exportButton->setText(QStringLiteral("Cancel"));
+    updateExportStats();
+    m_exportStatsTimer->start();
+}
+
+void MainWindow::finishExport()
+{
+    const QSignalBlocker blocker(m_exportButton);
+    m_exportButton->setChecked(false);
+    m_exportButton->setText(QStringLiteral("Export..."));
+    m_exportStatsTimer->stop();
+    updateExportStats();
+}
+
+void MainWindow::updateExportStats()
+{
+    const DataExporter::Stats stats = m_exporter.stats();
+    const QString state = m_exporter.isRunning() ? QStringLiteral("Exporting")
+                          : stats.failed         ? QStringLiteral("Export failed")
+                          : stats.cancelled      ? QStringLiteral("Export cancelled")
+                                                 : QStringLiteral("Exported");
+    // No chunk count yet while a capture is still being indexed
+    const double progress = stats.chunkCount ? 100.0 * stats.chunksWritten / stats.chunkCount
+                            : m_exporter.isRunning() ? 0.0
+                                                     : 100.0;
+    QString text = QStringLiteral("%1 %2: %3 rows, %4 MB, %5 MB/s, %6%")
+                       .arg(state, m_exporter.path())
+                       .arg(stats.rows)
+                       .arg(static_cast<double>(stats.bytesWritten) / 1e6, 0, 'f', 1)
+                       .arg(stats.bytesPerSecond / 1e6, 0, 'f', 1)
+                       .arg(progress, 0, 'f', 0);
+    if (stats.failed) {
+        text += QStringLiteral(" (%1)").arg(m_exporter.errorString());
+    }
+    m_exportLabel->setText(text);
+}
+
+void MainWindow::updateStatus(bool ok, const QString& message)
+{
+    m_statusLabel->setText(message);
+    if (ok) {
+        m_statusLabel->setStyleSheet(QStringLiteral("color: green;"));
+    } else {
+        m_statusLabel->setStyleSheet(QStringLiteral("color: red;"));
+    }
 }
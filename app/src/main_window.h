@@ -3,10 +3,11 @@
 
 #include <QMainWindow>
 #include <QPointer>
-#include <QTableWidget>
+#include <QTableView>
 #include <QVector>
 #include <QCheckBox>
 #include <QComboBox>
+#include <QGroupBox>
 #include <QLabel>
 #include <QPushButton>
 #include <QSlider>
@@ -15,9 +16,12 @@
 #include <QTabWidget>
 
 #include "dm_device_wrapper.h"
+#include "data_exporter.h"
+#include "log_importer.h"
 #include "motor_profile.h"
 
 class TelemetryDataStore;
+class ReceiveTableModel;
 class TelemetryDashboard;
 
 class MainWindow : public QMainWindow
@@ -30,26 +34,41 @@ public:
 private:
     struct ControlGroup
     {
+        QGroupBox* box = nullptr;
+        QWidget* valuePanel = nullptr;          // One slider/spin row per command value
         QVector<QSlider*> sliders;
         QVector<QSpinBox*> spins;
         QCheckBox* sendOnChange = nullptr;
+        QCheckBox* offload = nullptr;
         QSpinBox* rateSpin = nullptr;
         QPushButton* sendButton = nullptr;
-        QTimer* timer = nullptr;
-        bool dirty = false;
+        QLabel* statsLabel = nullptr;
     };
 
     QWidget* buildControls();
+    void buildGroupValues(int group);
     QWidget* buildReceiveTable();
     QWidget* buildConnectionBar();
+    QWidget* buildCaptureBar();
     QWidget* buildControlsTab();
 
     void applyValuePair(int group, int index, int value);
-    QVector<int16_t> groupValues(int group) const;
+    int groupValues(int group, int32_t* values) const;
     void sendGroup(int group);
+    void postSetpoints(int group);
+    void updateTxStats();
+    void toggleRecording(bool enabled);
+    void updateRecordStats();
+    void toggleReplay(bool enabled);
+    void beginReplay(const QString& path);
+    void finishImport();
+    void finishReplay();
+    void updateReplayStats();
+    void toggleExport(bool enabled);
+    void finishExport();
+    void updateExportStats();
 
     void updateStatus(bool ok, const QString& message);
-    void updateMotorRow(int motorIndex, const MotorMeasure& measure);
 
     void loadProfiles();
     void onProfileChanged(int index);
@@ -57,15 +76,39 @@ private:
 
     QPointer<DmDeviceWrapper> m_device;
     ControlGroup m_groups[2];
-    QTableWidget* m_table = nullptr;
+    QTableView* m_table = nullptr;
+    ReceiveTableModel* m_receiveModel = nullptr;
 
     QComboBox* m_deviceType = nullptr;
     QSpinBox* m_channelSpin = nullptr;
+    QCheckBox* m_allChannels = nullptr;
     QSpinBox* m_baudArb = nullptr;
     QSpinBox* m_baudData = nullptr;
+    QSpinBox* m_batchSpin = nullptr;
+    QCheckBox* m_realtimeTx = nullptr;
     QPushButton* m_openButton = nullptr;
     QPushButton* m_closeButton = nullptr;
     QLabel* m_statusLabel = nullptr;
+    QTimer* m_txStatsTimer = nullptr;
+
+    // Raw frame capture
+    QPushButton* m_recordButton = nullptr;
+    QLabel* m_recordLabel = nullptr;
+    QTimer* m_recordStatsTimer = nullptr;
+
+    // Capture replay; logs are imported to a capture first
+    LogImporter m_importer;
+    QPushButton* m_replayButton = nullptr;
+    QComboBox* m_replaySpeed = nullptr;
+    QLabel* m_replayLabel = nullptr;
+    QTimer* m_replayStatsTimer = nullptr;
+
+    // CSV / column file export
+    DataExporter m_exporter;
+    QComboBox* m_exportSource = nullptr;
+    QPushButton* m_exportButton = nullptr;
+    QLabel* m_exportLabel = nullptr;
+    QTimer* m_exportStatsTimer = nullptr;
 
     // Profile selection
     QComboBox* m_profileCombo = nullptr;
@@ -0,0 +1,123 @@
+#ifndef MINMAX_PYRAMID_H
+#define MINMAX_PYRAMID_H
+
+#include <cstdint>
+
+#include "column_ring.h"
+
+// Min/max/sum decimation levels over one column, x8 per level. Level L
+// bucket b summarises raw sequences [b << 3L, (b + 1) << 3L). Every level is
+// updated on append, so a query at any zoom touches O(buckets) entries.
+class MinMaxPyramid
+{
+public:
+    static constexpr int kFanoutShift = 3;
+    static constexpr int kMaxLevels = 8;
+
+    struct Bucket
+    {
+        float min = 0.0f;
+        float max = 0.0f;
+        int32_t count = 0;   // Samples summarised; fewer than 8^L after a restart
+        double sum = 0.0;
+    };
+
+    // Size levels for capacity raw samples; level L exists while 8^L <= capacity
+    void reset(int64_t capacity)
+    {
+        m_levels = 0;
+        while (m_levels < kMaxLevels && (int64_t(1) << (kFanoutShift * (m_levels + 1))) <= capacity) {
+            ++m_levels;
+        }
+        for (int level = 0; level < m_levels; ++level) {
+            m_rings[level].reset((capacity >> (kFanoutShift * (level + 1))) + 2);
+        }
+    }
+
+    int levelCount() const { return m_levels; }
+
+    // Add raw sample seq. restart marks the first sample after a gap in the
+    // column (first use or a resize), which opens fresh buckets mid-way.
+    void append(int64_t seq, float value, bool restart)
+    {
+        for (int level = 0; level < m_levels; ++level) {
+            const int shift = kFanoutShift * (level + 1);
+            Bucket& bucket = m_rings[level].at(seq >> shift);
+            if (restart || (seq & ((int64_t(1) << shift) - 1)) == 0) {
+                bucket.min = value;
+                bucket.max = value;
+                bucket.count = 1;
+                bucket.sum = value;
+            } else {
+                bucket.min = value < bucket.min ? value : bucket.min;
+                bucket.max = value > bucket.max ? value : bucket.max;
+                ++bucket.count;
+                bucket.sum += value;
+            }
+        }
+    }
+
+    // Level is 1-based: level 1 buckets hold 8 raw samples
+    Bucket bucket(int level, int64_t index) const { return m_rings[level - 1].read(index); }
+
+    // Min and max of raw sequences [from, to), which must be non-empty, held
+    // in raw and written since the last restart. Aligned blocks come from
+    // the largest fitting level, only the ragged ends are read raw.
+    void minMax(const ColumnRing<float>& raw, int64_t from, int64_t to, float& min, float& max) const
+    {
+        min = max = raw.read(from);
+        forEachBlock(raw, from, to, [&](float value) {
+            min = value < min ? value : min;
+            max = value > max ? value : max;
+        }, [&](const Bucket& b) {
+            min = b.min < min ? b.min : min;
+            max = b.max > max ? b.max : max;
+        });
+    }
+
+    // Mean of the same range, in the same O(buckets)
+    double mean(const ColumnRing<float>& raw, int64_t from, int64_t to) const
+    {
+        double sum = 0.0;
+        int64_t count = 0;
+        forEachBlock(raw, from, to, [&](float value) {
+            sum += value;
+            ++count;
+        }, [&](const Bucket& b) {
+            sum += b.sum;
+            count += b.count;
+        });
+        return count ? sum / static_cast<double>(count) : 0.0;
+    }
+
+private:
+    // Cover [from, to) with the largest aligned buckets that fit, reading
+    // raw samples only where none does
+    template <typename Sample, typename Block>
+    void forEachBlock(const ColumnRing<float>& raw, int64_t from, int64_t to, Sample sample, Block block) const
+    {
+        int64_t seq = from;
+        while (seq < to) {
+            int level = 0;
+            while (level < m_levels) {
+                const int64_t size = int64_t(1) << (kFanoutShift * (level + 1));
+                if ((seq & (size - 1)) != 0 || seq + size > to) {
+                    break;
+                }
+                ++level;
+            }
+            if (level == 0) {
+                sample(raw.read(seq));
+                ++seq;
+            } else {
+                block(bucket(level, seq >> (kFanoutShift * level)));
+                seq += int64_t(1) << (kFanoutShift * level);
+            }
+        }
+    }
+
+    int m_levels = 0;
+    ColumnRing<Bucket> m_rings[kMaxLevels];
+};
+
+#endif // MINMAX_PYRAMID_H
@@ -5,6 +5,7 @@
 #include <QVector>
 #include <QHash>
 
+#include <array>
 #include <cstdint>
 
 // ============================================================================
@@ -66,17 +67,37 @@ struct ControlLimits
 struct MotorDescriptor
 {
     QString label;
+    int bus = -1;                              // Bus index (device * 2 + channel), -1 = any
     CanIdMatcher canIdMatcher;
     QVector<FieldDefinition> fields;           // Effective fields for this motor
     QHash<QString, FieldDefinition> fieldOverrides;  // Per-motor field overrides
 };
 
+// Upper bound on values per command group (valueIndex < this). The TX
+// scheduler's per-group setpoint mailbox is sized from it.
+constexpr int kMaxCommandValues = 8;
+
+// One value of a command frame
+struct CommandField
+{
+    int valueIndex = 0;         // Index into the values handed to sendGroup
+    int byteOffset = 0;         // Starting byte offset in the payload
+    BitRange bits;              // Bit placement, same meaning as for FieldDefinition
+    bool littleEndian = false;
+    bool hasLimits = false;     // Otherwise the profile's controlLimits apply
+    ControlLimits limits;
+};
+
 struct MotorCommandGroup
 {
     QString label;
     uint32_t canId = 0;
     QVector<int> motorIndices;
     bool littleEndian = false;  // Command byte order for this group
+    int payloadLength = 8;      // Payload bytes (CAN-FD lengths up to 64)
+    bool canfd = false;
+    bool brs = false;           // CAN-FD bit rate switch
+    QVector<CommandField> fields;  // Empty = one 16-bit value per motor index
 };
 
 struct MotorProfile
@@ -95,6 +116,9 @@ struct MotorProfile
 // Dynamic motor measurement (supports arbitrary fields)
 // ============================================================================
 
+// Upper bound on distinct field IDs per profile (slot indices fit a bitmask)
+constexpr int kMaxMeasureFields = 32;
+
 struct MotorMeasure
 {
     // Legacy fixed fields for backward compatibility
@@ -104,25 +128,34 @@ struct MotorMeasure
     uint8_t rotor_temperature = 0;
     uint8_t pcb_temperature = 0;
 
-    // Dynamic field storage (field_id -> scaled value)
-    QHash<QString, double> fields;
+    // Scaled field values indexed by slot (see DecodePlan::slotOf)
+    std::array<double, kMaxMeasureFields> values{};
+    uint32_t validMask = 0;
 
-    // Get field by ID (returns from dynamic fields, falls back to legacy)
-    double field(const QString& id) const
+    bool hasValue(int slot) const
     {
-        if (fields.contains(id)) {
-            return fields.value(id);
-        }
-        // Fallback to legacy fields
-        if (id == "ecd") return static_cast<double>(ecd);
-        if (id == "speed") return static_cast<double>(speed_rpm);
-        if (id == "current") return static_cast<double>(current);
-        if (id == "rotor_temp") return static_cast<double>(rotor_temperature);
-        if (id == "pcb_temp") return static_cast<double>(pcb_temperature);
-        return 0.0;
+        return slot >= 0 && slot < kMaxMeasureFields && (validMask & (1U << slot));
+    }
+
+    double value(int slot) const
+    {
+        return hasValue(slot) ? values[slot] : 0.0;
     }
 };
 
+// Decoded measurement tagged with its motor, as handed between threads
+struct MotorSample
+{
+    int motorIndex = -1;
+    int bus = 0;                 // Bus the frame arrived on
+    int64_t timestampNs = 0;     // Host monotonic time (adapter timestamp mapped by ClockSync)
+    uint64_t deviceTimestamp = 0; // Raw adapter RX timestamp
+    MotorMeasure measure;
+};
+
+// Contiguous run of samples delivered in a single signal emission
+using MotorSampleBatch = QVector<MotorSample>;
+
 // ============================================================================
 // Profile loading utilities
 // ============================================================================
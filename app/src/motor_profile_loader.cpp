@@ -11,6 +11,21 @@
 
 static constexpr int CURRENT_SCHEMA_VERSION = 1;
 
+// Payload lengths a DLC can express: 0-8, then the CAN-FD steps
+static bool isValidPayloadLength(int length)
+{
+    static constexpr int kFdLengths[] = {12, 16, 20, 24, 32, 48, 64};
+    if (length >= 0 && length <= 8) {
+        return true;
+    }
+    for (int fd : kFdLengths) {
+        if (length == fd) {
+            return true;
+        }
+    }
+    return false;
+}
+
 uint32_t MotorProfileLoader::parseCanId(const QJsonValue& value)
 {
     if (value.isDouble()) {
@@ -93,6 +108,7 @@ MotorDescriptor MotorProfileLoader::parseMotorDef(const QJsonObject& obj,
     MotorDescriptor motor;
 
     motor.label = obj.value(QStringLiteral("label")).toString();
+    motor.bus = obj.value(QStringLiteral("bus")).toInt(-1);
     motor.canIdMatcher = parseCanIdMatcher(obj, error);
 
     // Start with default fields
@@ -122,7 +138,6 @@ MotorDescriptor MotorProfileLoader::parseMotorDef(const QJsonObject& obj,
 
 MotorCommandGroup MotorProfileLoader::parseCommandGroup(const QJsonObject& obj, QString& error)
 {
-    Q_UNUSED(error);
     MotorCommandGroup group;
 
     group.label = obj.value(QStringLiteral("label")).toString();
@@ -136,6 +151,69 @@ MotorCommandGroup MotorProfileLoader::parseCommandGroup(const QJsonObject& obj,
     QString endian = obj.value(QStringLiteral("commandEndianness")).toString(QStringLiteral("big"));
     group.littleEndian = (endian.toLower() == QStringLiteral("little"));
 
+    group.payloadLength = obj.value(QStringLiteral("payloadLength")).toInt(8);
+    if (!isValidPayloadLength(group.payloadLength)) {
+        error = QStringLiteral("Command group '%1': payloadLength %2 is not a CAN-FD size "
+                               "(0-8, 12, 16, 20, 24, 32, 48 or 64)")
+                    .arg(group.label)
+                    .arg(group.payloadLength);
+        return group;
+    }
+    group.canfd = obj.value(QStringLiteral("canfd")).toBool(group.payloadLength > 8);
+    if (!group.canfd && group.payloadLength > 8) {
+        error = QStringLiteral("Command group '%1': payloads over 8 bytes need canfd").arg(group.label);
+        return group;
+    }
+    group.brs = obj.value(QStringLiteral("brs")).toBool(false);
+
+    // Optional explicit layout; without it each motor index gets a 16-bit slot
+    QJsonArray fieldsArray = obj.value(QStringLiteral("fields")).toArray();
+    for (int i = 0; i < fieldsArray.size(); ++i) {
+        QJsonObject fieldObj = fieldsArray[i].toObject();
+        CommandField field;
+        field.valueIndex = fieldObj.value(QStringLiteral("value")).toInt(i);
+        field.byteOffset = fieldObj.value(QStringLiteral("offset")).toInt(0);
+
+        QJsonObject bitsObj = fieldObj.value(QStringLiteral("bits")).toObject();
+        field.bits.start = bitsObj.value(QStringLiteral("start")).toInt(0);
+        field.bits.length = bitsObj.value(QStringLiteral("length")).toInt(16);
+
+        QString fieldEndian = fieldObj.value(QStringLiteral("endianness")).toString(endian);
+        field.littleEndian = (fieldEndian.toLower() == QStringLiteral("little"));
+
+        if (fieldObj.contains(QStringLiteral("limits"))) {
+            QJsonObject limitsObj = fieldObj.value(QStringLiteral("limits")).toObject();
+            field.hasLimits = true;
+            field.limits.min = limitsObj.value(QStringLiteral("min")).toInt(field.limits.min);
+            field.limits.max = limitsObj.value(QStringLiteral("max")).toInt(field.limits.max);
+        }
+
+        const int lastByte = field.byteOffset + (field.bits.start + field.bits.length + 7) / 8;
+        if (field.valueIndex < 0 || field.byteOffset < 0 || field.bits.start < 0 || field.bits.start > 7
+            || field.bits.length <= 0 || field.bits.length > 32 || lastByte > group.payloadLength) {
+            error = QStringLiteral("Command group '%1': field %2 does not fit the payload")
+                        .arg(group.label)
+                        .arg(i);
+            return group;
+        }
+        if (field.valueIndex >= kMaxCommandValues) {
+            error = QStringLiteral("Command group '%1': field %2 uses value %3, at most %4 values are supported")
+                        .arg(group.label)
+                        .arg(i)
+                        .arg(field.valueIndex)
+                        .arg(kMaxCommandValues);
+            return group;
+        }
+        group.fields.push_back(field);
+    }
+    if (group.fields.isEmpty() && group.motorIndices.size() > kMaxCommandValues) {
+        error = QStringLiteral("Command group '%1': %2 motors, at most %3 values are supported")
+                    .arg(group.label)
+                    .arg(group.motorIndices.size())
+                    .arg(kMaxCommandValues);
+        return group;
+    }
+
     return group;
 }
 
@@ -223,6 +301,35 @@ MotorProfileLoader::LoadResult MotorProfileLoader::loadFromJson(const QByteArray
         profile.motors.push_back(motor);
     }
 
+    // Every distinct field ID needs a decode slot; past the last one its
+    // values would silently never be stored
+    QStringList fieldIds;
+    auto checkSlot = [&](const FieldDefinition& field) {
+        if (field.id.isEmpty() || fieldIds.contains(field.id)) {
+            return true;
+        }
+        if (fieldIds.size() >= kMaxMeasureFields) {
+            result.errorMessage = QStringLiteral("Field '%1': a profile can have at most %2 distinct fields")
+                                      .arg(field.id)
+                                      .arg(kMaxMeasureFields);
+            return false;
+        }
+        fieldIds.append(field.id);
+        return true;
+    };
+    for (const FieldDefinition& field : profile.defaultFields) {
+        if (!checkSlot(field)) {
+            return result;
+        }
+    }
+    for (const MotorDescriptor& motor : profile.motors) {
+        for (const FieldDefinition& field : motor.fields) {
+            if (!checkSlot(field)) {
+                return result;
+            }
+        }
+    }
+
     // Parse command groups
     QString groupError;
     QJsonArray groupsArray = root.value(QStringLiteral("commandGroups")).toArray();
@@ -268,6 +375,9 @@ QJsonObject MotorProfileLoader::motorDefToJson(const MotorDescriptor& motor)
 {
     QJsonObject obj;
     obj[QStringLiteral("label")] = motor.label;
+    if (motor.bus >= 0) {
+        obj[QStringLiteral("bus")] = motor.bus;
+    }
 
     if (motor.canIdMatcher.mode == CanIdMatcher::Mode::Exact) {
         obj[QStringLiteral("canId")] = QStringLiteral("0x%1").arg(motor.canIdMatcher.canId, 0, 16);
@@ -303,6 +413,40 @@ QJsonObject MotorProfileLoader::commandGroupToJson(const MotorCommandGroup& grou
     obj[QStringLiteral("motorIndices")] = indices;
 
     obj[QStringLiteral("commandEndianness")] = group.littleEndian ? QStringLiteral("little") : QStringLiteral("big");
+
+    if (group.payloadLength != 8) {
+        obj[QStringLiteral("payloadLength")] = group.payloadLength;
+    }
+    if (group.canfd) {
+        obj[QStringLiteral("canfd")] = true;
+    }
+    if (group.brs) {
+        obj[QStringLiteral("brs")] = true;
+    }
+
+    if (!group.fields.isEmpty()) {
+        QJsonArray fields;
+        for (const CommandField& field : group.fields) {
+            QJsonObject fieldObj;
+            fieldObj[QStringLiteral("value")] = field.valueIndex;
+            fieldObj[QStringLiteral("offset")] = field.byteOffset;
+
+            QJsonObject bits;
+            bits[QStringLiteral("start")] = field.bits.start;
+            bits[QStringLiteral("length")] = field.bits.length;
+            fieldObj[QStringLiteral("bits")] = bits;
+
+            fieldObj[QStringLiteral("endianness")] = field.littleEndian ? QStringLiteral("little") : QStringLiteral("big");
+            if (field.hasLimits) {
+                QJsonObject limits;
+                limits[QStringLiteral("min")] = field.limits.min;
+                limits[QStringLiteral("max")] = field.limits.max;
+                fieldObj[QStringLiteral("limits")] = limits;
+            }
+            fields.append(fieldObj);
+        }
+        obj[QStringLiteral("fields")] = fields;
+    }
     return obj;
 }
 
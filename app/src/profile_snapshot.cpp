@@ -0,0 +1,16 @@
+#include "profile_snapshot.h"
+
+std::unique_ptr<const ProfileSnapshot> ProfileSnapshot::build(const MotorProfile& profile)
+{
+    std::unique_ptr<ProfileSnapshot> snapshot(new ProfileSnapshot);
+    snapshot->profile = profile;
+    snapshot->decodePlan = DecodePlan::compile(profile);
+    snapshot->commandPlan = CommandPlan::compile(profile);
+    snapshot->anyBusDispatch = CanDispatchTable::build(profile);
+    for (const MotorDescriptor& motor : profile.motors) {
+        if (motor.bus >= 0 && !snapshot->busDispatch.contains(motor.bus)) {
+            snapshot->busDispatch.insert(motor.bus, CanDispatchTable::build(profile, motor.bus));
+        }
+    }
+    return snapshot;
+}
@@ -0,0 +1,32 @@
+#ifndef PROFILE_SNAPSHOT_H
+#define PROFILE_SNAPSHOT_H
+
+#include <QHash>
+
+#include <memory>
+
+#include "motor_profile.h"
+#include "decode_plan.h"
+#include "command_plan.h"
+#include "can_dispatch_table.h"
+
+// Immutable active profile plus everything compiled from it.
+// Published through a SnapshotCell so the receive path never locks.
+struct ProfileSnapshot
+{
+    MotorProfile profile;
+    DecodePlan decodePlan;
+    CommandPlan commandPlan;
+    CanDispatchTable anyBusDispatch;              // Motors not bound to a bus
+    QHash<int, CanDispatchTable> busDispatch;     // Buses named by some motor
+
+    const CanDispatchTable& dispatchFor(int bus) const
+    {
+        auto it = busDispatch.constFind(bus);
+        return it == busDispatch.constEnd() ? anyBusDispatch : it.value();
+    }
+
+    static std::unique_ptr<const ProfileSnapshot> build(const MotorProfile& profile);
+};
+
+#endif // PROFILE_SNAPSHOT_H
@@ -0,0 +1,186 @@
+#include "receive_table_model.h"
+#include "decode_plan.h"
+
+#include <QTimer>
+
+#include <algorithm>
+#include <iterator>
+
+ReceiveTableModel::ReceiveTableModel(QObject* parent)
+    : QAbstractTableModel(parent)
+    , m_publishTimer(new QTimer(this))
+{
+    // Armed by the first dirty row, so an idle table costs nothing
+    m_publishTimer->setSingleShot(true);
+    m_publishTimer->setInterval(kDisplayIntervalMs);
+    connect(m_publishTimer, &QTimer::timeout, this, &ReceiveTableModel::publish);
+
+    setProfile(MotorProfile());
+}
+
+void ReceiveTableModel::setProfile(const MotorProfile& profile)
+{
+    beginResetModel();
+
+    m_columns.clear();
+    const QStringList ids = DecodePlan::internFieldIds(profile);
+    for (int slot = 0; slot < ids.size(); ++slot) {
+        // Title from the first definition of the field
+        Column column;
+        column.slot = slot;
+        column.title = ids[slot];
+        const FieldDefinition* definition = nullptr;
+        for (const FieldDefinition& field : profile.defaultFields) {
+            if (field.id == ids[slot]) {
+                definition = &field;
+                break;
+            }
+        }
+        for (int m = 0; !definition && m < profile.motors.size(); ++m) {
+            for (const FieldDefinition& field : profile.motors[m].fields) {
+                if (field.id == ids[slot]) {
+                    definition = &field;
+                    break;
+                }
+            }
+        }
+        if (definition) {
+            column.title = definition->label.isEmpty() ? definition->id : definition->label;
+            if (!definition->unit.isEmpty()) {
+                column.title += QStringLiteral(" (%1)").arg(definition->unit);
+            }
+        }
+        m_columns.append(column);
+    }
+    if (m_columns.isEmpty()) {
+        const struct { const char* title; Legacy legacy; } legacyColumns[] = {
+            {"ECD", Legacy::Ecd},
+            {"Speed", Legacy::Speed},
+            {"Current", Legacy::Current},
+            {"Rotor Temp", Legacy::RotorTemp},
+            {"PCB Temp", Legacy::PcbTemp},
+        };
+        for (const auto& legacy : legacyColumns) {
+            Column column;
+            column.title = QString::fromLatin1(legacy.title);
+            column.legacy = legacy.legacy;
+            m_columns.append(column);
+        }
+    }
+
+    const int rows = profile.motors.isEmpty()
+                         ? kDefaultRows
+                         : std::min(static_cast<int>(profile.motors.size()), kMaxRows);
+    m_rows = QVector<Row>(rows);
+    for (int i = 0; i < rows; ++i) {
+        m_rows[i].label = i < profile.motors.size() ? profile.motors[i].label : QString::number(i + 1);
+    }
+    std::fill(std::begin(m_dirty), std::end(m_dirty), 0);
+
+    endResetModel();
+}
+
+int ReceiveTableModel::rowCount(const QModelIndex& parent) const
+{
+    return parent.isValid() ? 0 : static_cast<int>(m_rows.size());
+}
+
+int ReceiveTableModel::columnCount(const QModelIndex& parent) const
+{
+    // Column 0 is the motor label
+    return parent.isValid() ? 0 : static_cast<int>(m_columns.size()) + 1;
+}
+
+QVariant ReceiveTableModel::data(const QModelIndex& index, int role) const
+{
+    if (!index.isValid() || index.row() >= m_rows.size() || index.column() > m_columns.size()) {
+        return QVariant();
+    }
+    if (role == Qt::TextAlignmentRole) {
+        return index.column() == 0 ? QVariant() : QVariant(Qt::AlignRight | Qt::AlignVCenter);
+    }
+    if (role != Qt::DisplayRole) {
+        return QVariant();
+    }
+
+    const Row& row = m_rows[index.row()];
+    if (index.column() == 0) {
+        return row.label;
+    }
+    if (!row.received) {
+        return QStringLiteral("-");
+    }
+
+    const Column& column = m_columns[index.column() - 1];
+    const MotorMeasure& measure = row.measure;
+    switch (column.legacy) {
+    case Legacy::Ecd:
+        return QString::number(measure.ecd);
+    case Legacy::Speed:
+        return QString::number(measure.speed_rpm);
+    case Legacy::Current:
+        return QString::number(measure.current);
+    case Legacy::RotorTemp:
+        return QString::number(measure.rotor_temperature);
+    case Legacy::PcbTemp:
+        return QString::number(measure.pcb_temperature);
+    case Legacy::None:
+        break;
+    }
+    return measure.hasValue(column.slot) ? QString::number(measure.values[column.slot], 'g', 8)
+                                         : QStringLiteral("-");
+}
+
+QVariant ReceiveTableModel::headerData(int section, Qt::Orientation orientation, int role) const
+{
+    if (role != Qt::DisplayRole || orientation != Qt::Horizontal) {
+        return QVariant();
+    }
+    if (section == 0) {
+        return QStringLiteral("Motor");
+    }
+    return section <= m_columns.size() ? QVariant(m_columns[section - 1].title) : QVariant();
+}
+
+void ReceiveTableModel::onMotorsUpdated(const MotorSampleBatch& batch)
+{
+    // Newest sample of each motor wins; older ones in the batch are skipped
+    uint64_t seen[kMaxRows / 64] = {};
+    const int rows = static_cast<int>(m_rows.size());
+    for (int i = static_cast<int>(batch.size()) - 1; i >= 0; --i) {
+        const int motorIndex = batch[i].motorIndex;
+        if (motorIndex < 0 || motorIndex >= rows) {
+            continue;
+        }
+        const uint64_t bit = uint64_t(1) << (motorIndex & 63);
+        if (seen[motorIndex >> 6] & bit) {
+            continue;
+        }
+        seen[motorIndex >> 6] |= bit;
+        m_dirty[motorIndex >> 6] |= bit;
+        m_rows[motorIndex].measure = batch[i].measure;
+        m_rows[motorIndex].received = true;
+    }
+
+    if (!m_publishTimer->isActive()) {
+        m_publishTimer->start();
+    }
+}
+
+void ReceiveTableModel::publish()
+{
+    // One dataChanged per run of consecutive dirty rows
+    const int rows = static_cast<int>(m_rows.size());
+    const int lastColumn = static_cast<int>(m_columns.size());
+    int runStart = -1;
+    for (int row = 0; row <= rows; ++row) {
+        const bool dirty = row < rows && (m_dirty[row >> 6] & (uint64_t(1) << (row & 63)));
+        if (dirty && runStart < 0) {
+            runStart = row;
+        } else if (!dirty && runStart >= 0) {
+            emit dataChanged(index(runStart, 1), index(row - 1, lastColumn), {Qt::DisplayRole});
+            runStart = -1;
+        }
+    }
+    std::fill(std::begin(m_dirty), std::end(m_dirty), 0);
+}
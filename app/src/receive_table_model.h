@@ -0,0 +1,63 @@
+#ifndef RECEIVE_TABLE_MODEL_H
+#define RECEIVE_TABLE_MODEL_H
+
+#include <QAbstractTableModel>
+#include <QStringList>
+#include <QVector>
+
+#include <cstdint>
+
+#include "motor_profile.h"
+
+class QTimer;
+
+// Latest measurement per motor for the receive table. Samples only update
+// the value array and a dirty bit per row; views hear about it at the
+// display rate through one dataChanged per run of dirty rows, and format
+// just the cells they actually show.
+class ReceiveTableModel : public QAbstractTableModel
+{
+    Q_OBJECT
+public:
+    static constexpr int kMaxRows = 256;
+    static constexpr int kDefaultRows = 8;
+    static constexpr int kDisplayIntervalMs = 50;
+
+    explicit ReceiveTableModel(QObject* parent = nullptr);
+
+    // Rows follow the profile's motors, columns its field IDs
+    void setProfile(const MotorProfile& profile);
+
+    int rowCount(const QModelIndex& parent = QModelIndex()) const override;
+    int columnCount(const QModelIndex& parent = QModelIndex()) const override;
+    QVariant data(const QModelIndex& index, int role = Qt::DisplayRole) const override;
+    QVariant headerData(int section, Qt::Orientation orientation, int role = Qt::DisplayRole) const override;
+
+public slots:
+    void onMotorsUpdated(const MotorSampleBatch& batch);
+
+private:
+    // Profiles without fields show the fixed measure members
+    enum class Legacy { None, Ecd, Speed, Current, RotorTemp, PcbTemp };
+
+    struct Column {
+        QString title;
+        int slot = -1;             // Decode-plan slot (see DecodePlan::internFieldIds)
+        Legacy legacy = Legacy::None;
+    };
+
+    struct Row {
+        QString label;
+        MotorMeasure measure;
+        bool received = false;
+    };
+
+    void publish();
+
+    QVector<Column> m_columns;
+    QVector<Row> m_rows;
+    uint64_t m_dirty[kMaxRows / 64] = {};
+    QTimer* m_publishTimer = nullptr;
+};
+
+#endif // RECEIVE_TABLE_MODEL_H
@@ -0,0 +1,126 @@
+#ifndef RUNNING_STATS_H
+#define RUNNING_STATS_H
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+
+#include "column_ring.h"
+
+// Min/max/mean/variance over a sliding window of one column, maintained as
+// samples enter and leave. Min and max come from monotonic queues (amortised
+// O(1) per sample); mean and variance from running sums taken relative to
+// the first value seen, which keeps cancellation error small.
+class RunningStats
+{
+public:
+    // Drop all state; the window holds at most capacity samples
+    void reset(int64_t capacity)
+    {
+        m_min.reset(capacity);
+        m_max.reset(capacity);
+        m_minFront = m_minBack = 0;
+        m_maxFront = m_maxBack = 0;
+        m_count = 0;
+        m_sum = 0.0;
+        m_sumSq = 0.0;
+        m_hasOffset = false;
+    }
+
+    // Sample entering at the new end of the window
+    void push(float value)
+    {
+        if (!m_hasOffset) {
+            m_offset = value;
+            m_hasOffset = true;
+        }
+        const double d = static_cast<double>(value) - m_offset;
+        m_sum += d;
+        m_sumSq += d * d;
+        ++m_count;
+
+        // Equal values are kept so pop() can match by value
+        while (m_minBack > m_minFront && m_min.read(m_minBack - 1) > value) {
+            --m_minBack;
+        }
+        m_min.at(m_minBack++) = value;
+        while (m_maxBack > m_maxFront && m_max.read(m_maxBack - 1) < value) {
+            --m_maxBack;
+        }
+        m_max.at(m_maxBack++) = value;
+    }
+
+    // Oldest sample leaving the window; value must be the one pushed for it
+    void pop(float value)
+    {
+        if (m_count == 0) {
+            return;
+        }
+        const double d = static_cast<double>(value) - m_offset;
+        m_sum -= d;
+        m_sumSq -= d * d;
+        --m_count;
+
+        if (m_minBack > m_minFront && m_min.read(m_minFront) == value) {
+            ++m_minFront;
+        }
+        if (m_maxBack > m_maxFront && m_max.read(m_maxFront) == value) {
+            ++m_maxFront;
+        }
+    }
+
+    // Re-sum the window [from, to) exactly so rounding from push/pop pairs
+    // never outlives one lap of the ring
+    void resum(const ColumnRing<float>& column, int64_t from, int64_t to)
+    {
+        m_sum = 0.0;
+        m_sumSq = 0.0;
+        for (int64_t seq = from; seq < to; ++seq) {
+            const double d = static_cast<double>(column.read(seq)) - m_offset;
+            m_sum += d;
+            m_sumSq += d * d;
+        }
+    }
+
+    int64_t count() const { return m_count; }
+    double min() const { return m_count ? m_min.read(m_minFront) : 0.0; }
+    double max() const { return m_count ? m_max.read(m_maxFront) : 0.0; }
+
+    double mean() const
+    {
+        return m_count ? m_offset + m_sum / static_cast<double>(m_count) : 0.0;
+    }
+
+    double variance() const
+    {
+        if (!m_count) {
+            return 0.0;
+        }
+        const double n = static_cast<double>(m_count);
+        const double shifted = m_sum / n;
+        return std::max(m_sumSq / n - shifted * shifted, 0.0);
+    }
+
+    double rms() const
+    {
+        const double m = mean();
+        return std::sqrt(variance() + m * m);
+    }
+
+private:
+    // Queues are addressed by ever-increasing positions, like sample sequences
+    ColumnRing<float> m_min;
+    ColumnRing<float> m_max;
+    int64_t m_minFront = 0;
+    int64_t m_minBack = 0;
+    int64_t m_maxFront = 0;
+    int64_t m_maxBack = 0;
+
+    int64_t m_count = 0;
+    double m_offset = 0.0;
+    bool m_hasOffset = false;
+    double m_sum = 0.0;          // Sum of (value - offset)
+    double m_sumSq = 0.0;        // Sum of (value - offset)^2
+};
+
+#endif // RUNNING_STATS_H
@@ -0,0 +1,108 @@
+#include "sample_queue.h"
+
+#include <QtAlgorithms>
+
+SampleQueue::SampleQueue(size_t capacity)
+    : m_ring(capacity)
+    , m_latest(new LatestSlot[kMaxLatestMotors])
+{
+}
+
+size_t SampleQueue::depth() const
+{
+    size_t pending = m_ring.size();
+    for (const std::atomic<uint64_t>& word : m_dirty) {
+        pending += static_cast<size_t>(qPopulationCount(static_cast<quint64>(word.load(std::memory_order_relaxed))));
+    }
+    return pending;
+}
+
+void SampleQueue::push(const MotorSample& sample)
+{
+    m_pushed.fetch_add(1, std::memory_order_relaxed);
+
+    switch (dropPolicy()) {
+    case DropPolicy::DropOldest:
+        if (!m_ring.pushOverwrite(sample)) {
+            m_overflows.fetch_add(1, std::memory_order_relaxed);
+        }
+        break;
+    case DropPolicy::DropNewest:
+        if (!m_ring.tryPush(sample)) {
+            m_overflows.fetch_add(1, std::memory_order_relaxed);
+        }
+        break;
+    case DropPolicy::LatestPerMotor:
+        pushLatest(sample);
+        break;
+    }
+}
+
+void SampleQueue::pushLatest(const MotorSample& sample)
+{
+    if (sample.motorIndex < 0 || sample.motorIndex >= kMaxLatestMotors) {
+        // No mailbox for this motor, fall back to the ring
+        if (!m_ring.tryPush(sample)) {
+            m_overflows.fetch_add(1, std::memory_order_relaxed);
+        }
+        return;
+    }
+
+    LatestSlot& slot = m_latest[sample.motorIndex];
+    uint32_t seq = slot.sequence.load(std::memory_order_relaxed);
+    slot.sequence.store(seq + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    slot.sample = sample;
+    slot.sequence.store(seq + 2, std::memory_order_release);
+
+    const uint64_t bit = uint64_t(1) << (sample.motorIndex % 64);
+    uint64_t previous = m_dirty[sample.motorIndex / 64].fetch_or(bit, std::memory_order_acq_rel);
+    if (previous & bit) {
+        m_coalesced.fetch_add(1, std::memory_order_relaxed);
+    }
+}
+
+size_t SampleQueue::drainLatest(std::vector<MotorSample>& out)
+{
+    size_t count = 0;
+    for (int w = 0; w < kDirtyWords; ++w) {
+        uint64_t bits = m_dirty[w].exchange(0, std::memory_order_acq_rel);
+        while (bits) {
+            const int bit = static_cast<int>(qCountTrailingZeroBits(static_cast<quint64>(bits)));
+            bits &= bits - 1;
+
+            const LatestSlot& slot = m_latest[w * 64 + bit];
+            MotorSample sample;
+            for (;;) {
+                uint32_t before = slot.sequence.load(std::memory_order_acquire);
+                if (before & 1) {
+                    continue;
+                }
+                sample = slot.sample;
+                std::atomic_thread_fence(std::memory_order_acquire);
+                if (slot.sequence.load(std::memory_order_relaxed) == before) {
+                    break;
+                }
+            }
+            out.push_back(sample);
+            ++count;
+        }
+    }
+    return count;
+}
+
+size_t SampleQueue::drain(std::vector<MotorSample>& out)
+{
+    // Both stores are drained regardless of the current policy so samples
+    // queued before a policy change are not stranded.
+    const size_t start = out.size();
+    size_t available = m_ring.size();
+    if (available > 0) {
+        out.resize(start + available);
+        size_t popped = m_ring.popBatch(out.data() + start, available);
+        out.resize(start + popped);
+    }
+    size_t count = out.size() - start;
+    count += drainLatest(out);
+    return count;
+}
@@ -0,0 +1,66 @@
+#ifndef SAMPLE_QUEUE_H
+#define SAMPLE_QUEUE_H
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+#include "motor_profile.h"
+#include "spsc_ring.h"
+
+// Decoded-sample hand-off from the SDK receive callback (single producer)
+// to the GUI thread (single consumer). Never blocks or allocates on push.
+class SampleQueue
+{
+public:
+    enum class DropPolicy {
+        DropOldest,      // Evict the oldest queued sample when full
+        DropNewest,      // Reject the incoming sample when full
+        LatestPerMotor   // Keep only the most recent sample of each motor
+    };
+
+    static constexpr int kMaxLatestMotors = 256;
+
+    explicit SampleQueue(size_t capacity = 4096);
+
+    void setDropPolicy(DropPolicy policy) { m_policy.store(policy, std::memory_order_relaxed); }
+    DropPolicy dropPolicy() const { return m_policy.load(std::memory_order_relaxed); }
+
+    // Producer side
+    void push(const MotorSample& sample);
+
+    // Consumer side: append everything queued to out, oldest first
+    size_t drain(std::vector<MotorSample>& out);
+
+    // Counters (readable from any thread)
+    size_t capacity() const { return m_ring.capacity(); }
+    size_t depth() const;
+    uint64_t pushedCount() const { return m_pushed.load(std::memory_order_relaxed); }
+    uint64_t overflowCount() const { return m_overflows.load(std::memory_order_relaxed); }
+    uint64_t coalescedCount() const { return m_coalesced.load(std::memory_order_relaxed); }
+
+private:
+    // Seqlock-protected per-motor mailbox for LatestPerMotor
+    struct LatestSlot
+    {
+        std::atomic<uint32_t> sequence{0};
+        MotorSample sample;
+    };
+
+    static constexpr int kDirtyWords = kMaxLatestMotors / 64;
+
+    void pushLatest(const MotorSample& sample);
+    size_t drainLatest(std::vector<MotorSample>& out);
+
+    SpscRing<MotorSample> m_ring;
+    std::unique_ptr<LatestSlot[]> m_latest;
+    std::atomic<uint64_t> m_dirty[kDirtyWords] = {};
+
+    std::atomic<DropPolicy> m_policy{DropPolicy::DropOldest};
+    std::atomic<uint64_t> m_pushed{0};
+    std::atomic<uint64_t> m_overflows{0};
+    std::atomic<uint64_t> m_coalesced{0};
+};
+
+#endif // SAMPLE_QUEUE_H
@@ -0,0 +1,151 @@
+#ifndef SNAPSHOT_CELL_H
+#define SNAPSHOT_CELL_H
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+// Single published pointer to an immutable T, swapped atomically.
+// Readers pin the current snapshot with a hazard slot and never block;
+// writers retire the previous snapshot and free it once no reader has
+// it pinned (checked on every publish and on destruction).
+template <typename T>
+class SnapshotCell
+{
+public:
+    static constexpr int kMaxReaders = 64;
+
+    class Pin
+    {
+    public:
+        Pin(Pin&& other) noexcept
+            : m_cell(other.m_cell), m_slot(other.m_slot), m_ptr(other.m_ptr)
+        {
+            other.m_cell = nullptr;
+        }
+        Pin(const Pin&) = delete;
+        Pin& operator=(const Pin&) = delete;
+        Pin& operator=(Pin&&) = delete;
+
+        ~Pin()
+        {
+            if (m_cell) {
+                m_cell->unpin(m_slot);
+            }
+        }
+
+        const T* get() const { return m_ptr; }
+        const T* operator->() const { return m_ptr; }
+        const T& operator*() const { return *m_ptr; }
+        explicit operator bool() const { return m_ptr != nullptr; }
+
+    private:
+        friend class SnapshotCell;
+        Pin(const SnapshotCell* cell, int slot, const T* ptr)
+            : m_cell(cell), m_slot(slot), m_ptr(ptr)
+        {
+        }
+
+        const SnapshotCell* m_cell;
+        int m_slot;
+        const T* m_ptr;
+    };
+
+    SnapshotCell() = default;
+    SnapshotCell(const SnapshotCell&) = delete;
+    SnapshotCell& operator=(const SnapshotCell&) = delete;
+
+    ~SnapshotCell()
+    {
+        delete m_current.load(std::memory_order_acquire);
+        for (const T* retired : m_retired) {
+            delete retired;
+        }
+    }
+
+    // Reader: pin the current snapshot for the lifetime of the returned Pin.
+    // Lock-free; only spins if all kMaxReaders slots are held at once.
+    Pin pin() const
+    {
+        const int slot = acquireSlot();
+        const T* ptr = m_current.load(std::memory_order_acquire);
+        for (;;) {
+            m_hazards[slot].store(ptr, std::memory_order_seq_cst);
+            const T* again = m_current.load(std::memory_order_seq_cst);
+            if (again == ptr) {
+                break;
+            }
+            ptr = again;
+        }
+        return Pin(this, slot, ptr);
+    }
+
+    // Writer: publish a new snapshot. Callable from any thread.
+    void publish(std::unique_ptr<const T> snapshot)
+    {
+        std::lock_guard<std::mutex> lock(m_writeMutex);
+        const T* previous = m_current.exchange(snapshot.release(), std::memory_order_seq_cst);
+        if (previous) {
+            m_retired.push_back(previous);
+        }
+        reclaim();
+    }
+
+private:
+    int acquireSlot() const
+    {
+        for (;;) {
+            uint64_t used = m_usedSlots.load(std::memory_order_relaxed);
+            uint64_t free = ~used;
+            if (free == 0) {
+                continue;
+            }
+            int slot = 0;
+            while (!(free & (uint64_t(1) << slot))) {
+                ++slot;
+            }
+            const uint64_t bit = uint64_t(1) << slot;
+            if (m_usedSlots.compare_exchange_weak(used, used | bit, std::memory_order_acquire)) {
+                return slot;
+            }
+        }
+    }
+
+    void unpin(int slot) const
+    {
+        m_hazards[slot].store(nullptr, std::memory_order_release);
+        m_usedSlots.fetch_and(~(uint64_t(1) << slot), std::memory_order_release);
+    }
+
+    // Caller holds m_writeMutex
+    void reclaim()
+    {
+        auto it = m_retired.begin();
+        while (it != m_retired.end()) {
+            bool pinned = false;
+            for (const std::atomic<const T*>& hazard : m_hazards) {
+                if (hazard.load(std::memory_order_seq_cst) == *it) {
+                    pinned = true;
+                    break;
+                }
+            }
+            if (pinned) {
+                ++it;
+            } else {
+                delete *it;
+                it = m_retired.erase(it);
+            }
+        }
+    }
+
+    std::atomic<const T*> m_current{nullptr};
+    mutable std::atomic<const T*> m_hazards[kMaxReaders] = {};
+    mutable std::atomic<uint64_t> m_usedSlots{0};
+
+    std::mutex m_writeMutex;
+    std::vector<const T*> m_retired;
+};
+
+#endif // SNAPSHOT_CELL_H
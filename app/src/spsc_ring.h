@@ -0,0 +1,110 @@
+#ifndef SPSC_RING_H
+#define SPSC_RING_H
+
+#include <atomic>
+#include <cstddef>
+#include <type_traits>
+#include <vector>
+
+// Bounded lock-free single-producer/single-consumer ring.
+// Capacity is rounded up to a power of two. The consumer advances the head
+// with a CAS so the producer may also evict the oldest element
+// (pushOverwrite); a consumer read that races with an eviction is detected
+// by the failed CAS and retried, which is why T must be trivially copyable.
+template <typename T>
+class SpscRing
+{
+    static_assert(std::is_trivially_copyable<T>::value, "SpscRing requires a trivially copyable type");
+
+public:
+    explicit SpscRing(size_t capacity = 1024)
+    {
+        size_t size = 2;
+        while (size < capacity) {
+            size <<= 1;
+        }
+        m_slots.resize(size);
+        m_mask = size - 1;
+    }
+
+    SpscRing(const SpscRing&) = delete;
+    SpscRing& operator=(const SpscRing&) = delete;
+
+    size_t capacity() const { return m_mask + 1; }
+
+    size_t size() const
+    {
+        // Head first, as popBatch() does: an eviction only moves the head
+        // forward, so a later tail is never behind it. The tail may have
+        // moved on by a lap meanwhile, hence the clamp.
+        size_t head = m_head.load(std::memory_order_acquire);
+        size_t tail = m_tail.load(std::memory_order_acquire);
+        size_t count = tail - head;
+        return count > m_mask + 1 ? m_mask + 1 : count;
+    }
+
+    bool isEmpty() const { return size() == 0; }
+
+    // Producer: append, or return false if the ring is full
+    bool tryPush(const T& value)
+    {
+        size_t tail = m_tail.load(std::memory_order_relaxed);
+        if (tail - m_head.load(std::memory_order_acquire) > m_mask) {
+            return false;
+        }
+        m_slots[tail & m_mask] = value;
+        m_tail.store(tail + 1, std::memory_order_release);
+        return true;
+    }
+
+    // Producer: append, evicting the oldest element when full.
+    // Returns false if an element was evicted.
+    bool pushOverwrite(const T& value)
+    {
+        size_t tail = m_tail.load(std::memory_order_relaxed);
+        bool evicted = false;
+        size_t head = m_head.load(std::memory_order_acquire);
+        while (tail - head > m_mask) {
+            if (m_head.compare_exchange_weak(head, head + 1, std::memory_order_acq_rel)) {
+                evicted = true;
+                break;
+            }
+        }
+        m_slots[tail & m_mask] = value;
+        m_tail.store(tail + 1, std::memory_order_release);
+        return !evicted;
+    }
+
+    // Consumer: pop up to maxCount elements into out, oldest first
+    size_t popBatch(T* out, size_t maxCount)
+    {
+        for (;;) {
+            size_t head = m_head.load(std::memory_order_acquire);
+            size_t tail = m_tail.load(std::memory_order_acquire);
+            size_t count = tail - head;
+            if (count > maxCount) {
+                count = maxCount;
+            }
+            if (count == 0) {
+                return 0;
+            }
+            for (size_t i = 0; i < count; ++i) {
+                out[i] = m_slots[(head + i) & m_mask];
+            }
+            if (m_head.compare_exchange_strong(head, head + count, std::memory_order_acq_rel)) {
+                return count;
+            }
+            // Producer evicted under us; the copy may be stale, retry
+        }
+    }
+
+    bool tryPop(T& out) { return popBatch(&out, 1) == 1; }
+
+private:
+    alignas(64) std::atomic<size_t> m_head{0};  // Next element to read
+    alignas(64) std::atomic<size_t> m_tail{0};  // Next slot to write
+    alignas(64) size_t m_mask = 0;
+    std::vector<T> m_slots;
+};
+
+#endif // SPSC_RING_H
@@ -0,0 +1,293 @@
+#include "strip_chart_widget.h"
+#include "telemetry_data_store.h"
+
+#include <QPainter>
+#include <QPaintEvent>
+#include <QResizeEvent>
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+namespace {
+constexpr int kLeftMargin = 8;
+constexpr int kRightMargin = 8;
+constexpr int kTopMargin = 8;
+constexpr int kBottomMargin = 20;
+
+// Shortest time span shown, so a single sample still gets an axis
+constexpr double kMinSpanSeconds = 1.0;
+
+// Held history may drift this far from the fitted span before a full redraw
+constexpr double kRefitFraction = 0.25;
+
+// Target spacing of time grid lines
+constexpr int kTickSpacingPx = 100;
+
+const QColor kBackground(255, 255, 255);
+const QColor kGrid(225, 225, 225);
+}
+
+StripChartWidget::StripChartWidget(QWidget* parent)
+    : QWidget(parent)
+{
+    setAttribute(Qt::WA_OpaquePaintEvent);
+    setMinimumSize(200, 120);
+}
+
+void StripChartWidget::setSource(const TelemetryReader* source)
+{
+    m_source = source;
+    m_needsRedraw = true;
+    refresh();
+}
+
+void StripChartWidget::addSeries(int motorIndex, const QString& fieldId, const QString& name, const QColor& color)
+{
+    for (const Series& s : m_series) {
+        if (s.motorIndex == motorIndex && s.fieldId == fieldId) {
+            return;
+        }
+    }
+    Series s;
+    s.motorIndex = motorIndex;
+    s.fieldId = fieldId;
+    s.name = name;
+    s.color = color;
+    m_series.append(s);
+    m_needsRedraw = true;
+}
+
+void StripChartWidget::removeSeries(int motorIndex, const QString& fieldId)
+{
+    for (int i = 0; i < m_series.size(); ++i) {
+        if (m_series[i].motorIndex == motorIndex && m_series[i].fieldId == fieldId) {
+            m_series.removeAt(i);
+            m_needsRedraw = true;
+            update();
+            return;
+        }
+    }
+}
+
+QRect StripChartWidget::plotRect() const
+{
+    return rect().adjusted(kLeftMargin, kTopMargin, -kRightMargin, -kBottomMargin);
+}
+
+void StripChartWidget::refresh()
+{
+    const QRect area = plotRect();
+    if (!m_source || !isVisible() || area.width() < 2 || area.height() < 2) {
+        return;
+    }
+
+    // One-pixel M4 reads give each series' first and last sample time cheaply
+    double earliest = std::numeric_limits<double>::max();
+    double latest = std::numeric_limits<double>::lowest();
+    for (const Series& s : m_series) {
+        m_source->readM4(s.motorIndex, s.fieldId, std::numeric_limits<double>::lowest(),
+                         std::numeric_limits<double>::max(), 1, m_points);
+        if (!m_points.isEmpty()) {
+            earliest = std::min(earliest, m_points.first().x());
+            latest = std::max(latest, m_points.last().x());
+        }
+    }
+    if (earliest > latest) {
+        // Nothing to show (no series, or the store was cleared)
+        if (!m_needsRedraw) {
+            m_needsRedraw = true;
+            m_plot = QPixmap();
+            update();
+        }
+        return;
+    }
+
+    const double span = std::max(latest - earliest, kMinSpanSeconds);
+    if (m_plot.size() != area.size() || latest < m_rightTime
+        || std::abs(span - m_span) > kRefitFraction * m_span) {
+        m_needsRedraw = true;
+    }
+    if (updateScales()) {
+        m_needsRedraw = true;
+    }
+
+    if (m_needsRedraw) {
+        m_span = span;
+        m_secondsPerPixel = span / area.width();
+        m_rightTime = latest;
+        redrawAll();
+        update();
+        return;
+    }
+
+    // Only whole pixel columns are drawn; the rest waits for the next refresh
+    const int dx = static_cast<int>((latest - m_rightTime) / m_secondsPerPixel);
+    if (dx <= 0) {
+        return;
+    }
+    m_rightTime += dx * m_secondsPerPixel;
+    if (dx >= m_plot.width()) {
+        redrawAll();
+    } else {
+        m_plot.scroll(-dx, 0, m_plot.rect());
+        QPainter painter(&m_plot);
+        drawColumns(painter, m_plot.width() - dx, m_plot.width(), true);
+    }
+    update();
+}
+
+bool StripChartWidget::updateScales()
+{
+    bool changed = false;
+    TelemetryReader::FieldStats stats;
+    for (Series& s : m_series) {
+        if (!m_source->fieldStats(s.motorIndex, s.fieldId, stats)) {
+            continue;
+        }
+        // Refit when data leaves the scale or would fit in half of it
+        const double padding = std::max((stats.max - stats.min) * 0.1, 1.0);
+        const double fitted = stats.max - stats.min + 2.0 * padding;
+        if (!s.hasScale || stats.min < s.yMin || stats.max > s.yMax
+            || fitted < 0.5 * (s.yMax - s.yMin)) {
+            s.yMin = stats.min - padding;
+            s.yMax = stats.max + padding;
+            s.hasScale = true;
+            changed = true;
+        }
+    }
+    return changed;
+}
+
+void StripChartWidget::redrawAll()
+{
+    const QRect area = plotRect();
+    if (m_plot.size() != area.size()) {
+        m_plot = QPixmap(area.size());
+    }
+    for (Series& s : m_series) {
+        s.hasLast = false;
+    }
+    QPainter painter(&m_plot);
+    drawColumns(painter, 0, m_plot.width(), false);
+    m_needsRedraw = false;
+}
+
+void StripChartWidget::drawColumns(QPainter& painter, int x0, int x1, bool continueLines)
+{
+    const int height = m_plot.height();
+    const double left = m_rightTime - m_plot.width() * m_secondsPerPixel;
+    const double t0 = left + x0 * m_secondsPerPixel;
+    const double t1 = left + x1 * m_secondsPerPixel;
+
+    painter.fillRect(QRect(x0, 0, x1 - x0, height), kBackground);
+    painter.setPen(kGrid);
+    for (int i = 1; i < 4; ++i) {
+        const int y = height * i / 4;
+        painter.drawLine(x0, y, x1 - 1, y);
+    }
+    const double step = tickStep();
+    for (double t = std::ceil(t0 / step) * step; t < t1; t += step) {
+        const int x = static_cast<int>(xFor(t));
+        painter.drawLine(x, 0, x, height - 1);
+    }
+
+    for (Series& s : m_series) {
+        if (!s.hasScale) {
+            continue;
+        }
+        m_source->readM4(s.motorIndex, s.fieldId, t0, t1, x1 - x0, m_points);
+
+        // Start from the last sample already drawn so the line stays joined
+        const bool joined = continueLines && s.hasLast;
+        m_polyline.clear();
+        if (joined) {
+            m_polyline.append(QPointF(xFor(s.lastTime), yFor(s, s.lastValue)));
+        }
+        for (const QPointF& p : m_points) {
+            if (joined && p.x() <= s.lastTime) {
+                continue;
+            }
+            m_polyline.append(QPointF(xFor(p.x()), yFor(s, p.y())));
+        }
+        if (!m_points.isEmpty() && (!s.hasLast || m_points.last().x() > s.lastTime)) {
+            s.hasLast = true;
+            s.lastTime = m_points.last().x();
+            s.lastValue = m_points.last().y();
+        }
+
+        painter.setPen(QPen(s.color, 1));
+        painter.drawPolyline(m_polyline.constData(), static_cast<int>(m_polyline.size()));
+    }
+}
+
+double StripChartWidget::xFor(double time) const
+{
+    const double left = m_rightTime - m_plot.width() * m_secondsPerPixel;
+    return (time - left) / m_secondsPerPixel;
+}
+
+double StripChartWidget::yFor(const Series& series, double value) const
+{
+    const double bottom = m_plot.height() - 1;
+    return bottom - (value - series.yMin) / (series.yMax - series.yMin) * bottom;
+}
+
+double StripChartWidget::tickStep() const
+{
+    // 1, 2 or 5 times a power of ten, at least kTickSpacingPx apart
+    const double target = m_secondsPerPixel * kTickSpacingPx;
+    const double magnitude = std::pow(10.0, std::floor(std::log10(target)));
+    for (double m : {1.0, 2.0, 5.0}) {
+        if (m * magnitude >= target) {
+            return m * magnitude;
+        }
+    }
+    return 10.0 * magnitude;
+}
+
+void StripChartWidget::paintEvent(QPaintEvent* event)
+{
+    Q_UNUSED(event);
+
+    QPainter painter(this);
+    painter.fillRect(rect(), palette().window());
+
+    const QRect area = plotRect();
+    if (m_plot.isNull() || m_secondsPerPixel <= 0.0) {
+        painter.fillRect(area, kBackground);
+        return;
+    }
+    painter.drawPixmap(area.topLeft(), m_plot);
+    painter.setPen(palette().windowText().color());
+    painter.drawRect(area.adjusted(0, 0, -1, -1));
+
+    // Time labels under the grid lines
+    const double step = tickStep();
+    const int decimals = std::max(0, static_cast<int>(std::ceil(-std::log10(step))));
+    const double left = m_rightTime - m_plot.width() * m_secondsPerPixel;
+    for (double t = std::ceil(left / step) * step; t <= m_rightTime; t += step) {
+        const int x = area.left() + static_cast<int>(xFor(t));
+        painter.drawText(QRect(x - 40, area.bottom() + 2, 80, kBottomMargin - 2),
+                         Qt::AlignHCenter | Qt::AlignTop, QString::number(t, 'f', decimals));
+    }
+
+    // Legend with each series' own scale
+    const QFontMetrics metrics = painter.fontMetrics();
+    int y = area.top() + 4 + metrics.ascent();
+    for (const Series& s : m_series) {
+        painter.setPen(s.color);
+        painter.drawText(area.left() + 6, y, QStringLiteral("%1  [%2 .. %3]")
+                                                 .arg(s.name)
+                                                 .arg(s.yMin, 0, 'g', 5)
+                                                 .arg(s.yMax, 0, 'g', 5));
+        y += metrics.height();
+    }
+}
+
+void StripChartWidget::resizeEvent(QResizeEvent* event)
+{
+    QWidget::resizeEvent(event);
+    m_needsRedraw = true;
+    refresh();
+}
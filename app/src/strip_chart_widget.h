@@ -0,0 +1,72 @@
+#ifndef STRIP_CHART_WIDGET_H
+#define STRIP_CHART_WIDGET_H
+
+#include <QWidget>
+#include <QVector>
+#include <QPixmap>
+#include <QColor>
+#include <QPointF>
+
+class QPainter;
+class TelemetryReader;
+
+// Scrolling strip chart drawn with QPainter straight from M4 reads of the
+// store, or of a snapshot of it while the dashboard is paused. All series
+// share the time axis; each has its own Y scale. The plot is kept in a
+// pixmap that is scrolled as time advances, so a refresh only draws the
+// pixel columns that became complete since the last one.
+class StripChartWidget : public QWidget
+{
+    Q_OBJECT
+public:
+    explicit StripChartWidget(QWidget* parent = nullptr);
+
+    void setSource(const TelemetryReader* source);
+
+    void addSeries(int motorIndex, const QString& fieldId, const QString& name, const QColor& color);
+    void removeSeries(int motorIndex, const QString& fieldId);
+
+public slots:
+    // Pull new data from the store and draw it
+    void refresh();
+
+protected:
+    void paintEvent(QPaintEvent* event) override;
+    void resizeEvent(QResizeEvent* event) override;
+
+private:
+    struct Series {
+        int motorIndex;
+        QString fieldId;
+        QString name;
+        QColor color;
+        double yMin = 0.0;           // Y scale; widened as data needs it
+        double yMax = 0.0;
+        bool hasScale = false;
+        bool hasLast = false;        // Last drawn sample, where the next polyline starts
+        double lastTime = 0.0;
+        double lastValue = 0.0;
+    };
+
+    QRect plotRect() const;
+    bool updateScales();
+    void redrawAll();
+    void drawColumns(QPainter& painter, int x0, int x1, bool continueLines);
+    double xFor(double time) const;
+    double yFor(const Series& series, double value) const;
+    double tickStep() const;
+
+    const TelemetryReader* m_source = nullptr;
+    QVector<Series> m_series;
+    QVector<QPointF> m_points;       // Reused between store reads
+    QVector<QPointF> m_polyline;
+
+    // The pixmap covers (m_rightTime - width * m_secondsPerPixel, m_rightTime]
+    QPixmap m_plot;
+    double m_rightTime = 0.0;
+    double m_secondsPerPixel = 0.0;
+    double m_span = 0.0;             // Held history span the scale was fitted to
+    bool m_needsRedraw = true;
+};
+
+#endif // STRIP_CHART_WIDGET_H
@@ -1,18 +1,37 @@
 #include "telemetry_dashboard.h"
+#include "strip_chart_widget.h"
+#include "profile_snapshot.h"
 
 #include <QVBoxLayout>
 #include <QHBoxLayout>
 #include <QToolBar>
 #include <QSpinBox>
+#include <QDoubleSpinBox>
 #include <QPushButton>
 #include <QComboBox>
 #include <QLabel>
 #include <QSplitter>
+#include <QStackedWidget>
+#include <QShowEvent>
+#include <QHideEvent>
+#include <QResizeEvent>
 #include <QTreeWidget>
 #include <QTreeWidgetItem>
 #include <QHeaderView>
+#include <QCheckBox>
+#include <QFileDialog>
+#include <QFileInfo>
+#include <QCoreApplication>
+#include <QOffscreenSurface>
+#include <QOpenGLContext>
+#include <QOpenGLFunctions>
+
+#include <functional>
 
 #include <algorithm>
+#include <cmath>
+#include <limits>
+#include <unordered_map>
 
 // Color palette for series (colorblind-friendly)
 static const QColor kSeriesColors[] = {
@@ -33,15 +52,112 @@ static const int kNumColors = sizeof(kSeriesColors) / sizeof(kSeriesColors[0]);
 static const int kMotorIndexRole = Qt::UserRole;
 static const int kFieldIdRole = Qt::UserRole + 1;
 
+// Redraws are driven by store changes, at most 60 Hz and never slower than
+// the idle floor while data keeps arriving. In between the interval follows
+// the measured frame cost so plotting stays under a quarter of the GUI thread.
+static const int kMinFrameMs = 16;
+static const int kIdleFrameMs = 250;
+static const int kFrameCostFactor = 4;
+
+// A capture range holding more matching frames than this is loaded from
+// every n-th block; zooming in loads the narrower range in full
+static const uint64_t kMaxCaptureFrames = 1000000;
+static const int kCaptureBatch = 4096;
+static const int kCaptureZoomDelayMs = 150;
+
+// Resizing the history rebuilds every held column, so spin box steps and
+// typing are applied once they settle
+static const int kHistoryDelayMs = 400;
+
+namespace {
+
+// Chart view that reports how long each paint took. With OpenGL series the
+// lines are drawn by QtCharts' own GL child widget, so this covers axes,
+// labels and compositing while the frame count still covers every redraw.
+class TimedChartView : public QChartView
+{
+public:
+    TimedChartView(QChart* chart, std::function<void(double)> onFrame)
+        : QChartView(chart)
+        , m_onFrame(std::move(onFrame))
+    {
+    }
+
+protected:
+    void paintEvent(QPaintEvent* event) override
+    {
+        QElapsedTimer timer;
+        timer.start();
+        QChartView::paintEvent(event);
+        m_onFrame(static_cast<double>(timer.nsecsElapsed()) / 1e6);
+    }
+
+private:
+    std::function<void(double)> m_onFrame;
+};
+
+// Renderer of a throwaway context, or empty when OpenGL is unavailable
+// (e.g. the offscreen platform). Software GL such as llvmpipe still works.
+QString probeOpenGL()
+{
+    QOpenGLContext context;
+    if (!context.create()) {
+        return QString();
+    }
+    QOffscreenSurface surface;
+    surface.setFormat(context.format());
+    surface.create();
+    if (!surface.isValid() || !context.makeCurrent(&surface)) {
+        return QString();
+    }
+    const char* renderer = reinterpret_cast<const char*>(context.functions()->glGetString(GL_RENDERER));
+    QString name = renderer ? QString::fromLatin1(renderer) : QStringLiteral("unknown");
+    context.doneCurrent();
+    return name;
+}
+
+}
+
 TelemetryDashboard::TelemetryDashboard(QWidget* parent)
     : QWidget(parent)
 {
-    setupUi();
-
+    // Single shot, armed by scheduleRefresh(); nothing runs while nothing changes
     m_refreshTimer = new QTimer(this);
-    m_refreshTimer->setInterval(100);  // 10 Hz refresh
+    m_refreshTimer->setSingleShot(true);
     connect(m_refreshTimer, &QTimer::timeout, this, &TelemetryDashboard::refreshChart);
-    m_refreshTimer->start();
+    m_sinceFrame.start();
+
+    // Rubber-band zooms come in bursts; reload the capture once they settle
+    m_captureZoomTimer = new QTimer(this);
+    m_captureZoomTimer->setSingleShot(true);
+    m_captureZoomTimer->setInterval(kCaptureZoomDelayMs);
+    connect(m_captureZoomTimer, &QTimer::timeout, this, &TelemetryDashboard::onCaptureZoomed);
+
+    m_historyTimer = new QTimer(this);
+    m_historyTimer->setSingleShot(true);
+    m_historyTimer->setInterval(kHistoryDelayMs);
+    connect(m_historyTimer, &QTimer::timeout, this, &TelemetryDashboard::onHistoryChanged);
+
+    setupUi();
+
+    // One worker: a newer request simply waits for the running one
+    m_decimatePool.setMaxThreadCount(1);
+    m_capturePool.setMaxThreadCount(1);
+
+    // The store can be torn down before this widget; never leave a worker reading it
+    connect(qApp, &QCoreApplication::aboutToQuit, this, [this]() {
+        m_refreshTimer->stop();
+        m_decimatePool.waitForDone();
+        ++m_captureRequest;
+        m_capturePool.waitForDone();
+    });
+}
+
+TelemetryDashboard::~TelemetryDashboard()
+{
+    m_decimatePool.waitForDone();
+    ++m_captureRequest;
+    m_capturePool.waitForDone();
 }
 
 void TelemetryDashboard::setupUi()
@@ -59,12 +175,13 @@ void TelemetryDashboard::setupUi()
     m_toolbar->addWidget(historyLabel);
 
     m_historySpin = new QSpinBox();
-    m_historySpin->setRange(50, 2000);
+    m_historySpin->setRange(TelemetryDataStore::kMinHistory, TelemetryDataStore::kMaxHistory);
     m_historySpin->setValue(200);
     m_historySpin->setSuffix(QStringLiteral(" samples"));
     m_historySpin->setToolTip(QStringLiteral("Number of samples to display"));
     connect(m_historySpin, QOverload<int>::of(&QSpinBox::valueChanged),
-            this, &TelemetryDashboard::onHistoryChanged);
+            m_historyTimer, QOverload<>::of(&QTimer::start));
+    connect(m_historySpin, &QSpinBox::editingFinished, this, &TelemetryDashboard::onHistoryChanged);
     m_toolbar->addWidget(m_historySpin);
 
     m_toolbar->addSeparator();
@@ -89,6 +206,73 @@ void TelemetryDashboard::setupUi()
             this, &TelemetryDashboard::onYAxisModeChanged);
     m_toolbar->addWidget(m_yAxisMode);
 
+    m_toolbar->addSeparator();
+
+    // GPU rendering; disabled when no OpenGL context can be created
+    m_glRenderer = probeOpenGL();
+    m_openGLCheck = new QCheckBox(QStringLiteral("OpenGL"));
+    m_openGLCheck->setEnabled(!m_glRenderer.isEmpty());
+    m_openGLCheck->setToolTip(m_glRenderer.isEmpty()
+                                  ? QStringLiteral("OpenGL is not available; plotting in software")
+                                  : QStringLiteral("Render series with OpenGL (%1)").arg(m_glRenderer));
+    connect(m_openGLCheck, &QCheckBox::toggled, this, &TelemetryDashboard::onOpenGLToggled);
+    m_toolbar->addWidget(m_openGLCheck);
+
+    m_frameTimeCheck = new QCheckBox(QStringLiteral("Frame time"));
+    m_frameTimeCheck->setToolTip(QStringLiteral("Show measured refresh and paint times"));
+    connect(m_frameTimeCheck, &QCheckBox::toggled, this, &TelemetryDashboard::onFrameTimeToggled);
+    m_toolbar->addWidget(m_frameTimeCheck);
+
+    m_stripChartCheck = new QCheckBox(QStringLiteral("Strip chart"));
+    m_stripChartCheck->setToolTip(QStringLiteral("Plot with the lightweight scrolling strip chart instead of QtCharts"));
+    connect(m_stripChartCheck, &QCheckBox::toggled, this, &TelemetryDashboard::onStripChartToggled);
+    m_toolbar->addWidget(m_stripChartCheck);
+
+    m_toolbar->addSeparator();
+
+    // Capture view; the range controls apply once a capture is open
+    m_openCaptureButton = new QPushButton(QStringLiteral("Open Capture..."));
+    m_openCaptureButton->setToolTip(QStringLiteral("Browse a recorded capture instead of live data"));
+    connect(m_openCaptureButton, &QPushButton::clicked, this, &TelemetryDashboard::onOpenCaptureClicked);
+    m_toolbar->addWidget(m_openCaptureButton);
+
+    m_captureFromSpin = new QDoubleSpinBox();
+    m_captureFromSpin->setDecimals(3);
+    m_captureFromSpin->setSuffix(QStringLiteral(" s"));
+    m_captureFromSpin->setToolTip(QStringLiteral("Start of the range to show, from the start of the capture"));
+    m_toolbar->addWidget(m_captureFromSpin);
+
+    m_captureToSpin = new QDoubleSpinBox();
+    m_captureToSpin->setDecimals(3);
+    m_captureToSpin->setSuffix(QStringLiteral(" s"));
+    m_captureToSpin->setToolTip(QStringLiteral("End of the range to show, from the start of the capture"));
+    m_toolbar->addWidget(m_captureToSpin);
+
+    m_showRangeButton = new QPushButton(QStringLiteral("Show"));
+    connect(m_showRangeButton, &QPushButton::clicked, this, &TelemetryDashboard::onShowCaptureRange);
+    m_toolbar->addWidget(m_showRangeButton);
+
+    m_showAllButton = new QPushButton(QStringLiteral("All"));
+    connect(m_showAllButton, &QPushButton::clicked, this, [this]() {
+        m_chart->zoomReset();
+        loadCaptureRange(0.0, m_captureToSpin->maximum());
+    });
+    m_toolbar->addWidget(m_showAllButton);
+
+    m_liveButton = new QPushButton(QStringLiteral("Live"));
+    m_liveButton->setToolTip(QStringLiteral("Close the capture and return to live data"));
+    connect(m_liveButton, &QPushButton::clicked, this, &TelemetryDashboard::closeCapture);
+    m_toolbar->addWidget(m_liveButton);
+
+    m_captureLabel = new QLabel();
+    m_toolbar->addWidget(m_captureLabel);
+
+    for (QWidget* control : {static_cast<QWidget*>(m_captureFromSpin), static_cast<QWidget*>(m_captureToSpin),
+                             static_cast<QWidget*>(m_showRangeButton), static_cast<QWidget*>(m_showAllButton),
+                             static_cast<QWidget*>(m_liveButton)}) {
+        control->setEnabled(false);
+    }
+
     mainLayout->addWidget(m_toolbar);
 
     // Splitter with tree on left, chart on right
@@ -111,17 +295,46 @@ void TelemetryDashboard::setupUi()
     m_chart->setTitle(QStringLiteral("Telemetry"));
 
     m_axisX = new QValueAxis();
-    m_axisX->setTitleText(QStringLiteral("Sample"));
-    m_axisX->setLabelFormat("%d");
+    m_axisX->setTitleText(QStringLiteral("Time (s)"));
+    m_axisX->setLabelFormat("%.2f");
     m_chart->addAxis(m_axisX, Qt::AlignBottom);
 
     m_axisY = new QValueAxis();
     m_axisY->setTitleText(QStringLiteral("Value"));
     m_chart->addAxis(m_axisY, Qt::AlignLeft);
 
-    m_chartView = new QChartView(m_chart);
+    m_chartView = new TimedChartView(m_chart, [this](double paintMs) { recordFrame(paintMs); });
     m_chartView->setRenderHint(QPainter::Antialiasing);
-    m_splitter->addWidget(m_chartView);
+
+    // Rubber-band zoom on the frozen data while paused; decimated series are
+    // recomputed for the zoomed range, and a capture reloads it from the file
+    connect(m_axisX, &QValueAxis::rangeChanged, this, [this]() {
+        if (m_paused && m_chart->isZoomed()) {
+            m_decimatedRevision = 0;
+            requestFullRefresh();
+            if (m_capture) {
+                m_captureZoomTimer->start();
+            }
+        }
+    });
+
+    m_stripChart = new StripChartWidget();
+
+    m_plotStack = new QStackedWidget();
+    m_plotStack->addWidget(m_chartView);
+    m_plotStack->addWidget(m_stripChart);
+    m_splitter->addWidget(m_plotStack);
+
+    m_frameOverlay = new QLabel(m_chartView);
+    m_frameOverlay->setStyleSheet(QStringLiteral(
+        "QLabel { background: rgba(0, 0, 0, 160); color: white; padding: 4px; font-family: monospace; }"));
+    m_frameOverlay->setAttribute(Qt::WA_TransparentForMouseEvents);
+    m_frameOverlay->move(8, 8);
+    m_frameOverlay->hide();
+
+    m_overlayTimer = new QTimer(this);
+    m_overlayTimer->setInterval(500);
+    connect(m_overlayTimer, &QTimer::timeout, this, &TelemetryDashboard::updateFrameOverlay);
 
     // Set splitter proportions (tree: 1, chart: 4)
     m_splitter->setStretchFactor(0, 1);
@@ -132,16 +345,32 @@ void TelemetryDashboard::setupUi()
 
 void TelemetryDashboard::setDataStore(TelemetryDataStore* store)
 {
+    m_decimatePool.waitForDone();
+    if (m_dataStore) {
+        disconnect(m_dataStore, nullptr, this, nullptr);
+    }
     m_dataStore = store;
+    if (!m_capture) {
+        m_snapshot = (m_paused && m_dataStore) ? m_dataStore->snapshot() : nullptr;
+    }
+    m_stripChart->setSource(reader());
     if (m_dataStore) {
         m_dataStore->setHistorySize(m_historySpin->value());
+        connect(m_dataStore, &TelemetryDataStore::dataUpdated, this, &TelemetryDashboard::onDataUpdated);
+        connect(m_dataStore, &TelemetryDataStore::historyResized, this, &TelemetryDashboard::requestFullRefresh);
     }
+    requestFullRefresh();
 }
 
 void TelemetryDashboard::setActiveProfile(const MotorProfile& profile)
 {
     m_activeProfile = profile;
     rebuildTree();
+    if (m_capture) {
+        // The capture holds raw frames; decode them again with the new profile
+        loadCaptureRange(m_captureFrom, m_captureTo);
+    }
+    requestFullRefresh();
 }
 
 void TelemetryDashboard::rebuildTree()
@@ -243,6 +472,7 @@ void TelemetryDashboard::addSeries(int motorIndex, const QString& fieldId, const
     pen.setWidth(2);
     series->setPen(pen);
 
+    series->setUseOpenGL(m_useOpenGL);
     m_chart->addSeries(series);
     series->attachAxis(m_axisX);
     series->attachAxis(m_axisY);
@@ -254,6 +484,10 @@ void TelemetryDashboard::addSeries(int motorIndex, const QString& fieldId, const
     ps.series = series;
     ps.color = color;
     m_activeSeries.append(ps);
+    ++m_seriesVersion;
+
+    m_stripChart->addSeries(motorIndex, fieldId, displayName, color);
+    requestFullRefresh();
 }
 
 void TelemetryDashboard::removeSeries(int motorIndex, const QString& fieldId)
@@ -262,9 +496,11 @@ void TelemetryDashboard::removeSeries(int motorIndex, const QString& fieldId)
         if (m_activeSeries[i].motorIndex == motorIndex &&
             m_activeSeries[i].fieldId == fieldId) {
 
+            m_stripChart->removeSeries(motorIndex, fieldId);
             m_chart->removeSeries(m_activeSeries[i].series);
             delete m_activeSeries[i].series;
             m_activeSeries.removeAt(i);
+            requestFullRefresh();
             return;
         }
     }
@@ -272,7 +508,25 @@ void TelemetryDashboard::removeSeries(int motorIndex, const QString& fieldId)
 
 void TelemetryDashboard::refreshChart()
 {
-    if (m_paused || !m_dataStore || m_activeSeries.isEmpty()) {
+    if (!m_dataStore || (m_paused && !m_touchAll)) {
+        return;
+    }
+
+    // Only motors that received samples since the last frame are read again;
+    // while paused only layout changes redraw, from the snapshot
+    const QSet<int> changed = m_paused ? QSet<int>() : m_dataStore->consumeChangedMotors();
+    const bool touchAll = m_touchAll;
+    m_touchAll = false;
+    if (m_activeSeries.isEmpty() || (changed.isEmpty() && !touchAll && !m_decimationStale)) {
+        return;
+    }
+
+    QElapsedTimer refreshTimer;
+    refreshTimer.start();
+
+    if (m_plotStack->currentWidget() == m_stripChart) {
+        m_stripChart->refresh();
+        finishFrame(refreshTimer);
         return;
     }
 
@@ -281,25 +535,35 @@ void TelemetryDashboard::refreshChart()
     double yMin = std::numeric_limits<double>::max();
     double yMax = std::numeric_limits<double>::lowest();
 
+    // Past a couple of samples per pixel a series is drawn from its M4
+    // decimation, which the worker refreshes when data or width change
+    const int pixels = std::max(static_cast<int>(m_chart->plotArea().width()), 1);
+    bool needsDecimation = false;
+
     for (PlotSeries& ps : m_activeSeries) {
-        QVector<QPointF> points = m_dataStore->getSeries(ps.motorIndex, ps.fieldId);
-        ps.series->replace(points);
+        if (touchAll || changed.contains(ps.motorIndex)) {
+            updateSeries(ps, pixels);
+        }
+        needsDecimation = needsDecimation || ps.decimated;
 
-        if (!points.isEmpty()) {
-            xMin = std::min(xMin, points.first().x());
-            xMax = std::max(xMax, points.last().x());
+        if (ps.hasRange) {
+            xMin = std::min(xMin, ps.xFirst);
+            xMax = std::max(xMax, ps.xLast);
+            yMin = std::min(yMin, ps.yLow);
+            yMax = std::max(yMax, ps.yHigh);
+        }
+    }
 
-            if (m_autoScale) {
-                for (const QPointF& p : points) {
-                    yMin = std::min(yMin, p.y());
-                    yMax = std::max(yMax, p.y());
-                }
-            }
+    if (needsDecimation && !m_decimating) {
+        const quint64 revision = reader()->revision();
+        if (revision != m_decimatedRevision || pixels != m_decimatedPixels
+            || m_seriesVersion != m_decimatedSeriesVersion) {
+            startDecimation(pixels, revision);
         }
     }
 
-    // Update axis ranges
-    if (xMin < xMax) {
+    // Update axis ranges, unless the user zoomed into the paused data
+    if (xMin < xMax && !(m_paused && m_chart->isZoomed())) {
         m_axisX->setRange(xMin, xMax);
     }
 
@@ -308,6 +572,179 @@ void TelemetryDashboard::refreshChart()
         if (padding < 1.0) padding = 1.0;
         m_axisY->setRange(yMin - padding, yMax + padding);
     }
+
+    finishFrame(refreshTimer);
+}
+
+void TelemetryDashboard::updateSeries(PlotSeries& ps, int pixels)
+{
+    const TelemetryReader* source = reader();
+    ps.decimated = source->sampleCount(ps.motorIndex) > 2 * pixels;
+    if (ps.decimated) {
+        // Raw mode resyncs from scratch when the history shrinks again
+        ps.cursor = TelemetryDataStore::SeriesCursor();
+    } else if (source->readSince(ps.motorIndex, ps.fieldId, ps.cursor, m_delta)) {
+        // Only what changed since the last read crosses the store lock
+        if (m_delta.reset) {
+            ps.series->replace(m_delta.points);
+        } else {
+            const int dropped = std::min(m_delta.dropped, ps.series->count());
+            if (dropped > 0) {
+                ps.series->removePoints(0, dropped);
+            }
+            if (!m_delta.points.isEmpty()) {
+                ps.series->append(m_delta.points);
+            }
+        }
+    }
+
+    // The store keeps window min/max up to date, so no point is rescanned
+    TelemetryDataStore::FieldStats stats;
+    const int count = ps.series->count();
+    ps.hasRange = count > 0 && source->fieldStats(ps.motorIndex, ps.fieldId, stats);
+    if (ps.hasRange) {
+        ps.xFirst = ps.series->at(0).x();
+        ps.xLast = ps.series->at(count - 1).x();
+        ps.yLow = stats.min;
+        ps.yHigh = stats.max;
+    }
+}
+
+const TelemetryReader* TelemetryDashboard::reader() const
+{
+    if (m_snapshot) {
+        return m_snapshot.get();
+    }
+    return m_dataStore;
+}
+
+void TelemetryDashboard::finishFrame(const QElapsedTimer& refreshTimer)
+{
+    m_refreshMs = static_cast<double>(refreshTimer.nsecsElapsed()) / 1e6;
+
+    // Slow down when frames get expensive, never beyond the idle floor
+    const double cost = m_refreshMs + m_lastPaintMs;
+    m_frameIntervalMs = std::clamp(static_cast<int>(cost * kFrameCostFactor), kMinFrameMs, kIdleFrameMs);
+    m_sinceFrame.restart();
+}
+
+void TelemetryDashboard::onDataUpdated(int motorIndex)
+{
+    Q_UNUSED(motorIndex);
+    scheduleRefresh();
+}
+
+void TelemetryDashboard::requestFullRefresh()
+{
+    m_touchAll = true;
+    scheduleRefresh();
+}
+
+void TelemetryDashboard::scheduleRefresh()
+{
+    // Hidden tabs and minimized windows draw nothing; showing them again
+    // requests a full refresh
+    if ((m_paused && !m_touchAll) || m_refreshTimer->isActive() || !isVisible() || window()->isMinimized()) {
+        return;
+    }
+    const qint64 wait = m_frameIntervalMs - m_sinceFrame.elapsed();
+    m_refreshTimer->start(static_cast<int>(std::max<qint64>(wait, 0)));
+}
+
+void TelemetryDashboard::showEvent(QShowEvent* event)
+{
+    QWidget::showEvent(event);
+    if (!m_watchingWindow) {
+        window()->installEventFilter(this);
+        m_watchingWindow = true;
+    }
+    requestFullRefresh();
+}
+
+void TelemetryDashboard::hideEvent(QHideEvent* event)
+{
+    QWidget::hideEvent(event);
+    m_refreshTimer->stop();
+}
+
+void TelemetryDashboard::resizeEvent(QResizeEvent* event)
+{
+    QWidget::resizeEvent(event);
+    requestFullRefresh();
+}
+
+bool TelemetryDashboard::eventFilter(QObject* watched, QEvent* event)
+{
+    if (watched == window() && event->type() == QEvent::WindowStateChange) {
+        if (window()->isMinimized()) {
+            m_refreshTimer->stop();
+        } else {
+            requestFullRefresh();
+        }
+    }
+    return QWidget::eventFilter(watched, event);
+}
+
+void TelemetryDashboard::startDecimation(int pixels, quint64 revision)
+{
+    QVector<DecimatedSeries> jobs;
+    for (const PlotSeries& ps : m_activeSeries) {
+        if (ps.decimated) {
+            jobs.append(DecimatedSeries{ps.motorIndex, ps.fieldId, QVector<QPointF>()});
+        }
+    }
+
+    m_decimating = true;
+    m_decimationStale = false;
+    m_decimatedRevision = revision;
+    m_decimatedPixels = pixels;
+    m_decimatedSeriesVersion = m_seriesVersion;
+
+    // A zoomed pause only needs the visible range
+    const bool zoomed = m_paused && m_chart->isZoomed();
+    const double t0 = zoomed ? m_axisX->min() : std::numeric_limits<double>::lowest();
+    const double t1 = zoomed ? m_axisX->max() : std::numeric_limits<double>::max();
+
+    // The task holds its own reference to the snapshot, which may be
+    // released here on resume before it finishes
+    TelemetryDataStore* store = m_dataStore;
+    const TelemetryDataStore::SnapshotPtr snapshot = m_snapshot;
+    m_decimatePool.start([this, store, snapshot, jobs, pixels, t0, t1]() mutable {
+        const TelemetryReader* source = snapshot ? static_cast<const TelemetryReader*>(snapshot.get()) : store;
+        for (DecimatedSeries& job : jobs) {
+            source->readM4(job.motorIndex, job.fieldId, t0, t1, pixels, job.points);
+        }
+        // The destructor waits for this task, so this is still alive here
+        QMetaObject::invokeMethod(this, [this, jobs]() {
+            applyDecimation(jobs);
+        }, Qt::QueuedConnection);
+    });
+}
+
+void TelemetryDashboard::applyDecimation(const QVector<DecimatedSeries>& results)
+{
+    m_decimating = false;
+    for (const DecimatedSeries& result : results) {
+        for (PlotSeries& ps : m_activeSeries) {
+            // Series removed or back in raw mode meanwhile are left alone
+            if (ps.decimated && ps.motorIndex == result.motorIndex && ps.fieldId == result.fieldId) {
+                ps.series->replace(result.points);
+                if (!result.points.isEmpty()) {
+                    ps.xFirst = result.points.first().x();
+                    ps.xLast = result.points.last().x();
+                }
+                break;
+            }
+        }
+    }
+
+    // Data that arrived while the worker ran is picked up by the next
+    // frame: only the motors that changed are read again, and the revision
+    // check there starts the next decimation
+    if (m_dataStore && reader()->revision() != m_decimatedRevision) {
+        m_decimationStale = true;
+        scheduleRefresh();
+    }
 }
 
 void TelemetryDashboard::setPaused(bool paused)
@@ -315,12 +752,281 @@ void TelemetryDashboard::setPaused(bool paused)
     m_paused = paused;
     m_pauseButton->setChecked(paused);
     m_pauseButton->setText(paused ? QStringLiteral("Resume") : QStringLiteral("Pause"));
+
+    // Freeze what is on screen; capture carries on into the store
+    if (!paused) {
+        m_snapshot.reset();
+    } else if (!m_snapshot && m_dataStore) {
+        m_snapshot = m_dataStore->snapshot();
+    }
+    m_stripChart->setSource(reader());
+    m_chartView->setRubberBand(paused ? QChartView::HorizontalRubberBand : QChartView::NoRubberBand);
+    m_refreshTimer->stop();
+    if (!paused) {
+        m_chart->zoomReset();
+        m_decimatedRevision = 0;
+    }
+    requestFullRefresh();
+}
+
+void TelemetryDashboard::onOpenCaptureClicked()
+{
+    const QString path = QFileDialog::getOpenFileName(this, QStringLiteral("Open Capture"), QString(),
+                                                      QStringLiteral("Frame captures (*.dmcap)"));
+    if (path.isEmpty()) {
+        return;
+    }
+    // Opening maps the file and reads its footer; a file without an index
+    // footer is indexed on the worker by reading it once
+    auto capture = std::make_shared<CaptureFile>();
+    QString error;
+    if (!capture->open(path, &error)) {
+        m_captureLabel->setText(QStringLiteral("Open failed: %1").arg(error));
+        return;
+    }
+
+    CaptureLoad load;
+    load.capture = capture;
+    load.opening = true;
+    load.to = std::numeric_limits<double>::max();
+    m_captureOpening = true;
+    m_captureLabel->setText(QStringLiteral("%1: loading...").arg(QFileInfo(path).fileName()));
+    startCaptureLoad(std::move(load));
+}
+
+void TelemetryDashboard::onShowCaptureRange()
+{
+    m_chart->zoomReset();
+    loadCaptureRange(m_captureFromSpin->value(), m_captureToSpin->value());
+}
+
+void TelemetryDashboard::onCaptureZoomed()
+{
+    if (!m_capture || !m_chart->isZoomed()) {
+        return;
+    }
+    // Everything in the loaded range is already there when it was loaded in full
+    const double from = std::max(m_axisX->min(), 0.0);
+    const double to = std::min(m_axisX->max(), m_captureToSpin->maximum());
+    if (m_captureStride == 1 && from >= m_captureFrom && to <= m_captureTo) {
+        return;
+    }
+    loadCaptureRange(from, to);
+}
+
+void TelemetryDashboard::closeCapture()
+{
+    m_captureZoomTimer->stop();
+    ++m_captureRequest;
+    m_captureOpening = false;
+    m_capture.reset();
+    m_snapshot.reset();
+    for (QWidget* control : {static_cast<QWidget*>(m_captureFromSpin), static_cast<QWidget*>(m_captureToSpin),
+                             static_cast<QWidget*>(m_showRangeButton), static_cast<QWidget*>(m_showAllButton),
+                             static_cast<QWidget*>(m_liveButton)}) {
+        control->setEnabled(false);
+    }
+    m_captureLabel->clear();
+    m_pauseButton->setEnabled(true);
+    setPaused(false);
 }
 
-void TelemetryDashboard::onHistoryChanged(int value)
+void TelemetryDashboard::loadCaptureRange(double from, double to)
 {
+    // The file being opened replaces the shown one once it is loaded
+    if (!m_capture || m_captureOpening) {
+        return;
+    }
+    if (from > to) {
+        std::swap(from, to);
+    }
+    CaptureLoad load;
+    load.capture = m_capture;
+    load.from = from;
+    load.to = to;
+    m_captureLabel->setText(QStringLiteral("%1: loading...").arg(QFileInfo(m_capture->path()).fileName()));
+    startCaptureLoad(std::move(load));
+}
+
+void TelemetryDashboard::startCaptureLoad(CaptureLoad load)
+{
+    load.request = ++m_captureRequest;
+
+    // The destructor abandons and waits for this task, so this is still alive in it
+    m_capturePool.start([this, load, profile = m_activeProfile]() mutable {
+        if (!readCaptureRange(load, profile)) {
+            return;
+        }
+        QMetaObject::invokeMethod(this, [this, load]() {
+            applyCaptureLoad(load);
+        }, Qt::QueuedConnection);
+    });
+}
+
+bool TelemetryDashboard::readCaptureRange(CaptureLoad& load, const MotorProfile& motorProfile) const
+{
+    // Runs on m_capturePool; reads nothing of the widget but the request counter
+    const auto compiled = ProfileSnapshot::build(motorProfile);
+    const ProfileSnapshot& profile = *compiled;
+    auto abandoned = [this, &load]() {
+        return m_captureRequest.load(std::memory_order_relaxed) != load.request;
+    };
+    CaptureFile& capture = *load.capture;
+    if (load.opening) {
+        capture.scanIndex();
+        const double duration = static_cast<double>(capture.lastTimeNs() - capture.firstTimeNs()) * 1e-9;
+        load.to = std::min(load.to, duration);
+    }
+
+    const int64_t origin = capture.firstTimeNs();
+    const int64_t t0 = origin + static_cast<int64_t>(std::floor(load.from * 1e9));
+    const int64_t t1 = origin + static_cast<int64_t>(std::ceil(load.to * 1e9));
+    const std::vector<CaptureBlockEntry>& blocks = capture.blocks();
+
+    // The per-ID summaries tell which blocks hold frames a motor decodes,
+    // and how many, before any record page is touched
+    std::vector<int> selected;
+    uint64_t matched = 0;
+    for (int index : capture.blocksInRange(t0, t1)) {
+        const CaptureBlockEntry& block = blocks[index];
+        if (block.flags & CaptureFormat::Tx) {
+            continue;
+        }
+        const CanDispatchTable& dispatch = profile.dispatchFor(block.bus);
+        const CaptureIdSummary* summaries = capture.summaries(block);
+        uint64_t frames = 0;
+        for (int i = 0; i < block.summaryCount; ++i) {
+            if (summaries[i].lastTimeNs >= t0 && summaries[i].firstTimeNs <= t1
+                && dispatch.lookup(summaries[i].canId) >= 0) {
+                frames += summaries[i].frames;
+            }
+        }
+        if (frames > 0) {
+            selected.push_back(index);
+            matched += frames;
+        }
+    }
+    const int stride = static_cast<int>(std::max<uint64_t>(1, (matched + kMaxCaptureFrames - 1) / kMaxCaptureFrames));
+
+    // History is sized for the busiest motor up front, so nothing loaded is trimmed
+    std::unordered_map<int, int64_t> perMotor;
+    int64_t busiest = 0;
+    for (size_t i = 0; i < selected.size(); i += stride) {
+        const CaptureBlockEntry& block = blocks[selected[i]];
+        const CanDispatchTable& dispatch = profile.dispatchFor(block.bus);
+        const CaptureIdSummary* summaries = capture.summaries(block);
+        for (int j = 0; j < block.summaryCount; ++j) {
+            const int motorIndex = dispatch.lookup(summaries[j].canId);
+            if (motorIndex >= 0) {
+                busiest = std::max(busiest, perMotor[motorIndex] += summaries[j].frames);
+            }
+        }
+    }
+
+    // A store of the load's own; only its snapshot leaves this thread
+    TelemetryDataStore store;
+    store.setActiveProfile(motorProfile);
+    store.setTimeOrigin(origin);
+    store.setHistorySize(static_cast<int>(std::min<int64_t>(busiest, TelemetryDataStore::kMaxHistory)));
+
+    // Blocks are in time order, so each motor's samples are appended in order
+    MotorSampleBatch batch;
+    batch.reserve(kCaptureBatch);
+    uint64_t loaded = 0;
+    usb_rx_frame_t frame;
+    for (size_t i = 0; i < selected.size(); i += stride) {
+        if (abandoned()) {
+            return false;
+        }
+        const CaptureBlockEntry& block = blocks[selected[i]];
+        const CanDispatchTable& dispatch = profile.dispatchFor(block.bus);
+        capture.forEachRecord(block, [&](const CaptureRecord& record, const uint8_t* payload) {
+            if (record.hostTimeNs < t0 || record.hostTimeNs > t1) {
+                return;
+            }
+            const int motorIndex = dispatch.lookup(record.canId);
+            if (motorIndex < 0) {
+                return;
+            }
+            CaptureFormat::decode(record, payload, frame);
+            MotorSample sample;
+            sample.motorIndex = motorIndex;
+            sample.bus = block.bus;
+            sample.timestampNs = record.hostTimeNs;
+            sample.deviceTimestamp = record.deviceTime;
+            profile.decodePlan.decode(motorIndex, frame.payload, sample.measure);
+            batch.append(sample);
+            ++loaded;
+            if (batch.size() == kCaptureBatch) {
+                store.onMotorsUpdated(batch);
+                batch.clear();
+            }
+        });
+    }
+    store.onMotorsUpdated(batch);
+
+    load.stride = stride;
+    load.loaded = loaded;
+    load.blocksLoaded = (selected.size() + stride - 1) / stride;
+    load.snapshot = store.snapshot();
+    return !abandoned();
+}
+
+void TelemetryDashboard::applyCaptureLoad(const CaptureLoad& load)
+{
+    // Superseded meanwhile, or the capture was closed
+    if (load.request != m_captureRequest.load(std::memory_order_relaxed)) {
+        return;
+    }
+    const CaptureFile& capture = *load.capture;
+    if (load.opening) {
+        m_captureOpening = false;
+        m_capture = load.capture;
+        const double duration = static_cast<double>(capture.lastTimeNs() - capture.firstTimeNs()) * 1e-9;
+        for (QDoubleSpinBox* spin : {m_captureFromSpin, m_captureToSpin}) {
+            spin->setRange(0.0, duration);
+            spin->setEnabled(true);
+        }
+        m_showRangeButton->setEnabled(true);
+        m_showAllButton->setEnabled(true);
+        m_liveButton->setEnabled(true);
+
+        // A capture is browsed like paused data; live capture carries on underneath
+        setPaused(true);
+        m_pauseButton->setEnabled(false);
+        m_chart->zoomReset();
+    }
+
+    m_captureFrom = load.from;
+    m_captureTo = load.to;
+    m_captureStride = load.stride;
+    m_captureFromSpin->setValue(load.from);
+    m_captureToSpin->setValue(load.to);
+    QString text = QStringLiteral("%1: %2 frames from %3 of %4 blocks")
+                       .arg(QFileInfo(capture.path()).fileName())
+                       .arg(load.loaded)
+                       .arg(load.blocksLoaded)
+                       .arg(capture.blocks().size());
+    if (load.stride > 1) {
+        text += QStringLiteral(", 1 block in %1; zoom in for all").arg(load.stride);
+    }
+    if (!capture.isIndexed()) {
+        text += QStringLiteral(", no index");
+    }
+    m_captureLabel->setText(text);
+
+    m_snapshot = load.snapshot;
+    m_stripChart->setSource(reader());
+    m_decimatedRevision = 0;
+    requestFullRefresh();
+}
+
+void TelemetryDashboard::onHistoryChanged()
+{
+    m_historyTimer->stop();
     if (m_dataStore) {
-        m_dataStore->setHistorySize(value);
+        // Applied on a worker; historyResized() triggers the redraw
+        m_dataStore->setHistorySize(m_historySpin->value());
     }
 }
 
@@ -336,6 +1042,75 @@ void TelemetryDashboard::onYAxisModeChanged(int index)
         // Set a reasonable fixed range
         m_axisY->setRange(-20000, 20000);
     }
+    requestFullRefresh();
+}
+
+void TelemetryDashboard::onOpenGLToggled(bool enabled)
+{
+    m_useOpenGL = enabled && !m_glRenderer.isEmpty();
+    for (const PlotSeries& ps : m_activeSeries) {
+        ps.series->setUseOpenGL(m_useOpenGL);
+    }
+    requestFullRefresh();
+}
+
+void TelemetryDashboard::onFrameTimeToggled(bool enabled)
+{
+    m_frameOverlay->setVisible(enabled);
+    if (enabled) {
+        m_frames = 0;
+        m_paintMsSum = 0.0;
+        m_paintMsMax = 0.0;
+        m_frameClock.start();
+        updateFrameOverlay();
+        m_overlayTimer->start();
+    } else {
+        m_overlayTimer->stop();
+    }
+}
+
+void TelemetryDashboard::onStripChartToggled(bool enabled)
+{
+    m_plotStack->setCurrentWidget(enabled ? static_cast<QWidget*>(m_stripChart) : m_chartView);
+    m_openGLCheck->setEnabled(!enabled && !m_glRenderer.isEmpty());
+    if (!enabled) {
+        // QtCharts series were not fed meanwhile; resync them from scratch
+        for (PlotSeries& ps : m_activeSeries) {
+            ps.cursor = TelemetryDataStore::SeriesCursor();
+        }
+        m_decimatedRevision = 0;
+    }
+    requestFullRefresh();
+}
+
+void TelemetryDashboard::recordFrame(double paintMs)
+{
+    ++m_frames;
+    m_lastPaintMs = paintMs;
+    m_paintMsSum += paintMs;
+    m_paintMsMax = std::max(m_paintMsMax, paintMs);
+}
+
+void TelemetryDashboard::updateFrameOverlay()
+{
+    // Updating the label repaints the view beneath it: two extra frames a second
+    const double seconds = m_frameClock.isValid() ? m_frameClock.restart() / 1000.0 : 0.0;
+    const double fps = seconds > 0.0 ? m_frames / seconds : 0.0;
+    const double meanMs = m_frames > 0 ? m_paintMsSum / m_frames : 0.0;
+
+    m_frameOverlay->setText(QStringLiteral("%1 | %2 series\n%3 fps  paint %4 ms (max %5)\nrefresh %6 ms")
+                                .arg(m_useOpenGL ? QStringLiteral("OpenGL: %1").arg(m_glRenderer)
+                                                 : QStringLiteral("Raster"))
+                                .arg(m_activeSeries.size())
+                                .arg(fps, 0, 'f', 1)
+                                .arg(meanMs, 0, 'f', 2)
+                                .arg(m_paintMsMax, 0, 'f', 2)
+                                .arg(m_refreshMs, 0, 'f', 2));
+    m_frameOverlay->adjustSize();
+
+    m_frames = 0;
+    m_paintMsSum = 0.0;
+    m_paintMsMax = 0.0;
 }
 
 void TelemetryDashboard::updateAxisRanges()
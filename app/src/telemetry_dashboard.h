@@ -5,6 +5,8 @@
 #include <QVector>
 #include <QTimer>
 #include <QColor>
+#include <QThreadPool>
+#include <QElapsedTimer>
 
 #include <QChart>
 #include <QChartView>
@@ -13,20 +15,30 @@
 
 #include "motor_profile.h"
 #include "telemetry_data_store.h"
+#include "capture_file.h"
+
+#include <atomic>
+#include <memory>
 
 class QTreeWidget;
 class QTreeWidgetItem;
 class QToolBar;
 class QSpinBox;
+class QDoubleSpinBox;
 class QPushButton;
 class QComboBox;
 class QSplitter;
+class QCheckBox;
+class QLabel;
+class QStackedWidget;
+class StripChartWidget;
 
 class TelemetryDashboard : public QWidget
 {
     Q_OBJECT
 public:
     explicit TelemetryDashboard(QWidget* parent = nullptr);
+    ~TelemetryDashboard() override;
 
     void setDataStore(TelemetryDataStore* store);
     void setActiveProfile(const MotorProfile& profile);
@@ -35,11 +47,25 @@ public slots:
     void refreshChart();
     void setPaused(bool paused);
 
+protected:
+    void showEvent(QShowEvent* event) override;
+    void hideEvent(QHideEvent* event) override;
+    void resizeEvent(QResizeEvent* event) override;
+    bool eventFilter(QObject* watched, QEvent* event) override;
+
 private slots:
-    void onHistoryChanged(int value);
+    void onDataUpdated(int motorIndex);
+    void onHistoryChanged();
     void onPauseClicked();
     void onYAxisModeChanged(int index);
     void onSeriesToggled(QTreeWidgetItem* item, int column);
+    void onOpenGLToggled(bool enabled);
+    void onFrameTimeToggled(bool enabled);
+    void onStripChartToggled(bool enabled);
+    void onOpenCaptureClicked();
+    void onShowCaptureRange();
+    void onCaptureZoomed();
+    void closeCapture();
 
 private:
     void setupUi();
@@ -48,6 +74,42 @@ private:
     void removeSeries(int motorIndex, const QString& fieldId);
     QColor nextSeriesColor();
     void updateAxisRanges();
+    void recordFrame(double paintMs);
+
+    // Decode the capture's frames in [from, to] seconds from its start on
+    // m_capturePool and show them once loaded
+    void loadCaptureRange(double from, double to);
+
+    // Capture loads run on m_capturePool; results come back queued. A newer
+    // request abandons the one still running.
+    struct CaptureLoad {
+        quint64 request = 0;
+        std::shared_ptr<CaptureFile> capture;
+        bool opening = false;                    // Index the file first, then load all of it
+        double from = 0.0;
+        double to = 0.0;
+        int stride = 1;
+        uint64_t loaded = 0;
+        size_t blocksLoaded = 0;
+        TelemetryDataStore::SnapshotPtr snapshot;
+    };
+    void startCaptureLoad(CaptureLoad load);
+    bool readCaptureRange(CaptureLoad& load, const MotorProfile& profile) const;
+    void applyCaptureLoad(const CaptureLoad& load);
+
+    // Change-driven refresh: the store's dataUpdated arms a single-shot timer
+    void scheduleRefresh();
+    void requestFullRefresh();
+    void updateFrameOverlay();
+
+    // Decimation runs on m_decimatePool; results come back queued
+    struct DecimatedSeries {
+        int motorIndex;
+        QString fieldId;
+        QVector<QPointF> points;
+    };
+    void startDecimation(int pixels, quint64 revision);
+    void applyDecimation(const QVector<DecimatedSeries>& results);
 
     // Series tracking
     struct PlotSeries {
@@ -56,21 +118,62 @@ private:
         QString displayName;
         QLineSeries* series;
         QColor color;
+        TelemetryDataStore::SeriesCursor cursor;  // What the series already shows
+        bool decimated = false;                   // Fed by the decimation worker
+
+        // Axis extents as of the last read; untouched motors reuse them
+        bool hasRange = false;
+        double xFirst = 0.0;
+        double xLast = 0.0;
+        double yLow = 0.0;
+        double yHigh = 0.0;
     };
 
+    void updateSeries(PlotSeries& ps, int pixels);
+    const TelemetryReader* reader() const;
+    void finishFrame(const QElapsedTimer& refreshTimer);
+
     QVector<PlotSeries> m_activeSeries;
     int m_colorIndex = 0;
-
-    // Data
+    TelemetryDataStore::SeriesDelta m_delta;   // Reused between reads
+
+    // Decimation state: what the decimated series were last computed from
+    QThreadPool m_decimatePool;
+    bool m_decimating = false;
+    bool m_decimationStale = false;           // Data moved on while the worker ran
+    quint64 m_decimatedRevision = 0;
+    int m_decimatedPixels = 0;
+    quint64 m_seriesVersion = 0;              // Bumped when series are added
+    quint64 m_decimatedSeriesVersion = 0;
+
+    // Data. While paused everything is drawn from the snapshot taken on
+    // pause, so the store can keep capturing and trimming underneath.
     TelemetryDataStore* m_dataStore = nullptr;
+    TelemetryDataStore::SnapshotPtr m_snapshot;
     MotorProfile m_activeProfile;
 
+    // Capture view: an open capture file stays paused on a snapshot of a
+    // store that holds only the range last loaded from the file. The file
+    // is shared with the load in flight; null while no capture is shown.
+    std::shared_ptr<CaptureFile> m_capture;
+    QThreadPool m_capturePool;
+    std::atomic<quint64> m_captureRequest{0};  // Latest load; older ones give up
+    bool m_captureOpening = false;            // A newly opened file is being indexed
+    double m_captureFrom = 0.0;               // Loaded range, seconds from capture start
+    double m_captureTo = 0.0;
+    int m_captureStride = 1;                  // Every n-th matching block was loaded
+    QTimer* m_captureZoomTimer = nullptr;
+
     // Chart components
     QChart* m_chart = nullptr;
     QChartView* m_chartView = nullptr;
     QValueAxis* m_axisX = nullptr;
     QValueAxis* m_axisY = nullptr;
 
+    // Lightweight alternative to the QtCharts view, shown in its place
+    QStackedWidget* m_plotStack = nullptr;
+    StripChartWidget* m_stripChart = nullptr;
+
     // UI components
     QSplitter* m_splitter = nullptr;
     QTreeWidget* m_seriesTree = nullptr;
@@ -79,10 +182,39 @@ private:
     // Toolbar controls
     QToolBar* m_toolbar = nullptr;
     QSpinBox* m_historySpin = nullptr;
+    QTimer* m_historyTimer = nullptr;         // Debounces m_historySpin
     QPushButton* m_pauseButton = nullptr;
     QComboBox* m_yAxisMode = nullptr;
+    QCheckBox* m_openGLCheck = nullptr;
+    QCheckBox* m_frameTimeCheck = nullptr;
+    QCheckBox* m_stripChartCheck = nullptr;
+    QPushButton* m_openCaptureButton = nullptr;
+    QDoubleSpinBox* m_captureFromSpin = nullptr;
+    QDoubleSpinBox* m_captureToSpin = nullptr;
+    QPushButton* m_showRangeButton = nullptr;
+    QPushButton* m_showAllButton = nullptr;
+    QPushButton* m_liveButton = nullptr;
+    QLabel* m_captureLabel = nullptr;
+
+    // OpenGL series; the renderer string is empty when no context could be made
+    bool m_useOpenGL = false;
+    QString m_glRenderer;
+
+    // Frame timing, shown in an overlay on the chart
+    QLabel* m_frameOverlay = nullptr;
+    QTimer* m_overlayTimer = nullptr;
+    QElapsedTimer m_frameClock;
+    int m_frames = 0;
+    double m_paintMsSum = 0.0;
+    double m_paintMsMax = 0.0;
+    double m_refreshMs = 0.0;
 
     bool m_paused = false;
+    bool m_touchAll = true;                   // Next frame reads every series
+    bool m_watchingWindow = false;
+    int m_frameIntervalMs = 16;
+    QElapsedTimer m_sinceFrame;
+    double m_lastPaintMs = 0.0;
     bool m_autoScale = true;
 };
 
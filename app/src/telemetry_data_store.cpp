@@ -1,105 +1,591 @@
 #include "telemetry_data_store.h"
+#include "decode_plan.h"
+
 #include <QMutexLocker>
+#include <QThread>
+#include <QtAlgorithms>
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
 
 TelemetryDataStore::TelemetryDataStore(QObject* parent)
     : QObject(parent)
+    , m_historyTarget(m_contents.historySize)
+{
+    m_resizePool.setMaxThreadCount(1);
+    m_resizePool.setThreadPriority(QThread::LowPriority);
+}
+
+TelemetryDataStore::~TelemetryDataStore()
+{
+    waitForResize();
+}
+
+int TelemetryDataStore::legacyColumn(const QString& fieldId)
+{
+    if (fieldId == QStringLiteral("current")) {
+        return kCurrentColumn;
+    }
+    if (fieldId == QStringLiteral("ecd")) {
+        return kEcdColumn;
+    }
+    if (fieldId == QStringLiteral("speed")) {
+        return kVelocityColumn;
+    }
+    return -1;
+}
+
+QString TelemetryDataStore::legacyFieldId(int column)
 {
+    switch (column) {
+    case kCurrentColumn:
+        return QStringLiteral("current");
+    case kEcdColumn:
+        return QStringLiteral("ecd");
+    case kVelocityColumn:
+        return QStringLiteral("speed");
+    default:
+        return QString();
+    }
 }
 
 void TelemetryDataStore::setHistorySize(int samples)
 {
     QMutexLocker locker(&m_mutex);
-    m_historySize = qBound(50, samples, 2000);
+    m_historyTarget = qBound(kMinHistory, samples, kMaxHistory);
+    if (m_contents.buffers.isEmpty()) {
+        // Nothing to move
+        if (m_historyTarget != m_contents.historySize) {
+            m_contents.historySize = m_historyTarget;
+            ++m_contents.revision;
+        }
+        return;
+    }
+    // A running resize picks up the new target before it finishes
+    if (m_historyTarget != m_contents.historySize && !m_resizing) {
+        m_resizing = true;
+        m_resizePool.start([this]() { runResize(); });
+    }
 }
 
-void TelemetryDataStore::onMotorUpdated(int motorIndex, MotorMeasure measure)
+int TelemetryDataStore::historySize() const
 {
     QMutexLocker locker(&m_mutex);
+    return m_contents.historySize;
+}
 
-    MotorBuffer& buffer = m_buffers[motorIndex];
+void TelemetryDataStore::waitForResize()
+{
+    m_resizePool.waitForDone();
+}
 
-    Sample sample;
-    sample.sampleIndex = buffer.nextSampleIndex++;
-    sample.current = static_cast<double>(measure.current);
-    sample.ecd = static_cast<double>(measure.ecd);
-    sample.velocity = static_cast<double>(measure.speed_rpm);
-    sample.fields = measure.fields;
+void TelemetryDataStore::setActiveProfile(const MotorProfile& profile)
+{
+    QStringList ids = DecodePlan::internFieldIds(profile);
 
-    buffer.samples.append(sample);
+    QMutexLocker locker(&m_mutex);
+    ++m_contents.generation;
+    ++m_contents.revision;
+    m_contents.fieldSlots.clear();
+    for (int i = 0; i < ids.size(); ++i) {
+        m_contents.fieldSlots.insert(ids[i], i);
+    }
 
-    // Trim to history size
-    while (buffer.samples.size() > m_historySize) {
-        buffer.samples.removeFirst();
+    // A profile field already stores the legacy metric of the same ID
+    m_contents.legacyColumns = 0;
+    for (int column = kCurrentColumn; column < kColumnCount; ++column) {
+        if (!m_contents.fieldSlots.contains(legacyFieldId(column))) {
+            m_contents.legacyColumns |= uint64_t(1) << column;
+        }
     }
+}
 
-    m_changedMotors.insert(motorIndex);
+void TelemetryDataStore::resetHistory(MotorHistory& history, int64_t capacity)
+{
+    history.head = 0;
+    history.tail = 0;
+    history.usedColumns = 0;
+    history.time.reset(capacity);
+    for (int c = 0; c < kColumnCount; ++c) {
+        history.columns[c].reset(capacity);
+        history.pyramids[c].reset(capacity);
+        history.stats[c].reset(capacity);
+        history.since[c] = 0;
+    }
+}
+
+void TelemetryDataStore::writeValue(MotorHistory& history, int64_t capacity, int column, int64_t seq, float value)
+{
+    const uint64_t bit = uint64_t(1) << column;
+    const bool restart = !(history.usedColumns & bit);
+    if (restart) {
+        history.usedColumns |= bit;
+        history.since[column] = seq;
+    }
+
+    // The sample this one pushes out of the window is still in the ring
+    RunningStats& stats = history.stats[column];
+    const int64_t leaving = seq - capacity;
+    if (leaving >= history.since[column]) {
+        stats.pop(history.columns[column].read(leaving));
+    }
+    history.columns[column].write(seq, value);
+    history.pyramids[column].append(seq, value, restart);
+    stats.push(value);
+
+    // Once per lap, so the amortised cost stays O(1)
+    if ((seq + 1 - history.since[column]) % capacity == 0) {
+        stats.resum(history.columns[column], std::max(seq + 1 - capacity, history.since[column]), seq + 1);
+    }
+}
 
+void TelemetryDataStore::copySamples(const MotorHistory& source, MotorHistory& target, int64_t capacity,
+                                     int64_t from, int64_t to)
+{
+    for (int64_t seq = from; seq < to; ++seq) {
+        target.time.write(seq, source.time.read(seq));
+    }
+    // Writing value by value also builds the decimation levels and stats
+    for (int c = 0; c < kColumnCount; ++c) {
+        if (!(source.usedColumns & (uint64_t(1) << c))) {
+            continue;
+        }
+        for (int64_t seq = std::max(from, source.since[c]); seq < to; ++seq) {
+            writeValue(target, capacity, c, seq, source.columns[c].read(seq));
+        }
+    }
+    target.head = std::max(target.head, to);
+}
+
+TelemetryDataStore::MotorHistory TelemetryDataStore::resizedHistory(const MotorHistory& history,
+                                                                    int64_t oldCapacity, int64_t capacity)
+{
+    // Rings are indexed modulo their segment count, so copy the kept tail
+    // into fresh rings at the same sequence numbers
+    MotorHistory resized;
+    resetHistory(resized, capacity);
+    resized.head = history.head;
+    resized.tail = std::max(history.first(oldCapacity), resized.first(capacity));
+    copySamples(history, resized, capacity, resized.tail, history.head);
+    return resized;
+}
+
+void TelemetryDataStore::runResize()
+{
+    QMutexLocker locker(&m_mutex);
+    while (m_contents.historySize != m_historyTarget) {
+        const int size = m_historyTarget;
+        const int64_t oldCapacity = m_contents.historySize;
+        const quint64 generation = m_contents.generation;
+
+        // Sharing the raw rings costs O(segments); capture goes on while
+        // the kept samples are copied and the levels rebuilt
+        QHash<int, MotorHistory> resized;
+        for (auto it = m_contents.buffers.cbegin(); it != m_contents.buffers.cend(); ++it) {
+            MotorHistory raw;
+            raw.head = it.value().head;
+            raw.tail = it.value().tail;
+            raw.usedColumns = it.value().usedColumns;
+            raw.time = it.value().time;
+            for (int c = 0; c < kColumnCount; ++c) {
+                raw.columns[c] = it.value().columns[c];
+                raw.since[c] = it.value().since[c];
+            }
+            resized.insert(it.key(), std::move(raw));
+        }
+        locker.unlock();
+
+        for (MotorHistory& history : resized) {
+            history = resizedHistory(history, oldCapacity, size);
+        }
+
+        locker.relock();
+        if (size != m_historyTarget || generation != m_contents.generation) {
+            continue;  // Superseded or cleared meanwhile: start over
+        }
+        // Append what arrived meanwhile, unless it already pushed samples
+        // the copy still needs out of the old window
+        bool current = true;
+        for (auto it = m_contents.buffers.cbegin(); it != m_contents.buffers.cend(); ++it) {
+            auto found = resized.constFind(it.key());
+            current = current && (found == resized.cend() || found.value().head >= it.value().first(oldCapacity));
+        }
+        if (!current) {
+            continue;
+        }
+        for (auto it = m_contents.buffers.begin(); it != m_contents.buffers.end(); ++it) {
+            auto found = resized.find(it.key());
+            if (found == resized.end()) {
+                // First seen meanwhile, so holds only a few samples
+                it.value() = resizedHistory(it.value(), oldCapacity, size);
+            } else {
+                copySamples(it.value(), found.value(), size, found.value().head, it.value().head);
+                it.value() = std::move(found.value());
+            }
+        }
+        m_contents.historySize = size;
+        ++m_contents.revision;
+    }
+    m_resizing = false;
     locker.unlock();
-    emit dataUpdated(motorIndex);
+    emit historyResized();
 }
 
-QVector<QPointF> TelemetryDataStore::getSeries(int motorIndex, Metric metric) const
+void TelemetryDataStore::onMotorsUpdated(const MotorSampleBatch& batch)
 {
+    if (batch.isEmpty()) {
+        return;
+    }
+
+    QSet<int> touched;
+
     QMutexLocker locker(&m_mutex);
+    ++m_contents.revision;
 
-    QVector<QPointF> points;
-    auto it = m_buffers.constFind(motorIndex);
-    if (it == m_buffers.constEnd()) {
-        return points;
+    if (!m_hasTimeOrigin) {
+        m_timeOriginNs = batch.first().timestampNs;
+        m_hasTimeOrigin = true;
     }
 
-    const MotorBuffer& buffer = it.value();
-    points.reserve(buffer.samples.size());
+    constexpr uint64_t kSlotColumns = (uint64_t(1) << kMaxMeasureFields) - 1;
+
+    for (const MotorSample& motorSample : batch) {
+        auto it = m_contents.buffers.find(motorSample.motorIndex);
+        if (it == m_contents.buffers.end()) {
+            it = m_contents.buffers.insert(motorSample.motorIndex, MotorHistory());
+            resetHistory(it.value(), m_contents.historySize);
+        }
+        MotorHistory& history = it.value();
+        const MotorMeasure& measure = motorSample.measure;
+        const int64_t seq = history.head;
+
+        history.time.write(seq, static_cast<double>(motorSample.timestampNs - m_timeOriginNs) * 1e-9);
+
+        // Every column seen so far gets a value (0 when absent) so rows stay aligned
+        const uint64_t legacy = history.usedColumns | m_contents.legacyColumns;
+        if (legacy & (uint64_t(1) << kCurrentColumn)) {
+            writeValue(history, m_contents.historySize, kCurrentColumn, seq, static_cast<float>(measure.current));
+        }
+        if (legacy & (uint64_t(1) << kEcdColumn)) {
+            writeValue(history, m_contents.historySize, kEcdColumn, seq, static_cast<float>(measure.ecd));
+        }
+        if (legacy & (uint64_t(1) << kVelocityColumn)) {
+            writeValue(history, m_contents.historySize, kVelocityColumn, seq, static_cast<float>(measure.speed_rpm));
+        }
+
+        uint64_t fields = (history.usedColumns | measure.validMask) & kSlotColumns;
+        while (fields) {
+            const int slot = static_cast<int>(qCountTrailingZeroBits(static_cast<quint64>(fields)));
+            fields &= fields - 1;
+            const float value = (measure.validMask & (1U << slot)) ? static_cast<float>(measure.values[slot]) : 0.0f;
+            writeValue(history, m_contents.historySize, slot, seq, value);
+        }
+
+        ++history.head;
+        touched.insert(motorSample.motorIndex);
+    }
+
+    m_changedMotors.unite(touched);
+
+    locker.unlock();
+    for (int motorIndex : touched) {
+        emit dataUpdated(motorIndex);
+    }
+}
+
+int TelemetryDataStore::columnFor(const Contents& contents, const QString& fieldId)
+{
+    // The legacy metrics are only stored apart for profiles without the field
+    const int slot = contents.fieldSlots.value(fieldId, -1);
+    return slot >= 0 ? slot : legacyColumn(fieldId);
+}
+
+void TelemetryDataStore::appendPoints(const MotorHistory& history, int column,
+                                      int64_t from, int64_t to, QVector<QPointF>& points)
+{
+    const bool hasColumn = column >= 0 && (history.usedColumns & (uint64_t(1) << column));
+    points.reserve(points.size() + static_cast<int>(to - from));
 
-    for (const Sample& s : buffer.samples) {
-        double y = 0.0;
-        switch (metric) {
-        case Metric::Current:
-            y = s.current;
-            break;
-        case Metric::ECD:
-            y = s.ecd;
-            break;
-        case Metric::Velocity:
-            y = s.velocity;
-            break;
+    // Walk both columns a segment at a time
+    int64_t seq = from;
+    while (seq < to) {
+        int64_t count = 0;
+        const double* times = history.time.span(seq, to - seq, count);
+        const float* values = nullptr;
+        if (hasColumn) {
+            int64_t valueCount = 0;
+            values = history.columns[column].span(seq, count, valueCount);
+        }
+        for (int64_t i = 0; i < count; ++i) {
+            points.append(QPointF(times ? times[i] : 0.0, values ? static_cast<double>(values[i]) : 0.0));
         }
-        points.append(QPointF(static_cast<double>(s.sampleIndex), y));
+        seq += count;
     }
+}
 
+QVector<QPointF> TelemetryDataStore::getSeries(const Contents& contents, int motorIndex, int column)
+{
+    QVector<QPointF> points;
+    auto it = contents.buffers.constFind(motorIndex);
+    if (it != contents.buffers.constEnd()) {
+        appendPoints(it.value(), column, it.value().first(contents.historySize), it.value().head, points);
+    }
     return points;
 }
 
+QVector<QPointF> TelemetryDataStore::getSeries(int motorIndex, Metric metric) const
+{
+    int column = kCurrentColumn;
+    switch (metric) {
+    case Metric::Current:
+        column = kCurrentColumn;
+        break;
+    case Metric::ECD:
+        column = kEcdColumn;
+        break;
+    case Metric::Velocity:
+        column = kVelocityColumn;
+        break;
+    }
+
+    QMutexLocker locker(&m_mutex);
+    return getSeries(m_contents, motorIndex, columnFor(m_contents, legacyFieldId(column)));
+}
+
 QVector<QPointF> TelemetryDataStore::getSeries(int motorIndex, const QString& fieldId) const
 {
     QMutexLocker locker(&m_mutex);
+    return getSeries(m_contents, motorIndex, columnFor(m_contents, fieldId));
+}
 
-    QVector<QPointF> points;
-    auto it = m_buffers.constFind(motorIndex);
-    if (it == m_buffers.constEnd()) {
-        return points;
-    }
-
-    const MotorBuffer& buffer = it.value();
-    points.reserve(buffer.samples.size());
-
-    for (const Sample& s : buffer.samples) {
-        double y = 0.0;
-        // Check legacy fields first
-        if (fieldId == QStringLiteral("current")) {
-            y = s.current;
-        } else if (fieldId == QStringLiteral("ecd")) {
-            y = s.ecd;
-        } else if (fieldId == QStringLiteral("speed")) {
-            y = s.velocity;
+bool TelemetryDataStore::readSince(int motorIndex, const QString& fieldId,
+                                   SeriesCursor& cursor, SeriesDelta& delta) const
+{
+    QMutexLocker locker(&m_mutex);
+    return readSince(m_contents, motorIndex, fieldId, cursor, delta);
+}
+
+bool TelemetryDataStore::readSince(const Contents& contents, int motorIndex, const QString& fieldId,
+                                   SeriesCursor& cursor, SeriesDelta& delta)
+{
+    delta.reset = false;
+    delta.dropped = 0;
+    delta.points.clear();
+
+    auto it = contents.buffers.constFind(motorIndex);
+    if (it == contents.buffers.constEnd()) {
+        // Nothing stored (yet, or any more since clear())
+        const bool stale = cursor.generation != contents.generation || cursor.next != 0;
+        cursor = SeriesCursor{contents.generation, 0, 0};
+        delta.reset = stale;
+        return stale;
+    }
+
+    const MotorHistory& history = it.value();
+    const int64_t first = history.first(contents.historySize);
+
+    int64_t from = cursor.next;
+    if (cursor.generation != contents.generation || cursor.next < first || cursor.next > history.head) {
+        // Reader fell out of the window or the store was reset: resend everything
+        delta.reset = true;
+        from = first;
+    } else if (first > cursor.first) {
+        delta.dropped = static_cast<int>(first - cursor.first);
+    }
+
+    appendPoints(history, columnFor(contents, fieldId), from, history.head, delta.points);
+    cursor = SeriesCursor{contents.generation, first, history.head};
+
+    return delta.reset || delta.dropped > 0 || !delta.points.isEmpty();
+}
+
+int64_t TelemetryDataStore::lowerBound(const MotorHistory& history, int64_t from, int64_t to, double time)
+{
+    // Sample times are non-decreasing per motor
+    while (from < to) {
+        const int64_t mid = from + (to - from) / 2;
+        if (history.time.read(mid) < time) {
+            from = mid + 1;
         } else {
-            // Fall back to dynamic fields
-            y = s.fields.value(fieldId, 0.0);
+            to = mid;
         }
-        points.append(QPointF(static_cast<double>(s.sampleIndex), y));
     }
+    return from;
+}
 
-    return points;
+const TelemetryDataStore::MotorHistory* TelemetryDataStore::findColumn(const Contents& contents, int motorIndex,
+                                                                        const QString& fieldId, int& column)
+{
+    auto it = contents.buffers.constFind(motorIndex);
+    column = columnFor(contents, fieldId);
+    if (it == contents.buffers.constEnd() || column < 0 || !(it.value().usedColumns & (uint64_t(1) << column))) {
+        return nullptr;
+    }
+    return &it.value();
+}
+
+void TelemetryDataStore::timeRange(const Contents& contents, const MotorHistory& history, int column,
+                                   double t0, double t1, int64_t& begin, int64_t& end)
+{
+    const int64_t first = std::max(history.first(contents.historySize), history.since[column]);
+    begin = lowerBound(history, first, history.head, t0);
+    end = lowerBound(history, begin, history.head,
+                     std::nextafter(t1, std::numeric_limits<double>::infinity()));
+}
+
+void TelemetryDataStore::readM4(int motorIndex, const QString& fieldId, double t0, double t1,
+                                int pixels, QVector<QPointF>& out) const
+{
+    QMutexLocker locker(&m_mutex);
+    readM4(m_contents, motorIndex, fieldId, t0, t1, pixels, out);
+}
+
+void TelemetryDataStore::readM4(const Contents& contents, int motorIndex, const QString& fieldId,
+                                double t0, double t1, int pixels, QVector<QPointF>& out)
+{
+    out.clear();
+    pixels = std::max(pixels, 1);
+
+    int column = 0;
+    const MotorHistory* found = findColumn(contents, motorIndex, fieldId, column);
+    if (!found) {
+        return;
+    }
+
+    const MotorHistory& history = *found;
+    const ColumnRing<float>& values = history.columns[column];
+    int64_t begin = 0;
+    int64_t end = 0;
+    timeRange(contents, history, column, t0, t1, begin, end);
+    if (end <= begin) {
+        return;
+    }
+
+    // Pixel columns split the time actually covered, not the requested range
+    const double start = history.time.read(begin);
+    const double step = (history.time.read(end - 1) - start) / pixels;
+    out.reserve(std::min<int64_t>(end - begin, int64_t(pixels) * 4));
+
+    int64_t from = begin;
+    for (int p = 0; p < pixels && from < end; ++p) {
+        const int64_t to = (p == pixels - 1 || step <= 0.0)
+                               ? end
+                               : lowerBound(history, from, end, start + step * (p + 1));
+        if (to == from) {
+            continue;
+        }
+
+        out.append(QPointF(history.time.read(from), values.read(from)));
+        if (to - from > 2) {
+            float min = 0.0f;
+            float max = 0.0f;
+            history.pyramids[column].minMax(values, from, to, min, max);
+            const double mid = history.time.read(from + (to - from) / 2);
+            out.append(QPointF(mid, min));
+            out.append(QPointF(mid, max));
+        }
+        if (to - from > 1) {
+            out.append(QPointF(history.time.read(to - 1), values.read(to - 1)));
+        }
+        from = to;
+    }
+}
+
+bool TelemetryDataStore::fieldStats(int motorIndex, const QString& fieldId, FieldStats& stats) const
+{
+    QMutexLocker locker(&m_mutex);
+    return fieldStats(m_contents, motorIndex, fieldId, stats);
+}
+
+bool TelemetryDataStore::fieldStats(const Contents& contents, int motorIndex, const QString& fieldId,
+                                    FieldStats& stats)
+{
+    stats = FieldStats();
+
+    int column = 0;
+    const MotorHistory* history = findColumn(contents, motorIndex, fieldId, column);
+    if (!history) {
+        return false;
+    }
+
+    const RunningStats& running = history->stats[column];
+    stats.count = running.count();
+    stats.min = running.min();
+    stats.max = running.max();
+    stats.mean = running.mean();
+    stats.rms = running.rms();
+    stats.variance = running.variance();
+    return stats.count > 0;
+}
+
+int TelemetryDataStore::sampleCount(int motorIndex) const
+{
+    QMutexLocker locker(&m_mutex);
+    return sampleCount(m_contents, motorIndex);
+}
+
+int TelemetryDataStore::sampleCount(const Contents& contents, int motorIndex)
+{
+    auto it = contents.buffers.constFind(motorIndex);
+    if (it == contents.buffers.constEnd()) {
+        return 0;
+    }
+    return static_cast<int>(it.value().head - it.value().first(contents.historySize));
+}
+
+int TelemetryDataStore::readRows(int motorIndex, const QStringList& fieldIds, int first, int count,
+                                 QVector<double>& times, QVector<float>& values) const
+{
+    QMutexLocker locker(&m_mutex);
+    return readRows(m_contents, motorIndex, fieldIds, first, count, times, values);
+}
+
+int TelemetryDataStore::readRows(const Contents& contents, int motorIndex, const QStringList& fieldIds,
+                                 int first, int count, QVector<double>& times, QVector<float>& values)
+{
+    times.clear();
+    values.clear();
+    auto it = contents.buffers.constFind(motorIndex);
+    if (it == contents.buffers.constEnd() || first < 0) {
+        return 0;
+    }
+    const MotorHistory& history = it.value();
+    const int64_t begin = history.first(contents.historySize) + first;
+    const int rows = static_cast<int>(std::clamp<int64_t>(history.head - begin, 0, count));
+    const int fields = static_cast<int>(fieldIds.size());
+
+    times.resize(rows);
+    for (int row = 0; row < rows; ++row) {
+        times[row] = history.time.read(begin + row);
+    }
+
+    // Filled column by column; a column starts at the first sample that had it
+    values.fill(std::numeric_limits<float>::quiet_NaN(), static_cast<qsizetype>(rows) * fields);
+    for (int field = 0; field < fields; ++field) {
+        const int column = columnFor(contents, fieldIds[field]);
+        if (column < 0 || !(history.usedColumns & (uint64_t(1) << column))) {
+            continue;
+        }
+        for (int64_t seq = std::max(begin, history.since[column]); seq < begin + rows; ++seq) {
+            values[static_cast<qsizetype>(seq - begin) * fields + field] = history.columns[column].read(seq);
+        }
+    }
+    return rows;
+}
+
+quint64 TelemetryDataStore::revision() const
+{
+    QMutexLocker locker(&m_mutex);
+    return m_contents.revision;
+}
+
+TelemetryDataStore::SnapshotPtr TelemetryDataStore::snapshot() const
+{
+    // Copying the contents only bumps reference counts: the hash is
+    // implicitly shared and the rings share their segments
+    QMutexLocker locker(&m_mutex);
+    return SnapshotPtr(new Snapshot(m_contents));
 }
 
 QSet<int> TelemetryDataStore::consumeChangedMotors()
@@ -113,6 +599,90 @@ QSet<int> TelemetryDataStore::consumeChangedMotors()
 void TelemetryDataStore::clear()
 {
     QMutexLocker locker(&m_mutex);
-    m_buffers.clear();
+    m_contents.buffers.clear();
     m_changedMotors.clear();
+    m_hasTimeOrigin = false;
+    ++m_contents.generation;
+    ++m_contents.revision;
+}
+
+void TelemetryDataStore::setTimeOrigin(qint64 hostTimeNs)
+{
+    QMutexLocker locker(&m_mutex);
+    m_timeOriginNs = hostTimeNs;
+    m_hasTimeOrigin = true;
+}
+
+QVector<QPointF> TelemetryDataStore::Snapshot::getSeries(int motorIndex, const QString& fieldId) const
+{
+    return TelemetryDataStore::getSeries(m_contents, motorIndex, columnFor(m_contents, fieldId));
+}
+
+bool TelemetryDataStore::Snapshot::readSince(int motorIndex, const QString& fieldId,
+                                             SeriesCursor& cursor, SeriesDelta& delta) const
+{
+    return TelemetryDataStore::readSince(m_contents, motorIndex, fieldId, cursor, delta);
+}
+
+void TelemetryDataStore::Snapshot::readM4(int motorIndex, const QString& fieldId, double t0, double t1,
+                                          int pixels, QVector<QPointF>& out) const
+{
+    TelemetryDataStore::readM4(m_contents, motorIndex, fieldId, t0, t1, pixels, out);
+}
+
+bool TelemetryDataStore::Snapshot::fieldStats(int motorIndex, const QString& fieldId, FieldStats& stats) const
+{
+    return TelemetryDataStore::fieldStats(m_contents, motorIndex, fieldId, stats);
+}
+
+int TelemetryDataStore::Snapshot::sampleCount(int motorIndex) const
+{
+    return TelemetryDataStore::sampleCount(m_contents, motorIndex);
+}
+
+int TelemetryDataStore::Snapshot::readRows(int motorIndex, const QStringList& fieldIds, int first, int count,
+                                           QVector<double>& times, QVector<float>& values) const
+{
+    return TelemetryDataStore::readRows(m_contents, motorIndex, fieldIds, first, count, times, values);
+}
+
+QList<int> TelemetryDataStore::Snapshot::motors() const
+{
+    QList<int> motors;
+    for (auto it = m_contents.buffers.constBegin(); it != m_contents.buffers.constEnd(); ++it) {
+        if (TelemetryDataStore::sampleCount(m_contents, it.key()) > 0) {
+            motors.append(it.key());
+        }
+    }
+    std::sort(motors.begin(), motors.end());
+    return motors;
+}
+
+QStringList TelemetryDataStore::Snapshot::fieldIds(int motorIndex) const
+{
+    auto it = m_contents.buffers.constFind(motorIndex);
+    if (it == m_contents.buffers.constEnd()) {
+        return {};
+    }
+    const uint64_t used = it.value().usedColumns;
+
+    QStringList bySlot(kMaxMeasureFields);
+    for (auto slot = m_contents.fieldSlots.constBegin(); slot != m_contents.fieldSlots.constEnd(); ++slot) {
+        if (slot.value() >= 0 && slot.value() < kMaxMeasureFields && (used & (uint64_t(1) << slot.value()))) {
+            bySlot[slot.value()] = slot.key();
+        }
+    }
+    QStringList ids;
+    for (const QString& id : bySlot) {
+        if (!id.isEmpty()) {
+            ids.append(id);
+        }
+    }
+    for (int column = kCurrentColumn; column < kColumnCount; ++column) {
+        const QString id = legacyFieldId(column);
+        if ((used & (uint64_t(1) << column)) && !m_contents.fieldSlots.contains(id)) {
+            ids.append(id);
+        }
+    }
+    return ids;
 }
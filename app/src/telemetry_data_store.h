@@ -7,10 +7,80 @@
 #include <QVector>
 #include <QPointF>
 #include <QSet>
+#include <QStringList>
+#include <QThreadPool>
 
+#include <memory>
+
+#include "column_ring.h"
+#include "minmax_pyramid.h"
+#include "running_stats.h"
 #include "motor_profile.h"
 
-class TelemetryDataStore : public QObject
+// Read side of the telemetry history, shared by the live store and its
+// frozen snapshots so views can draw from either
+class TelemetryReader
+{
+public:
+    // Read position of one incremental reader of one series
+    struct SeriesCursor {
+        quint64 generation = 0;  // Store generation the cursor was filled from
+        int64_t first = 0;       // Oldest sequence the reader holds
+        int64_t next = 0;        // Next sequence to read
+    };
+
+    // What changed since the cursor's last read
+    struct SeriesDelta {
+        bool reset = false;      // Cursor was stale: points is the whole window, replace
+        int dropped = 0;         // Points that left the window; trim from the front
+        QVector<QPointF> points; // New points, oldest first
+    };
+
+    // Statistics of one series over the samples currently held
+    struct FieldStats {
+        int64_t count = 0;
+        double min = 0.0;
+        double max = 0.0;
+        double mean = 0.0;
+        double rms = 0.0;
+        double variance = 0.0;
+    };
+
+    virtual ~TelemetryReader() = default;
+
+    // X is time in seconds since the first sample after clear()
+    virtual QVector<QPointF> getSeries(int motorIndex, const QString& fieldId) const = 0;
+
+    // Incremental read: only samples appended since cursor was last used.
+    // Returns false when nothing changed.
+    virtual bool readSince(int motorIndex, const QString& fieldId,
+                           SeriesCursor& cursor, SeriesDelta& delta) const = 0;
+
+    // M4 decimation of the samples between t0 and t1 (seconds) for a plot
+    // `pixels` columns wide: each column keeps its first, min, max and last
+    // sample, which draws the same line as the raw data. Min/max come from
+    // the decimation levels, so the cost follows pixels, not samples.
+    virtual void readM4(int motorIndex, const QString& fieldId, double t0, double t1,
+                        int pixels, QVector<QPointF>& out) const = 0;
+
+    // Window statistics, maintained as samples are appended, so this is O(1).
+    // Returns false when the motor or field has no samples.
+    virtual bool fieldStats(int motorIndex, const QString& fieldId, FieldStats& stats) const = 0;
+
+    // Samples currently held for a motor
+    virtual int sampleCount(int motorIndex) const = 0;
+
+    // Up to count held samples of a motor from row first on (row 0 is the
+    // oldest): their times, and row by row one value per field, NaN where
+    // the field was not decoded. Returns the rows read.
+    virtual int readRows(int motorIndex, const QStringList& fieldIds, int first, int count,
+                         QVector<double>& times, QVector<float>& values) const = 0;
+
+    // Changes whenever any held sample, column or time range changes
+    virtual quint64 revision() const = 0;
+};
+
+class TelemetryDataStore : public QObject, public TelemetryReader
 {
     Q_OBJECT
 public:
@@ -21,15 +91,52 @@ public:
     };
     Q_ENUM(Metric)
 
+    // Immutable view of the store at the moment snapshot() was called. It
+    // shares the ring segments with the store instead of copying them; the
+    // store copies a segment before its next write to it, so capture keeps
+    // running and the snapshot keeps the samples it was taken with.
+    class Snapshot;
+    using SnapshotPtr = std::shared_ptr<const Snapshot>;
+
     explicit TelemetryDataStore(QObject* parent = nullptr);
+    ~TelemetryDataStore() override;
 
-    // Configuration
+    // A sample costs 8 bytes of time plus about 16 per stored field: the
+    // value, its share of the decimation levels (24-byte buckets, one per
+    // 8 samples at the first level) and the window min/max queues. With the
+    // five default fields that is some 90 bytes, so the cap comes to about
+    // 180 MB per motor.
+    static constexpr int kMinHistory = 50;
+    static constexpr int kMaxHistory = 2000000;
+
+    // Configuration. Samples kept per motor; resizing keeps the newest.
+    // With samples held, the kept ones are copied and their decimation
+    // levels rebuilt on a worker while capture goes on; reads use the old
+    // size until historyResized(). historySize() is the size in effect.
     void setHistorySize(int samples);
-    int historySize() const { return m_historySize; }
+    int historySize() const;
+
+    // Block until a resize started by setHistorySize() is in effect
+    void waitForResize();
 
-    // Data access
+    // Resolve field IDs to the slots used by the decode plan
+    void setActiveProfile(const MotorProfile& profile);
+
+    // Data access, see TelemetryReader. Safe to call from any thread.
     QVector<QPointF> getSeries(int motorIndex, Metric metric) const;
-    QVector<QPointF> getSeries(int motorIndex, const QString& fieldId) const;
+    QVector<QPointF> getSeries(int motorIndex, const QString& fieldId) const override;
+    bool readSince(int motorIndex, const QString& fieldId,
+                   SeriesCursor& cursor, SeriesDelta& delta) const override;
+    void readM4(int motorIndex, const QString& fieldId, double t0, double t1,
+                int pixels, QVector<QPointF>& out) const override;
+    bool fieldStats(int motorIndex, const QString& fieldId, FieldStats& stats) const override;
+    int sampleCount(int motorIndex) const override;
+    int readRows(int motorIndex, const QStringList& fieldIds, int first, int count,
+                 QVector<double>& times, QVector<float>& values) const override;
+    quint64 revision() const override;
+
+    // Freeze the current history. O(motors x segments), no sample is copied.
+    SnapshotPtr snapshot() const;
 
     // Get motors that have been updated since last call
     QSet<int> consumeChangedMotors();
@@ -37,30 +144,128 @@ public:
     // Clear all data
     void clear();
 
+    // Map this host time to t = 0 instead of the first sample's, until the
+    // next clear()
+    void setTimeOrigin(qint64 hostTimeNs);
+
 public slots:
-    void onMotorUpdated(int motorIndex, MotorMeasure measure);
+    // Append a whole batch under a single lock acquisition
+    void onMotorsUpdated(const MotorSampleBatch& batch);
 
 signals:
     void dataUpdated(int motorIndex);
 
+    // A resize is in effect; emitted from the worker thread
+    void historyResized();
+
 private:
-    struct Sample {
-        qint64 sampleIndex;
-        double current;
-        double ecd;
-        double velocity;
-        QHash<QString, double> fields;
+    // Column layout: decode-plan field slots first, then the legacy metrics.
+    // A legacy column is only written while the profile has no field of
+    // its ID; otherwise the ID reads the field's slot.
+    enum Column {
+        kCurrentColumn = kMaxMeasureFields,
+        kEcdColumn,
+        kVelocityColumn,
+        kColumnCount
     };
 
-    struct MotorBuffer {
-        QVector<Sample> samples;
-        qint64 nextSampleIndex = 0;
+    // Per-motor history as parallel column rings sharing one sequence.
+    // Field columns are only written once the field has been seen.
+    struct MotorHistory {
+        int64_t head = 0;                         // Samples ever appended
+        int64_t tail = 0;                         // Oldest sequence still held
+        uint64_t usedColumns = 0;                 // Bit per written column
+        ColumnRing<double> time;                  // Seconds since the time origin
+        ColumnRing<float> columns[kColumnCount];
+        MinMaxPyramid pyramids[kColumnCount];     // Decimation levels per column
+        RunningStats stats[kColumnCount];         // Over the live window per column
+        int64_t since[kColumnCount] = {};         // First sequence written per column
+
+        int64_t first(int64_t capacity) const { return std::max(tail, head - capacity); }
     };
 
+    // Everything a read depends on; a snapshot holds its own copy
+    struct Contents {
+        QHash<int, MotorHistory> buffers;
+        QHash<QString, int> fieldSlots;
+        uint64_t legacyColumns = (uint64_t(1) << kCurrentColumn) | (uint64_t(1) << kEcdColumn)
+                                 | (uint64_t(1) << kVelocityColumn);   // Bit per legacy column to write
+        int historySize = 200;
+        quint64 generation = 1;  // Bumped when sequences or columns are invalidated
+        quint64 revision = 0;    // Bumped on every change, see revision()
+    };
+
+    static void resetHistory(MotorHistory& history, int64_t capacity);
+    static void writeValue(MotorHistory& history, int64_t capacity, int column, int64_t seq, float value);
+    static void copySamples(const MotorHistory& source, MotorHistory& target, int64_t capacity,
+                            int64_t from, int64_t to);
+    static MotorHistory resizedHistory(const MotorHistory& history, int64_t oldCapacity, int64_t capacity);
+    void runResize();
+    static int64_t lowerBound(const MotorHistory& history, int64_t from, int64_t to, double time);
+    static const MotorHistory* findColumn(const Contents& contents, int motorIndex,
+                                          const QString& fieldId, int& column);
+    static void timeRange(const Contents& contents, const MotorHistory& history, int column,
+                          double t0, double t1, int64_t& begin, int64_t& end);
+    static int columnFor(const Contents& contents, const QString& fieldId);
+    static int legacyColumn(const QString& fieldId);
+    static QString legacyFieldId(int column);
+    static void appendPoints(const MotorHistory& history, int column,
+                             int64_t from, int64_t to, QVector<QPointF>& points);
+
+    // Reads shared by the store (under its mutex) and snapshots
+    static QVector<QPointF> getSeries(const Contents& contents, int motorIndex, int column);
+    static bool readSince(const Contents& contents, int motorIndex, const QString& fieldId,
+                          SeriesCursor& cursor, SeriesDelta& delta);
+    static void readM4(const Contents& contents, int motorIndex, const QString& fieldId,
+                       double t0, double t1, int pixels, QVector<QPointF>& out);
+    static bool fieldStats(const Contents& contents, int motorIndex, const QString& fieldId,
+                           FieldStats& stats);
+    static int sampleCount(const Contents& contents, int motorIndex);
+    static int readRows(const Contents& contents, int motorIndex, const QStringList& fieldIds,
+                        int first, int count, QVector<double>& times, QVector<float>& values);
+
     mutable QMutex m_mutex;
-    QHash<int, MotorBuffer> m_buffers;
+    Contents m_contents;
     QSet<int> m_changedMotors;
-    int m_historySize = 200;
+
+    // Host monotonic ns mapped to t = 0; set by setTimeOrigin() or the first
+    // sample after clear()
+    qint64 m_timeOriginNs = 0;
+    bool m_hasTimeOrigin = false;
+
+    int m_historyTarget = 0;     // Size asked for; differs from historySize while resizing
+    bool m_resizing = false;     // runResize() queued or running
+    QThreadPool m_resizePool;    // Last, so it is drained before the rest goes
+};
+
+class TelemetryDataStore::Snapshot : public TelemetryReader
+{
+public:
+    QVector<QPointF> getSeries(int motorIndex, const QString& fieldId) const override;
+    bool readSince(int motorIndex, const QString& fieldId,
+                   SeriesCursor& cursor, SeriesDelta& delta) const override;
+    void readM4(int motorIndex, const QString& fieldId, double t0, double t1,
+                int pixels, QVector<QPointF>& out) const override;
+    bool fieldStats(int motorIndex, const QString& fieldId, FieldStats& stats) const override;
+    int sampleCount(int motorIndex) const override;
+    int readRows(int motorIndex, const QStringList& fieldIds, int first, int count,
+                 QVector<double>& times, QVector<float>& values) const override;
+    quint64 revision() const override { return m_contents.revision; }
+
+    int historySize() const { return m_contents.historySize; }
+
+    // Motors with held samples, ascending
+    QList<int> motors() const;
+
+    // Fields held for a motor: decode-plan fields in slot order, then those
+    // of the legacy current, ecd and speed the profile has no field for
+    QStringList fieldIds(int motorIndex) const;
+
+private:
+    friend class TelemetryDataStore;
+    explicit Snapshot(const Contents& contents) : m_contents(contents) {}
+
+    const Contents m_contents;
 };
 
 #endif // TELEMETRY_DATA_STORE_H
@@ -57,10 +57,17 @@ TelemetryPlotPanel::TelemetryPlotPanel(QWidget* parent)
 
     layout->addWidget(m_chartView, 1);
 
+    // Armed by samples of the selected motor only, so an idle panel costs nothing
     m_refreshTimer = new QTimer(this);
     m_refreshTimer->setInterval(100);
+    m_refreshTimer->setSingleShot(true);
     connect(m_refreshTimer, &QTimer::timeout, this, &TelemetryPlotPanel::refreshChart);
-    m_refreshTimer->start();
+}
+
+void TelemetryPlotPanel::showEvent(QShowEvent* event)
+{
+    QWidget::showEvent(event);
+    refreshChart();
 }
 
 void TelemetryPlotPanel::setProfiles(const QVector<MotorProfile>& profiles)
@@ -137,6 +144,10 @@ void TelemetryPlotPanel::onMotorUpdated(int motorId, const MotorMeasure& measure
         return;
     }
     appendSample(motorId, getMetricValue(measure));
+    if (motorId == m_selectedMotorIndex + 1 && isVisible() && !window()->isMinimized()
+        && !m_refreshTimer->isActive()) {
+        m_refreshTimer->start();
+    }
 }
 
 void TelemetryPlotPanel::refreshChart()
@@ -32,6 +32,9 @@ public:
 public slots:
     void onMotorUpdated(int motorId, const MotorMeasure& measure);
 
+protected:
+    void showEvent(QShowEvent* event) override;
+
 private slots:
     void refreshChart();
     void onMetricChanged(int index);
@@ -0,0 +1,455 @@
+#include "tx_scheduler.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+
+#if defined(_WIN32)
+#include <windows.h>
+#elif defined(__linux__)
+#include <cerrno>
+#include <pthread.h>
+#include <sched.h>
+#include <sys/prctl.h>
+#include <time.h>
+#endif
+
+namespace {
+// Upper bound on a single sleep so enable/rate changes are picked up promptly
+constexpr int64_t kMaxSleepNs = 5000000;
+
+// Echo poll interval while the offload check waits for its window's echoes
+constexpr int64_t kCheckPollNs = 1000000;
+
+// Offload check: echoes may trail the window by this much, the window needs
+// this many frames to measure, and the measured spacing may be this far off.
+constexpr int64_t kCheckSlackNs = 20000000;
+constexpr int kMinCheckFrames = 8;
+constexpr double kCheckTolerance = 0.05;
+
+#if !defined(__linux__)
+// Coarse OS sleeps stop this far ahead of the deadline and spin the rest
+constexpr int64_t kSpinWindowNs = 1500000;
+#endif
+
+int64_t steadyNowNs()
+{
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+void sleepUntilNs(int64_t deadlineNs)
+{
+#if defined(__linux__)
+    // steady_clock is CLOCK_MONOTONIC on Linux
+    timespec ts;
+    ts.tv_sec = static_cast<time_t>(deadlineNs / 1000000000);
+    ts.tv_nsec = static_cast<long>(deadlineNs % 1000000000);
+    while (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &ts, nullptr) == EINTR) {
+    }
+#else
+    const int64_t coarse = deadlineNs - kSpinWindowNs;
+    if (steadyNowNs() < coarse) {
+        std::this_thread::sleep_until(std::chrono::steady_clock::time_point(
+            std::chrono::nanoseconds(coarse)));
+    }
+    while (steadyNowNs() < deadlineNs) {
+        std::this_thread::yield();
+    }
+#endif
+}
+}
+
+TxScheduler::TxScheduler(SendFunction send)
+    : m_send(std::move(send))
+{
+}
+
+TxScheduler::~TxScheduler()
+{
+    stop();
+}
+
+void TxScheduler::setRealtime(bool enabled, int priority)
+{
+    m_realtime = enabled;
+    m_priority = priority;
+}
+
+void TxScheduler::setCpuAffinity(int cpu)
+{
+    m_cpu = cpu;
+}
+
+void TxScheduler::start()
+{
+    if (m_running.exchange(true)) {
+        return;
+    }
+    // The adapter may have changed since the last check
+    m_offloadCheck.store(OffloadCheck::Pending, std::memory_order_relaxed);
+    m_checkGroup.store(-1, std::memory_order_relaxed);
+    m_thread = std::thread(&TxScheduler::run, this);
+}
+
+void TxScheduler::stop()
+{
+    if (!m_running.exchange(false)) {
+        return;
+    }
+    if (m_thread.joinable()) {
+        m_thread.join();
+    }
+    m_realtimeActive.store(false, std::memory_order_relaxed);
+}
+
+void TxScheduler::setGroupEnabled(int group, bool enabled)
+{
+    if (group < 0 || group >= kMaxGroups) {
+        return;
+    }
+    m_groups[group].enabled.store(enabled, std::memory_order_release);
+}
+
+void TxScheduler::setGroupRate(int group, int hz)
+{
+    if (group < 0 || group >= kMaxGroups) {
+        return;
+    }
+    m_groups[group].rateHz.store(std::clamp(hz, 1, kMaxRateHz), std::memory_order_release);
+}
+
+int TxScheduler::groupRate(int group) const
+{
+    if (group < 0 || group >= kMaxGroups) {
+        return 0;
+    }
+    return m_groups[group].rateHz.load(std::memory_order_relaxed);
+}
+
+void TxScheduler::setGroupMode(int group, Mode mode)
+{
+    if (group < 0 || group >= kMaxGroups) {
+        return;
+    }
+    m_groups[group].mode.store(mode, std::memory_order_release);
+}
+
+TxScheduler::Mode TxScheduler::groupMode(int group) const
+{
+    if (group < 0 || group >= kMaxGroups) {
+        return Mode::Host;
+    }
+    return m_groups[group].mode.load(std::memory_order_relaxed);
+}
+
+void TxScheduler::setSetpoints(int group, const int32_t* values, int count)
+{
+    if (group < 0 || group >= kMaxGroups || !values) {
+        return;
+    }
+    Group& g = m_groups[group];
+    count = std::clamp(count, 0, kMaxGroupValues);
+
+    uint32_t seq = g.sequence.load(std::memory_order_relaxed);
+    g.sequence.store(seq + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    for (int i = 0; i < count; ++i) {
+        g.values[i].store(values[i], std::memory_order_relaxed);
+    }
+    g.valueCount.store(count, std::memory_order_relaxed);
+    g.sequence.store(seq + 2, std::memory_order_release);
+}
+
+int TxScheduler::readSetpoints(Group& group, int32_t* values, uint32_t* sequence) const
+{
+    for (;;) {
+        uint32_t before = group.sequence.load(std::memory_order_acquire);
+        if (before & 1) {
+            continue;
+        }
+        int count = group.valueCount.load(std::memory_order_relaxed);
+        for (int i = 0; i < count; ++i) {
+            values[i] = group.values[i].load(std::memory_order_relaxed);
+        }
+        std::atomic_thread_fence(std::memory_order_acquire);
+        if (group.sequence.load(std::memory_order_relaxed) == before) {
+            if (sequence) {
+                *sequence = before;
+            }
+            return count;
+        }
+    }
+}
+
+TxScheduler::GroupStats TxScheduler::groupStats(int group) const
+{
+    GroupStats stats;
+    if (group < 0 || group >= kMaxGroups) {
+        return stats;
+    }
+    const Group& g = m_groups[group];
+    stats.sent = g.sent.load(std::memory_order_relaxed);
+    stats.missedDeadlines = g.missed.load(std::memory_order_relaxed);
+    stats.rearms = g.rearms.load(std::memory_order_relaxed);
+    stats.windowGapFrames = g.gapFrames.load(std::memory_order_relaxed);
+    stats.maxWindowGapUs = static_cast<double>(g.gapMaxNs.load(std::memory_order_relaxed)) / 1000.0;
+    stats.maxLatenessUs = static_cast<double>(g.latenessMaxNs.load(std::memory_order_relaxed)) / 1000.0;
+    if (stats.sent > 0) {
+        const double n = static_cast<double>(stats.sent);
+        const double mean = g.latenessSumNs.load(std::memory_order_relaxed) / n;
+        const double variance = g.latenessSqSumNs.load(std::memory_order_relaxed) / n - mean * mean;
+        stats.meanLatenessUs = mean / 1000.0;
+        stats.jitterUs = std::sqrt(std::max(variance, 0.0)) / 1000.0;
+    }
+    return stats;
+}
+
+void TxScheduler::resetStats(int group)
+{
+    if (group < 0 || group >= kMaxGroups) {
+        return;
+    }
+    // Cleared by the scheduler thread so the counters keep a single writer
+    m_groups[group].resetRequested.store(true, std::memory_order_release);
+}
+
+void TxScheduler::resetIfRequested(Group& group)
+{
+    if (group.resetRequested.exchange(false, std::memory_order_acq_rel)) {
+        group.sent.store(0, std::memory_order_relaxed);
+        group.missed.store(0, std::memory_order_relaxed);
+        group.rearms.store(0, std::memory_order_relaxed);
+        group.gapFrames.store(0, std::memory_order_relaxed);
+        group.gapMaxNs.store(0, std::memory_order_relaxed);
+        group.latenessMaxNs.store(0, std::memory_order_relaxed);
+        group.latenessSumNs.store(0.0, std::memory_order_relaxed);
+        group.latenessSqSumNs.store(0.0, std::memory_order_relaxed);
+    }
+}
+
+void TxScheduler::record(Group& group, int64_t latenessNs, uint64_t missed)
+{
+    resetIfRequested(group);
+
+    const double lateness = static_cast<double>(latenessNs);
+    group.sent.store(group.sent.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+    group.missed.store(group.missed.load(std::memory_order_relaxed) + missed, std::memory_order_relaxed);
+    group.latenessSumNs.store(group.latenessSumNs.load(std::memory_order_relaxed) + lateness,
+                              std::memory_order_relaxed);
+    group.latenessSqSumNs.store(group.latenessSqSumNs.load(std::memory_order_relaxed) + lateness * lateness,
+                                std::memory_order_relaxed);
+    if (latenessNs > group.latenessMaxNs.load(std::memory_order_relaxed)) {
+        group.latenessMaxNs.store(latenessNs, std::memory_order_relaxed);
+    }
+}
+
+void TxScheduler::onTxEcho(int group, int64_t hostTimeNs)
+{
+    if (m_checkGroup.load(std::memory_order_acquire) != group) {
+        return;
+    }
+    // Sent callbacks come from one SDK thread per device
+    const int echoes = m_checkEchoes.load(std::memory_order_relaxed);
+    if (echoes >= m_checkTimes.load(std::memory_order_relaxed)) {
+        return;
+    }
+    if (echoes == 0) {
+        m_checkFirstNs.store(hostTimeNs, std::memory_order_relaxed);
+    }
+    m_checkLastNs.store(hostTimeNs, std::memory_order_relaxed);
+    m_checkEchoes.store(echoes + 1, std::memory_order_release);
+}
+
+void TxScheduler::finishCheck(int64_t now)
+{
+    const int times = m_checkTimes.load(std::memory_order_relaxed);
+    const int echoes = m_checkEchoes.load(std::memory_order_acquire);
+    if (echoes < times && now < m_checkDueNs) {
+        return;
+    }
+
+    // Every frame of the window must have been echoed, at the period asked for
+    bool confirmed = false;
+    if (echoes == times) {
+        const double spacing = static_cast<double>(m_checkLastNs.load(std::memory_order_relaxed)
+                                                   - m_checkFirstNs.load(std::memory_order_relaxed))
+                               / (times - 1);
+        confirmed = std::fabs(spacing / static_cast<double>(m_checkPeriodNs) - 1.0) <= kCheckTolerance;
+    }
+    m_offloadCheck.store(confirmed ? OffloadCheck::Confirmed : OffloadCheck::Failed, std::memory_order_relaxed);
+    m_checkGroup.store(-1, std::memory_order_release);
+}
+
+void TxScheduler::applyThreadOptions()
+{
+    bool realtime = false;
+
+#if defined(_WIN32)
+    if (m_cpu >= 0 && m_cpu < 64) {
+        SetThreadAffinityMask(GetCurrentThread(), DWORD_PTR(1) << m_cpu);
+    }
+    if (m_realtime) {
+        realtime = SetThreadPriority(GetCurrentThread(), THREAD_PRIORITY_TIME_CRITICAL) != 0;
+    }
+#elif defined(__linux__)
+    // Default 50 us timer slack would dominate the jitter budget at kHz rates
+    prctl(PR_SET_TIMERSLACK, 1UL, 0UL, 0UL, 0UL);
+
+    if (m_cpu >= 0 && m_cpu < CPU_SETSIZE) {
+        cpu_set_t set;
+        CPU_ZERO(&set);
+        CPU_SET(m_cpu, &set);
+        pthread_setaffinity_np(pthread_self(), sizeof(set), &set);
+    }
+    if (m_realtime) {
+        sched_param param{};
+        param.sched_priority = std::clamp(m_priority,
+                                          sched_get_priority_min(SCHED_FIFO),
+                                          sched_get_priority_max(SCHED_FIFO));
+        realtime = pthread_setschedparam(pthread_self(), SCHED_FIFO, &param) == 0;
+    }
+#endif
+
+    m_realtimeActive.store(realtime, std::memory_order_relaxed);
+}
+
+void TxScheduler::run()
+{
+    applyThreadOptions();
+
+    // Per-group deadline state, owned by this thread. An armed repeat can't
+    // be cancelled or replaced, so nothing else is sent for a group before
+    // armedUntil, which is past the window's last frame. nextSlot is where
+    // the frame after that last one is due.
+    int64_t periods[kMaxGroups] = {};
+    int64_t deadlines[kMaxGroups] = {};
+    int64_t armedUntil[kMaxGroups] = {};
+    int64_t nextSlot[kMaxGroups] = {};
+    bool armed[kMaxGroups] = {};            // The adapter repeated the group last
+    int32_t values[kMaxGroupValues];
+
+    while (m_running.load(std::memory_order_acquire)) {
+        const int64_t now = steadyNowNs();
+        int64_t wake = now + kMaxSleepNs;
+
+        if (m_checkGroup.load(std::memory_order_relaxed) >= 0
+            && now >= armedUntil[m_checkGroup.load(std::memory_order_relaxed)]) {
+            finishCheck(now);
+        }
+        int checkGroup = m_checkGroup.load(std::memory_order_relaxed);
+        const OffloadCheck check = m_offloadCheck.load(std::memory_order_relaxed);
+
+        for (int g = 0; g < kMaxGroups; ++g) {
+            Group& group = m_groups[g];
+            if (armedUntil[g] > now) {
+                wake = std::min(wake, armedUntil[g]);
+                continue;
+            }
+            // Checked window done, echoes still due: nothing else may be echoed meanwhile
+            if (check == OffloadCheck::Pending && checkGroup == g) {
+                wake = std::min(wake, now + kCheckPollNs);
+                continue;
+            }
+
+            if (!group.enabled.load(std::memory_order_acquire)) {
+                periods[g] = 0;
+                // Once the repeat has run out, leave the motors on a zero command
+                if (armed[g]) {
+                    armed[g] = false;
+                    const int count = readSetpoints(group, values);
+                    std::fill(values, values + count, 0);
+                    if (count > 0 && m_send) {
+                        m_send(g, values, count, TxRepeat());
+                    }
+                }
+                continue;
+            }
+
+            // Enabling or retiming restarts the deadline chain at now
+            const int64_t period = 1000000000LL / group.rateHz.load(std::memory_order_acquire);
+            if (period != periods[g]) {
+                periods[g] = period;
+                deadlines[g] = now;
+            }
+            if (now < deadlines[g]) {
+                wake = std::min(wake, deadlines[g]);
+                continue;
+            }
+
+            // Offloaded groups fall back to host timing while the check runs
+            // on another group, after it failed, and at rates too low to repeat
+            const int count = readSetpoints(group, values);
+            const int32_t times = static_cast<int32_t>(std::max<int64_t>(kOffloadWindowNs / period, 1));
+            bool offload = false;
+            if (group.mode.load(std::memory_order_acquire) == Mode::Offloaded) {
+                if (check == OffloadCheck::Confirmed) {
+                    offload = times > 1;
+                } else if (check == OffloadCheck::Pending && checkGroup < 0 && times >= kMinCheckFrames
+                           && count > 0 && m_send) {
+                    m_checkTimes.store(times, std::memory_order_relaxed);
+                    m_checkEchoes.store(0, std::memory_order_relaxed);
+                    m_checkPeriodNs = period;
+                    m_checkDueNs = now + static_cast<int64_t>(times * period * (1.0 + kCheckTolerance)) + kCheckSlackNs;
+                    m_checkGroup.store(g, std::memory_order_release);
+                    checkGroup = g;
+                    offload = true;
+                }
+            }
+
+            const int64_t lateness = now - deadlines[g];
+            if (offload) {
+                TxRepeat repeat;
+                repeat.intervalNs = period;
+                repeat.times = times;
+                if (count > 0 && m_send) {
+                    m_send(g, values, count, repeat);
+                }
+                resetIfRequested(group);
+                group.rearms.store(group.rearms.load(std::memory_order_relaxed) + 1,
+                                   std::memory_order_relaxed);
+
+                // Slots that passed between the last window and this one were not sent
+                if (armed[g] && now - nextSlot[g] > period / 2) {
+                    const int64_t gap = now - nextSlot[g];
+                    group.gapFrames.store(group.gapFrames.load(std::memory_order_relaxed)
+                                              + static_cast<uint64_t>((gap + period / 2) / period),
+                                          std::memory_order_relaxed);
+                    if (gap > group.gapMaxNs.load(std::memory_order_relaxed)) {
+                        group.gapMaxNs.store(gap, std::memory_order_relaxed);
+                    }
+                }
+
+                // The next window is chained onto this one's deadline, so windows
+                // butt together at the group's cadence. The adapter starts a window
+                // when it gets it, though: one sent late pushes the next out just
+                // far enough that it can't start before this one's last frame.
+                const int64_t window = times * period;
+                armed[g] = true;
+                nextSlot[g] = now + window;
+                deadlines[g] = std::max(deadlines[g] + window, now + window - period / 2);
+                armedUntil[g] = deadlines[g];
+                wake = std::min(wake, armedUntil[g]);
+                continue;
+            }
+
+            armed[g] = false;
+            if (count > 0 && m_send) {
+                m_send(g, values, count, TxRepeat());
+            }
+
+            // Keep the phase; periods that already passed are skipped, not burst
+            deadlines[g] += period;
+            uint64_t missed = 0;
+            if (deadlines[g] <= now) {
+                missed = static_cast<uint64_t>((now - deadlines[g]) / period) + 1;
+                deadlines[g] += static_cast<int64_t>(missed) * period;
+            }
+            record(group, lateness, missed);
+
+            wake = std::min(wake, deadlines[g]);
+        }
+
+        sleepUntilNs(wake);
+    }
+}
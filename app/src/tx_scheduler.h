@@ -0,0 +1,164 @@
+#ifndef TX_SCHEDULER_H
+#define TX_SCHEDULER_H
+
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <thread>
+
+#include "motor_profile.h"
+
+// Adapter-side repetition attached to one send. times == 1 is a plain
+// single frame; otherwise the adapter emits the frame times times,
+// intervalNs apart, without further host involvement.
+struct TxRepeat
+{
+    int64_t intervalNs = 0;
+    int32_t times = 1;
+};
+
+// Periodic command transmitter running on its own thread.
+// Each group is sent against absolute deadlines (next = previous + period),
+// so send time and wake-up latency never accumulate into the rate.
+// Setpoints, rates and enables can be changed from any thread without locks.
+class TxScheduler
+{
+public:
+    static constexpr int kMaxGroups = 8;
+    static constexpr int kMaxGroupValues = kMaxCommandValues;
+    static constexpr int kMaxRateHz = 10000;
+
+    // Offloaded groups are armed one window at a time, so a stalled or
+    // closed host stops commanding the motors within one window. Windows
+    // follow each other without a gap; a late re-arm is counted in
+    // GroupStats. The SDK can neither cancel nor replace an armed repeat:
+    // setpoint, rate and mode changes, and disabling, take effect when the
+    // window runs out, which bounds how often a window is re-armed too.
+    static constexpr int64_t kOffloadWindowNs = 50000000;
+
+    enum class Mode
+    {
+        Host,       // One frame per period, timed by this thread
+        Offloaded   // Adapter repeats the frame a window at a time
+    };
+
+    // The repeat interval unit is not documented by the SDK. The first
+    // offloaded window is a check: its TX echoes must arrive at the chosen
+    // period, or offloading falls back to host timing until the next start().
+    enum class OffloadCheck
+    {
+        Pending,
+        Confirmed,
+        Failed
+    };
+
+    // Invoked on the scheduler thread for every due group
+    using SendFunction = std::function<void(int group, const int32_t* values, int count,
+                                            const TxRepeat& repeat)>;
+
+    // Lateness is measured from the deadline to the start of the send
+    struct GroupStats
+    {
+        uint64_t sent = 0;
+        uint64_t missedDeadlines = 0;   // Periods skipped because the thread ran late
+        uint64_t rearms = 0;            // Offloaded mode: windows armed on the adapter
+        uint64_t windowGapFrames = 0;   // Offloaded mode: slots lost between windows
+        double maxWindowGapUs = 0.0;    // Longest of those gaps, past the due slot
+        double meanLatenessUs = 0.0;
+        double jitterUs = 0.0;          // Standard deviation of lateness
+        double maxLatenessUs = 0.0;
+    };
+
+    explicit TxScheduler(SendFunction send);
+    ~TxScheduler();
+
+    TxScheduler(const TxScheduler&) = delete;
+    TxScheduler& operator=(const TxScheduler&) = delete;
+
+    // Thread options, applied when the thread starts. SCHED_FIFO usually
+    // needs CAP_SYS_NICE / rtprio limits; without them the thread keeps
+    // the normal policy and realtimeActive() reports false.
+    void setRealtime(bool enabled, int priority = 80);
+    void setCpuAffinity(int cpu);   // -1 = no pinning
+    bool realtimeActive() const { return m_realtimeActive.load(std::memory_order_relaxed); }
+
+    void start();
+    void stop();
+    bool isRunning() const { return m_running.load(std::memory_order_relaxed); }
+
+    // Group configuration (any thread)
+    void setGroupEnabled(int group, bool enabled);
+    void setGroupRate(int group, int hz);
+    int groupRate(int group) const;
+    void setGroupMode(int group, Mode mode);
+    Mode groupMode(int group) const;
+
+    // Setpoint mailbox. Single writer (the UI thread); the scheduler
+    // always sends the latest complete set.
+    void setSetpoints(int group, const int32_t* values, int count);
+
+    GroupStats groupStats(int group) const;
+    void resetStats(int group);
+
+    OffloadCheck offloadCheck() const { return m_offloadCheck.load(std::memory_order_relaxed); }
+
+    // TX echo of a group's frame, from the device's sent callback. Only
+    // needed while checkingOffload().
+    bool checkingOffload() const { return m_checkGroup.load(std::memory_order_relaxed) >= 0; }
+    void onTxEcho(int group, int64_t hostTimeNs);
+
+private:
+    struct Group
+    {
+        std::atomic<bool> enabled{false};
+        std::atomic<int> rateHz{20};
+        std::atomic<Mode> mode{Mode::Host};
+
+        // Seqlock over atomic values: odd sequence = write in progress
+        std::atomic<uint32_t> sequence{0};
+        std::atomic<int> valueCount{0};
+        std::atomic<int32_t> values[kMaxGroupValues] = {};
+
+        std::atomic<bool> resetRequested{false};
+
+        // Written by the scheduler thread only
+        std::atomic<uint64_t> sent{0};
+        std::atomic<uint64_t> missed{0};
+        std::atomic<uint64_t> rearms{0};
+        std::atomic<uint64_t> gapFrames{0};
+        std::atomic<int64_t> gapMaxNs{0};
+        std::atomic<int64_t> latenessMaxNs{0};
+        std::atomic<double> latenessSumNs{0.0};
+        std::atomic<double> latenessSqSumNs{0.0};
+    };
+
+    void run();
+    void applyThreadOptions();
+    int readSetpoints(Group& group, int32_t* values, uint32_t* sequence = nullptr) const;
+    void resetIfRequested(Group& group);
+    void record(Group& group, int64_t latenessNs, uint64_t missed);
+    void finishCheck(int64_t now);
+
+    SendFunction m_send;
+    Group m_groups[kMaxGroups];
+
+    std::atomic<bool> m_running{false};
+    std::thread m_thread;
+
+    bool m_realtime = false;
+    int m_priority = 80;
+    int m_cpu = -1;
+    std::atomic<bool> m_realtimeActive{false};
+
+    // Offload check: the group whose first window is checked, and its echoes
+    std::atomic<OffloadCheck> m_offloadCheck{OffloadCheck::Pending};
+    std::atomic<int> m_checkGroup{-1};
+    std::atomic<int> m_checkEchoes{0};
+    std::atomic<int64_t> m_checkFirstNs{0};
+    std::atomic<int64_t> m_checkLastNs{0};
+    std::atomic<int> m_checkTimes{0};   // Echoes expected; later ones are ignored
+    int64_t m_checkPeriodNs = 0;        // Scheduler thread only, like the due time
+    int64_t m_checkDueNs = 0;
+};
+
+#endif // TX_SCHEDULER_H
@@ -0,0 +1,234 @@
+// Records a busy and a quiet bus with TX echoes, then checks the index the
+// recorder wrote: block and per-ID summaries must match the records they
+// cover and blocksInRange() must find exactly the blocks overlapping a time
+// range. A copy cut off inside the records has no footer; scanning it must
+// find the same records, per time range, as the index of the complete file.
+
+#include "capture_file.h"
+#include "frame_recorder.h"
+#include "test_check.h"
+
+#include <QFile>
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <map>
+#include <random>
+#include <thread>
+#include <tuple>
+#include <vector>
+
+namespace {
+constexpr int kBusyFrames = 150000;     // Bus 0, 100 us apart, 8 IDs in turn
+constexpr int kQuietFrames = 2000;      // Bus 1, 7.5 ms apart
+constexpr int kEchoEvery = 10;          // Bus 0 sends every tenth period
+
+// What a time range query is compared on
+using Record = std::tuple<int64_t, int, bool, uint32_t>;   // Time, bus, TX, CAN ID
+
+// Blocks are handed off once kFlushAgeNs of recorded time old. Playing the
+// recording 40 times faster than it was taken keeps that well under a
+// lane's two blocks per writer poll, so normally nothing is dropped.
+void pace(std::chrono::steady_clock::time_point start, int64_t timeNs)
+{
+    std::this_thread::sleep_until(start + std::chrono::nanoseconds(timeNs / 40));
+}
+
+void record(const QString& path, FrameRecorder::Stats& stats)
+{
+    FrameRecorder recorder;
+    CHECK(recorder.start(path));
+
+    const auto start = std::chrono::steady_clock::now();
+    std::thread busy([&]() {
+        usb_rx_frame_t frame{};
+        frame.head.dlc = 8;
+        for (int i = 0; i < kBusyFrames; ++i) {
+            const int64_t time = int64_t(i) * 100000;
+            frame.head.can_id = 0x201 + static_cast<uint32_t>(i % 8);
+            recorder.record(0, 0, frame, time, false);
+            if (i % kEchoEvery == 0) {
+                frame.head.can_id = 0x200;
+                recorder.record(1, 0, frame, time + 1000, true);
+            }
+            if (i % 100 == 0) {
+                pace(start, time);
+            }
+        }
+    });
+    std::thread quiet([&]() {
+        usb_rx_frame_t frame{};
+        frame.head.dlc = 4;
+        frame.head.can_id = 0x141;
+        for (int i = 0; i < kQuietFrames; ++i) {
+            const int64_t time = int64_t(i) * 7500000 + 300;
+            recorder.record(2, 1, frame, time, false);
+            pace(start, time);
+        }
+    });
+    busy.join();
+    quiet.join();
+    recorder.stop();
+    stats = recorder.stats();
+    CHECK(!stats.writeFailed);
+}
+
+// Records of capture that end at or before end bytes into the file
+std::vector<Record> records(const CaptureFile& capture, uint64_t end)
+{
+    std::vector<Record> result;
+    for (const CaptureBlockEntry& block : capture.blocks()) {
+        capture.forEachRecord(block, [&](const CaptureRecord& record, const uint8_t* payload) {
+            if (static_cast<uint64_t>(payload - capture.data()) + record.length <= end) {
+                result.emplace_back(record.hostTimeNs, record.bus, (record.flags & CaptureFormat::Tx) != 0,
+                                    record.canId);
+            }
+        });
+    }
+    std::sort(result.begin(), result.end());
+    return result;
+}
+
+// Records of [t0, t1] as found through the index
+std::vector<Record> recordsInRange(const CaptureFile& capture, int64_t t0, int64_t t1)
+{
+    std::vector<Record> result;
+    for (int index : capture.blocksInRange(t0, t1)) {
+        capture.forEachRecord(capture.blocks()[index], [&](const CaptureRecord& record, const uint8_t*) {
+            if (record.hostTimeNs >= t0 && record.hostTimeNs <= t1) {
+                result.emplace_back(record.hostTimeNs, record.bus, (record.flags & CaptureFormat::Tx) != 0,
+                                    record.canId);
+            }
+        });
+    }
+    std::sort(result.begin(), result.end());
+    return result;
+}
+
+std::vector<Record> slice(const std::vector<Record>& all, int64_t t0, int64_t t1)
+{
+    auto begin = std::lower_bound(all.begin(), all.end(), Record(t0, -1, false, 0));
+    auto end = std::upper_bound(all.begin(), all.end(), Record(t1, 255, true, UINT32_MAX));
+    return std::vector<Record>(begin, end);
+}
+
+void checkBlocks(const CaptureFile& capture, uint64_t expectedFrames)
+{
+    uint64_t frames = 0;
+    for (const CaptureBlockEntry& block : capture.blocks()) {
+        uint32_t count = 0;
+        int64_t previous = block.firstTimeNs;
+        std::map<uint32_t, CaptureIdSummary> ids;
+        capture.forEachRecord(block, [&](const CaptureRecord& record, const uint8_t*) {
+            CHECK(record.bus == block.bus);
+            CHECK((record.flags & CaptureFormat::Tx) == (block.flags & CaptureFormat::Tx));
+            CHECK(record.hostTimeNs >= previous && record.hostTimeNs <= block.lastTimeNs);
+            previous = record.hostTimeNs;
+            CaptureIdSummary& id = ids[record.canId];
+            if (id.frames++ == 0) {
+                id.firstTimeNs = record.hostTimeNs;
+            }
+            id.lastTimeNs = record.hostTimeNs;
+            ++count;
+        });
+        CHECK(count == block.frames);
+        CHECK(block.summaryCount == ids.size());
+        const CaptureIdSummary* summaries = capture.summaries(block);
+        for (int i = 0; i < block.summaryCount; ++i) {
+            const auto it = ids.find(summaries[i].canId);
+            CHECK(it != ids.end());
+            CHECK(summaries[i].frames == it->second.frames);
+            CHECK(summaries[i].firstTimeNs == it->second.firstTimeNs);
+            CHECK(summaries[i].lastTimeNs == it->second.lastTimeNs);
+        }
+        frames += block.frames;
+    }
+    CHECK(frames == expectedFrames);
+}
+
+void checkRanges(const CaptureFile& capture, const std::vector<Record>& all, std::mt19937& random)
+{
+    const int64_t first = capture.firstTimeNs();
+    const int64_t span = capture.lastTimeNs() - first;
+    std::uniform_int_distribution<int64_t> starts(first - span / 10, first + span);
+    for (int i = 0; i < 100; ++i) {
+        const int64_t t0 = starts(random);
+        const int64_t t1 = t0 + (span >> (i % 16));
+
+        // Exactly the blocks that overlap, in the index's order
+        std::vector<int> expected;
+        for (size_t b = 0; b < capture.blocks().size(); ++b) {
+            if (capture.blocks()[b].lastTimeNs >= t0 && capture.blocks()[b].firstTimeNs <= t1) {
+                expected.push_back(static_cast<int>(b));
+            }
+        }
+        CHECK(capture.blocksInRange(t0, t1) == expected);
+        CHECK(recordsInRange(capture, t0, t1) == slice(all, t0, t1));
+    }
+}
+
+bool copyPrefix(const QString& from, const QString& to, uint64_t size)
+{
+    QFile in(from);
+    QFile out(to);
+    if (!in.open(QIODevice::ReadOnly) || !out.open(QIODevice::WriteOnly)) {
+        return false;
+    }
+    std::vector<char> data(static_cast<size_t>(size));
+    return in.read(data.data(), static_cast<qint64>(size)) == static_cast<qint64>(size)
+           && out.write(data.data(), static_cast<qint64>(size)) == static_cast<qint64>(size);
+}
+}
+
+int main()
+{
+    const QString path = QStringLiteral("capture_index_test.dmcap");
+    const QString cutPath = QStringLiteral("capture_index_test_cut.dmcap");
+    std::mt19937 random(23);
+
+    FrameRecorder::Stats recorded;
+    record(path, recorded);
+    const uint64_t echoes = (kBusyFrames + kEchoEvery - 1) / kEchoEvery;
+    CHECK(recorded.frames == kBusyFrames + kQuietFrames + echoes);
+    const uint64_t written = recorded.frames - recorded.droppedFrames;
+
+    uint64_t cut = 0;
+    std::vector<Record> all;
+    {
+        CaptureFile capture;
+        QString error;
+        CHECK(capture.open(path, &error));
+        CHECK(capture.isIndexed());
+        CHECK(capture.blocks().size() > 10);
+        checkBlocks(capture, written);
+
+        all = records(capture, capture.recordsEnd());
+        CHECK(all.size() == written);
+        CHECK(capture.firstTimeNs() == std::get<0>(all.front()));
+        CHECK(capture.lastTimeNs() == std::get<0>(all.back()));
+        checkRanges(capture, all, random);
+
+        // Mid-record, two thirds of the way in: the footer and a torn record go
+        cut = capture.recordsBegin() + (capture.recordsEnd() - capture.recordsBegin()) * 2 / 3 + 5;
+        all = records(capture, cut);
+        CHECK(copyPrefix(path, cutPath, cut));
+    }
+
+    {
+        CaptureFile capture;
+        CHECK(capture.open(cutPath));
+        CHECK(!capture.isIndexed());
+        CHECK(capture.blocks().empty());
+        capture.scanIndex();
+        CHECK(!capture.blocks().empty());
+        CHECK(capture.recordsEnd() <= cut);
+        checkBlocks(capture, all.size());
+        CHECK(records(capture, capture.recordsEnd()) == all);
+        checkRanges(capture, all, random);
+    }
+
+    QFile::remove(path);
+    QFile::remove(cutPath);
+    return 0;
+}
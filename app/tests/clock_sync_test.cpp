@@ -0,0 +1,79 @@
+// Feeds ClockSync an adapter clock with drift and jittered USB latency,
+// starting with a badly delayed frame. Partway through, the adapter clock
+// runs fast long enough for the fit to be rejected, and later the counter
+// restarts. Mapped times must never decrease or run ahead of the host
+// receive time. Once the fit has settled, they must sit on the send times.
+
+#include "clock_sync.h"
+#include "test_check.h"
+
+#include <algorithm>
+#include <cmath>
+#include <random>
+
+namespace {
+constexpr int64_t kPeriodNs = 1000000;         // 1 kHz frames
+constexpr int kFrames = 60000;
+constexpr double kDriftPpm = 40.0;             // Adapter crystal
+constexpr int64_t kMinLatencyNs = 150000;
+constexpr int kFastFrom = 15000;               // Adapter clock 2 % fast...
+constexpr int kFastTo = 17000;                 // ...for two seconds
+constexpr int kRestartAt = 45000;              // Counter starts over
+constexpr int kSettled = 5000;                 // Frames after a disturbance before checking accuracy
+constexpr int64_t kAccuracyNs = 100000;
+}
+
+int main()
+{
+    ClockSync clock;
+    std::mt19937 random(7);
+    std::exponential_distribution<double> jitter(1.0 / 80000.0);
+
+    const int64_t hostStart = 5000000000LL;
+    double deviceNs = 0.0;
+    uint64_t tickBase = 123456;
+    int64_t previous = INT64_MIN;
+    int64_t lastHost = 0;
+    bool rejected = false;
+    bool recovered = false;
+
+    for (int i = 0; i < kFrames; ++i) {
+        const int64_t sent = hostStart + int64_t(i) * kPeriodNs;
+        if (i == kRestartAt) {
+            deviceNs = 0.0;
+            tickBase = 42;
+        }
+        const double rate = (i >= kFastFrom && i < kFastTo) ? 1.02 : 1.0 + kDriftPpm * 1e-6;
+        if (i > 0 && i != kRestartAt) {
+            deviceNs += kPeriodNs * rate;
+        }
+        const uint64_t ticks = tickBase + static_cast<uint64_t>(deviceNs / 1000.0);
+
+        // The first frame of all is held up by 3 ms; the rest see USB jitter,
+        // arriving in order
+        const int64_t latency = i == 0 ? 3000000 : kMinLatencyNs + static_cast<int64_t>(jitter(random));
+        const int64_t host = std::max(sent + latency, lastHost);
+        lastHost = host;
+
+        const int64_t mapped = clock.map(ticks, host);
+        CHECK(mapped >= previous);
+        CHECK(mapped <= host);
+        previous = mapped;
+
+        rejected = rejected || clock.onHostTime();
+        recovered = recovered || (rejected && !clock.onHostTime());
+
+        // Settled: on the send time plus the least latency
+        const bool settled = (i >= kSettled && i < kFastFrom)
+                             || (recovered && i >= kFastTo + 4 * kSettled && i < kRestartAt)
+                             || i >= kRestartAt + kSettled;
+        if (settled) {
+            CHECK(!clock.onHostTime());
+            CHECK(std::llabs(mapped - (sent + kMinLatencyNs)) < kAccuracyNs);
+        }
+    }
+    CHECK(rejected);
+    CHECK(recovered);
+    CHECK(std::fabs(clock.driftPpm() + kDriftPpm) < 5.0);
+    return 0;
+}
@@ -0,0 +1,440 @@
+// Exports a capture several chunks long, the same capture without its
+// index footer and a telemetry history to both CSV and column files, then
+// reads every file back. Each row must match the source in order, and the
+// history export must hold the union of the motors' fields, empty where a
+// motor has none.
+
+#include "capture_file.h"
+#include "capture_index.h"
+#include "data_exporter.h"
+#include "test_check.h"
+
+#include <QFile>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace {
+constexpr int kBlockFrames = 2000;
+constexpr int kBlocksPerLane = 30;      // About 6 MB of records: two chunks
+constexpr int kHistoryRows = 70000;     // Per motor: two chunks each
+
+struct FrameRow
+{
+    int64_t timeNs;
+    uint64_t deviceTime;
+    uint8_t bus;
+    uint8_t flags;
+    uint32_t canId;
+    uint8_t dlc;
+    std::string data;
+};
+
+// A file read back as columns: fixed-width values back to back, or one
+// string per row for Bytes
+struct Table
+{
+    std::vector<std::string> names;
+    std::vector<ColumnType> types;
+    std::vector<std::vector<uint8_t>> values;
+    std::vector<std::vector<std::string>> bytes;
+    uint64_t rows = 0;
+
+    template <typename T>
+    T value(int column, uint64_t row) const
+    {
+        T v;
+        std::memcpy(&v, values[column].data() + row * sizeof(T), sizeof(T));
+        return v;
+    }
+};
+
+std::string readFile(const QString& path)
+{
+    QFile file(path);
+    CHECK(file.open(QIODevice::ReadOnly));
+    std::string data(static_cast<size_t>(file.size()), '\0');
+    CHECK(file.read(&data[0], static_cast<qint64>(data.size())) == static_cast<qint64>(data.size()));
+    return data;
+}
+
+std::vector<std::vector<std::string>> readCsv(const QString& path)
+{
+    const std::string data = readFile(path);
+    std::vector<std::vector<std::string>> lines;
+    size_t pos = 0;
+    while (pos < data.size()) {
+        const size_t end = data.find('\n', pos);
+        CHECK(end != std::string::npos);
+        std::vector<std::string> fields;
+        size_t field = pos;
+        while (true) {
+            const size_t comma = data.find(',', field);
+            if (comma == std::string::npos || comma > end) {
+                fields.push_back(data.substr(field, end - field));
+                break;
+            }
+            fields.push_back(data.substr(field, comma - field));
+            field = comma + 1;
+        }
+        lines.push_back(fields);
+        pos = end + 1;
+    }
+    return lines;
+}
+
+Table readColumns(const QString& path)
+{
+    const std::string data = readFile(path);
+    Table table;
+    size_t pos = 0;
+    auto take = [&](void* out, size_t size) {
+        CHECK(pos + size <= data.size());
+        std::memcpy(out, data.data() + pos, size);
+        pos += size;
+    };
+
+    ColumnFileHeader header;
+    take(&header, sizeof(header));
+    CHECK(std::memcmp(header.magic, ColumnFile::kMagic, sizeof(header.magic)) == 0);
+    for (uint32_t c = 0; c < header.columnCount; ++c) {
+        ColumnFileColumn column;
+        take(&column, sizeof(column));
+        table.types.push_back(static_cast<ColumnType>(column.type));
+        table.names.push_back(data.substr(pos, column.nameBytes));
+        pos += column.nameBytes;
+    }
+    table.values.resize(header.columnCount);
+    table.bytes.resize(header.columnCount);
+
+    ColumnFileTrailer trailer;
+    CHECK(data.size() >= pos + sizeof(trailer));
+    std::memcpy(&trailer, data.data() + data.size() - sizeof(trailer), sizeof(trailer));
+    CHECK(std::memcmp(trailer.magic, ColumnFile::kTrailerMagic, sizeof(trailer.magic)) == 0);
+
+    std::vector<uint64_t> groups;
+    while (pos < trailer.groupIndexOffset) {
+        groups.push_back(pos);
+        uint32_t rows = 0;
+        take(&rows, sizeof(rows));
+        for (uint32_t c = 0; c < header.columnCount; ++c) {
+            ColumnFileBlock block;
+            take(&block, sizeof(block));
+            CHECK(pos + block.storedBytes <= data.size());
+            std::string raw = data.substr(pos, block.storedBytes);
+            pos += block.storedBytes;
+            if (block.storedBytes != block.rawBytes) {
+                const QByteArray inflated = qUncompress(reinterpret_cast<const unsigned char*>(raw.data()),
+                                                        static_cast<qsizetype>(raw.size()));
+                raw.assign(inflated.constData(), static_cast<size_t>(inflated.size()));
+            }
+            CHECK(raw.size() == block.rawBytes);
+            if (table.types[c] == ColumnType::Bytes) {
+                const size_t offsets = rows * sizeof(uint32_t);
+                uint32_t begin = 0;
+                for (uint32_t row = 0; row < rows; ++row) {
+                    uint32_t end = 0;
+                    std::memcpy(&end, raw.data() + row * sizeof(uint32_t), sizeof(end));
+                    table.bytes[c].push_back(raw.substr(offsets + begin, end - begin));
+                    begin = end;
+                }
+            } else {
+                CHECK(raw.size() == rows * static_cast<size_t>(ColumnFile::valueSize(table.types[c])));
+                table.values[c].insert(table.values[c].end(), raw.begin(), raw.end());
+            }
+        }
+        table.rows += rows;
+    }
+    CHECK(pos == trailer.groupIndexOffset);
+    CHECK(trailer.rows == table.rows);
+    CHECK(trailer.groupCount == groups.size());
+    for (uint64_t offset : groups) {
+        uint64_t stored = 0;
+        take(&stored, sizeof(stored));
+        CHECK(stored == offset);
+    }
+    return table;
+}
+
+std::string hex(const std::string& bytes)
+{
+    static constexpr char kHex[] = "0123456789abcdef";
+    std::string out;
+    for (unsigned char byte : bytes) {
+        out += kHex[byte >> 4];
+        out += kHex[byte & 0xF];
+    }
+    return out;
+}
+
+std::string hexValue(uint64_t value)
+{
+    char text[24];
+    std::snprintf(text, sizeof(text), "0x%llx", static_cast<unsigned long long>(value));
+    return text;
+}
+
+// Three lanes whose blocks interleave in the file: classic frames on bus
+// 0, CAN FD frames with extended IDs on bus 1 and remote frames sent on
+// bus 0. Returns the rows in file order, which is the export's order.
+std::vector<FrameRow> writeCapture(const QString& path, bool footer)
+{
+    std::mt19937 random(24);
+    QFile file(path);
+    CHECK(file.open(QIODevice::WriteOnly | QIODevice::Truncate));
+    const CaptureFileHeader header = CaptureFormat::fileHeader();
+    file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+
+    CaptureIndexBuilder index;
+    std::vector<FrameRow> rows;
+    std::vector<uint8_t> block;
+    uint64_t offset = sizeof(header);
+    int64_t laneTime[3] = {1000000000, 1000000300, 1000000700};
+    for (int b = 0; b < kBlocksPerLane; ++b) {
+        for (int lane = 0; lane < 3; ++lane) {
+            block.clear();
+            for (int i = 0; i < kBlockFrames; ++i) {
+                usb_rx_frame_t frame{};
+                frame.head.time_stamp = uint64_t(random()) << 32 | random();
+                frame.head.can_id = lane == 1 ? (random() & 0x1FFFFFFF) : 0x200 + (random() & 0xFF);
+                frame.head.ext = lane == 1;
+                frame.head.canfd = lane == 1;
+                frame.head.rtr = lane == 2;
+                frame.head.dlc = static_cast<uint8_t>(lane == 1 ? 9 + random() % 7 : random() % 9);
+                for (uint8_t& byte : frame.payload) {
+                    byte = static_cast<uint8_t>(random());
+                }
+                const int bus = lane == 1 ? 1 : 0;
+                const bool tx = lane == 2;
+                laneTime[lane] += 50000 + random() % 1000;
+
+                uint8_t record[CaptureFormat::kMaxRecordSize];
+                const int size = CaptureFormat::encode(frame, bus, laneTime[lane], tx, record);
+                block.insert(block.end(), record, record + size);
+
+                CaptureRecord encoded;
+                std::memcpy(&encoded, record, sizeof(encoded));
+                rows.push_back({laneTime[lane], encoded.deviceTime, encoded.bus, encoded.flags, encoded.canId,
+                                encoded.dlc,
+                                std::string(reinterpret_cast<const char*>(record + sizeof(encoded)), encoded.length)});
+            }
+            index.addBlock(offset, block.data(), block.size());
+            file.write(reinterpret_cast<const char*>(block.data()), static_cast<qint64>(block.size()));
+            offset += block.size();
+        }
+    }
+    if (footer) {
+        const std::vector<uint8_t> tail = index.footer(offset);
+        file.write(reinterpret_cast<const char*>(tail.data()), static_cast<qint64>(tail.size()));
+    }
+    return rows;
+}
+
+void run(DataExporter& exporter, std::atomic<bool>& finished, bool started)
+{
+    CHECK(started);
+    while (!finished.exchange(false)) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(2));
+    }
+    const DataExporter::Stats stats = exporter.stats();
+    CHECK(!stats.failed);
+    CHECK(!stats.cancelled);
+    CHECK(stats.chunksWritten == stats.chunkCount);
+}
+
+void checkCaptureExport(DataExporter& exporter, std::atomic<bool>& finished, const QString& capturePath,
+                        const std::vector<FrameRow>& expected)
+{
+    // Times count from the capture's first record, whichever lane it is on
+    int64_t origin = expected.front().timeNs;
+    for (const FrameRow& row : expected) {
+        origin = std::min(origin, row.timeNs);
+    }
+    const QString csvPath = QStringLiteral("data_export_test.csv");
+    const QString columnsPath = QStringLiteral("data_export_test.dmcol");
+
+    QString error;
+    run(exporter, finished, exporter.exportCapture(capturePath, csvPath, &error));
+    CHECK(exporter.stats().rows == expected.size());
+    CHECK(exporter.stats().chunkCount >= 2);
+    const std::vector<std::vector<std::string>> csv = readCsv(csvPath);
+    CHECK(csv.size() == expected.size() + 1);
+    CHECK(csv[0] == std::vector<std::string>({"time_s", "device_time", "bus", "flags", "can_id", "dlc", "data"}));
+    for (size_t i = 0; i < expected.size(); ++i) {
+        const FrameRow& row = expected[i];
+        const std::vector<std::string>& line = csv[i + 1];
+        CHECK(line.size() == 7);
+        CHECK(std::llround(std::strtod(line[0].c_str(), nullptr) * 1e9) == row.timeNs - origin);
+        CHECK(std::strtoull(line[1].c_str(), nullptr, 10) == row.deviceTime);
+        CHECK(std::atoi(line[2].c_str()) == row.bus);
+        CHECK(line[3] == hexValue(row.flags));
+        CHECK(line[4] == hexValue(row.canId));
+        CHECK(std::atoi(line[5].c_str()) == row.dlc);
+        CHECK(line[6] == hex(row.data));
+    }
+
+    run(exporter, finished, exporter.exportCapture(capturePath, columnsPath, &error));
+    const Table table = readColumns(columnsPath);
+    CHECK(table.rows == expected.size());
+    CHECK(table.names == std::vector<std::string>({"time_s", "device_time", "bus", "flags", "can_id", "dlc", "data"}));
+    for (size_t i = 0; i < expected.size(); ++i) {
+        const FrameRow& row = expected[i];
+        CHECK(table.value<double>(0, i) == static_cast<double>(row.timeNs - origin) * 1e-9);
+        CHECK(table.value<uint64_t>(1, i) == row.deviceTime);
+        CHECK(table.value<uint8_t>(2, i) == row.bus);
+        CHECK(table.value<uint8_t>(3, i) == row.flags);
+        CHECK(table.value<uint32_t>(4, i) == row.canId);
+        CHECK(table.value<uint8_t>(5, i) == row.dlc);
+        CHECK(table.bytes[6][i] == row.data);
+    }
+
+    QFile::remove(csvPath);
+    QFile::remove(columnsPath);
+}
+
+// Motor 0 has a torque field, motor 1 a temperature; both the legacy ones
+void checkHistoryExport(DataExporter& exporter, std::atomic<bool>& finished)
+{
+    FieldDefinition torque;
+    torque.id = QStringLiteral("torque");
+    FieldDefinition temperature;
+    temperature.id = QStringLiteral("temperature");
+    MotorProfile profile;
+    profile.defaultFields = {torque, temperature};
+    const int torqueSlot = 0;
+    const int temperatureSlot = 1;
+
+    TelemetryDataStore store;
+    store.setActiveProfile(profile);
+    store.setHistorySize(kHistoryRows);
+    MotorSampleBatch batch;
+    for (int i = 0; i < kHistoryRows; ++i) {
+        for (int motor = 0; motor < 2; ++motor) {
+            MotorSample sample;
+            sample.motorIndex = motor;
+            sample.timestampNs = int64_t(i) * 1000000 + motor * 1000;
+            sample.measure.current = static_cast<int16_t>(i % 2000 - 1000);
+            sample.measure.ecd = static_cast<uint16_t>(i % 8192);
+            sample.measure.speed_rpm = static_cast<int16_t>(motor ? -i % 500 : i % 500);
+            const int slot = motor ? temperatureSlot : torqueSlot;
+            sample.measure.values[slot] = i * 0.25;
+            sample.measure.validMask = 1U << slot;
+            batch.push_back(sample);
+        }
+    }
+    store.onMotorsUpdated(batch);
+    const TelemetryDataStore::SnapshotPtr snapshot = store.snapshot();
+    // Later samples must not reach the export
+    store.onMotorsUpdated(batch);
+
+    const std::vector<std::string> names = {"time_s", "motor", "torque", "current", "ecd", "speed", "temperature"};
+    // Expected value of field f (index into names) for row i of a motor; NaN when missing
+    auto expected = [](int motor, int i, size_t f) -> float {
+        switch (f) {
+        case 2:
+            return motor ? NAN : static_cast<float>(i * 0.25);
+        case 3:
+            return static_cast<float>(i % 2000 - 1000);
+        case 4:
+            return static_cast<float>(i % 8192);
+        case 5:
+            return static_cast<float>(motor ? -i % 500 : i % 500);
+        default:
+            return motor ? static_cast<float>(i * 0.25) : NAN;
+        }
+    };
+    auto expectedTime = [](int motor, int i) { return (int64_t(i) * 1000000 + motor * 1000) * 1e-9; };
+
+    const QString csvPath = QStringLiteral("data_export_test_history.csv");
+    const QString columnsPath = QStringLiteral("data_export_test_history.dmcol");
+    QString error;
+    run(exporter, finished, exporter.exportHistory(snapshot, csvPath, &error));
+    CHECK(exporter.stats().rows == 2 * kHistoryRows);
+    const std::vector<std::vector<std::string>> csv = readCsv(csvPath);
+    CHECK(csv.size() == 2 * kHistoryRows + 1);
+    CHECK(csv[0] == names);
+    for (int motor = 0; motor < 2; ++motor) {
+        for (int i = 0; i < kHistoryRows; ++i) {
+            const std::vector<std::string>& line = csv[1 + motor * kHistoryRows + i];
+            CHECK(line.size() == names.size());
+            CHECK(std::fabs(std::strtod(line[0].c_str(), nullptr) - expectedTime(motor, i)) < 1e-9);
+            CHECK(std::atoi(line[1].c_str()) == motor);
+            for (size_t f = 2; f < names.size(); ++f) {
+                const float value = expected(motor, i, f);
+                CHECK(std::isnan(value) ? line[f].empty() : std::strtof(line[f].c_str(), nullptr) == value);
+            }
+        }
+    }
+
+    run(exporter, finished, exporter.exportHistory(snapshot, columnsPath, &error));
+    const Table table = readColumns(columnsPath);
+    CHECK(table.rows == 2 * kHistoryRows);
+    CHECK(table.names == names);
+    for (int motor = 0; motor < 2; ++motor) {
+        for (int i = 0; i < kHistoryRows; ++i) {
+            const uint64_t row = static_cast<uint64_t>(motor) * kHistoryRows + i;
+            CHECK(std::fabs(table.value<double>(0, row) - expectedTime(motor, i)) < 1e-12);
+            CHECK(table.value<uint32_t>(1, row) == static_cast<uint32_t>(motor));
+            for (size_t f = 2; f < names.size(); ++f) {
+                const float value = expected(motor, i, f);
+                const float stored = table.value<float>(static_cast<int>(f), row);
+                CHECK(std::isnan(value) ? std::isnan(stored) : stored == value);
+            }
+        }
+    }
+
+    QFile::remove(csvPath);
+    QFile::remove(columnsPath);
+}
+}
+
+int main()
+{
+    std::atomic<bool> finished{false};
+    DataExporter exporter([&]() { finished.store(true); });
+
+    const QString capturePath = QStringLiteral("data_export_test.dmcap");
+    const QString bareCapturePath = QStringLiteral("data_export_test_bare.dmcap");
+    const std::vector<FrameRow> rows = writeCapture(capturePath, true);
+    {
+        CaptureFile capture;
+        CHECK(capture.open(capturePath));
+        CHECK(capture.isIndexed());
+    }
+    checkCaptureExport(exporter, finished, capturePath, rows);
+
+    // Without a footer the export indexes the capture on its pool first
+    CHECK(writeCapture(bareCapturePath, false).size() == rows.size());
+    {
+        CaptureFile capture;
+        CHECK(capture.open(bareCapturePath));
+        CHECK(!capture.isIndexed());
+    }
+    checkCaptureExport(exporter, finished, bareCapturePath, rows);
+
+    checkHistoryExport(exporter, finished);
+
+    // A cancelled export still finishes, and says so
+    QString error;
+    CHECK(exporter.exportCapture(capturePath, QStringLiteral("data_export_test_cancel.csv"), &error));
+    exporter.cancel();
+    while (!finished.exchange(false)) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(2));
+    }
+    CHECK(exporter.stats().cancelled);
+    CHECK(!exporter.isRunning());
+
+    QFile::remove(capturePath);
+    QFile::remove(bareCapturePath);
+    QFile::remove(QStringLiteral("data_export_test_cancel.csv"));
+    return 0;
+}
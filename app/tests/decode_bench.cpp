@@ -0,0 +1,155 @@
+// Decodes one fixed set of frames through the per-field BitExtractor path
+// that DecodePlan replaced and through DecodePlan itself, and prints the
+// rate of each. Both must produce the same values; a mismatch exits
+// non-zero. Not a test: rates vary with the machine and the build type.
+//
+// Usage: dm_decode_bench [passes]
+
+#include "bit_extractor.h"
+#include "decode_plan.h"
+#include "motor_profile.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <vector>
+
+namespace {
+constexpr int kFrameSetSize = 4096;
+constexpr int kDefaultPasses = 2000;
+
+struct Frame
+{
+    int motorIndex = 0;
+    uint8_t payload[8] = {};
+};
+
+// The receive path before DecodePlan: every field is extracted from its
+// definition, stored by ID, and string-compared for the legacy members
+struct LegacyMeasure
+{
+    uint16_t ecd = 0;
+    int16_t speed_rpm = 0;
+    int16_t current = 0;
+    uint8_t rotor_temperature = 0;
+    uint8_t pcb_temperature = 0;
+    QHash<QString, double> fields;
+};
+
+LegacyMeasure parseLegacy(const MotorProfile& profile, int motorIndex, const uint8_t* payload)
+{
+    LegacyMeasure measure;
+    if (motorIndex < 0 || motorIndex >= profile.motors.size()) {
+        return measure;
+    }
+
+    const MotorDescriptor& motor = profile.motors[motorIndex];
+    for (const FieldDefinition& field : motor.fields) {
+        int32_t rawValue = BitExtractor::extract(
+            payload,
+            field.byteOffset,
+            field.bits.start,
+            field.bits.length,
+            field.littleEndian,
+            field.signedValue
+        );
+
+        double scaledValue = static_cast<double>(rawValue) * field.scale;
+        measure.fields.insert(field.id, scaledValue);
+
+        if (field.id == QStringLiteral("ecd")) {
+            measure.ecd = static_cast<uint16_t>(rawValue);
+        } else if (field.id == QStringLiteral("speed")) {
+            measure.speed_rpm = static_cast<int16_t>(rawValue);
+        } else if (field.id == QStringLiteral("current")) {
+            measure.current = static_cast<int16_t>(rawValue);
+        } else if (field.id == QStringLiteral("rotor_temp")) {
+            measure.rotor_temperature = static_cast<uint8_t>(rawValue);
+        } else if (field.id == QStringLiteral("pcb_temp")) {
+            measure.pcb_temperature = static_cast<uint8_t>(rawValue);
+        }
+    }
+    return measure;
+}
+
+std::vector<Frame> makeFrames(int motorCount)
+{
+    std::mt19937 random(1);
+    std::vector<Frame> frames(kFrameSetSize);
+    for (Frame& frame : frames) {
+        frame.motorIndex = static_cast<int>(random() % motorCount);
+        for (uint8_t& byte : frame.payload) {
+            byte = static_cast<uint8_t>(random());
+        }
+    }
+    return frames;
+}
+
+bool sameValues(const DecodePlan& plan, const MotorProfile& profile, const std::vector<Frame>& frames)
+{
+    for (const Frame& frame : frames) {
+        const LegacyMeasure legacy = parseLegacy(profile, frame.motorIndex, frame.payload);
+        MotorMeasure measure;
+        plan.decode(frame.motorIndex, frame.payload, measure);
+        if (legacy.ecd != measure.ecd || legacy.speed_rpm != measure.speed_rpm || legacy.current != measure.current
+            || legacy.rotor_temperature != measure.rotor_temperature
+            || legacy.pcb_temperature != measure.pcb_temperature) {
+            return false;
+        }
+        for (auto it = legacy.fields.constBegin(); it != legacy.fields.constEnd(); ++it) {
+            if (measure.value(plan.slotOf(it.key())) != it.value()) {
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+template <typename Decode>
+double framesPerSecond(int passes, const std::vector<Frame>& frames, Decode decode)
+{
+    const auto start = std::chrono::steady_clock::now();
+    for (int pass = 0; pass < passes; ++pass) {
+        for (const Frame& frame : frames) {
+            decode(frame);
+        }
+    }
+    const double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    return seconds > 0.0 ? static_cast<double>(passes) * frames.size() / seconds : 0.0;
+}
+}
+
+int main(int argc, char** argv)
+{
+    const int passes = argc > 1 ? std::max(1, std::atoi(argv[1])) : kDefaultPasses;
+    const MotorProfile profile = defaultMotorProfiles().first();
+    const DecodePlan plan = DecodePlan::compile(profile);
+    const std::vector<Frame> frames = makeFrames(profile.motors.size());
+
+    if (!sameValues(plan, profile, frames)) {
+        std::fprintf(stderr, "DecodePlan and BitExtractor disagree\n");
+        return 1;
+    }
+
+    // Folded into the output so neither loop is optimised away
+    double sink = 0.0;
+    const double legacyRate = framesPerSecond(passes, frames, [&](const Frame& frame) {
+        const LegacyMeasure measure = parseLegacy(profile, frame.motorIndex, frame.payload);
+        sink += measure.ecd + measure.fields.size();
+    });
+    const double planRate = framesPerSecond(passes, frames, [&](const Frame& frame) {
+        MotorMeasure measure;
+        plan.decode(frame.motorIndex, frame.payload, measure);
+        sink += measure.ecd + measure.values[0];
+    });
+
+    std::printf("%d frames x %d passes, %d motors, %d fields\n", kFrameSetSize, passes, plan.motorCount(),
+                plan.fieldCount());
+    std::printf("BitExtractor + QHash  %12.0f frames/s\n", legacyRate);
+    std::printf("DecodePlan            %12.0f frames/s  (%.1fx)\n", planRate,
+                legacyRate > 0.0 ? planRate / legacyRate : 0.0);
+    std::printf("checksum %g\n", sink);
+    return 0;
+}
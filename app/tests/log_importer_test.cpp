@@ -0,0 +1,305 @@
+// Writes the same frames as a candump -l log and as Vector ASC logs in both
+// number bases, with header, comment and error lines among them, and imports
+// each. The logs span several chunks, so the per-chunk parsers and the
+// in-order writer all take part. Every frame must come back with its time,
+// bus, direction, ID, flags, DLC and payload, in order per bus and
+// direction, and every line that is not a frame must be counted as skipped.
+
+#include "capture_file.h"
+#include "log_importer.h"
+#include "test_check.h"
+
+#include <QFile>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdarg>
+#include <cstdio>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace {
+constexpr int kFrames = 250000;         // More than one 8 MiB chunk of every log
+constexpr int kBuses = 3;
+constexpr int kErrorEvery = 1000;       // An error frame line every so many frames
+constexpr int64_t kEpochUs = 1436509052LL * 1000000;   // candump times are wall clock
+
+struct Frame
+{
+    int64_t timeUs = 0;                 // From the start of the measurement
+    int bus = 0;
+    uint8_t flags = 0;
+    uint32_t canId = 0;
+    uint8_t dlc = 0;
+    std::vector<uint8_t> payload;
+};
+
+struct Log
+{
+    std::string text;
+    uint64_t skipped = 0;               // Lines that are neither frames nor blank
+};
+
+void appendf(std::string& text, const char* format, ...)
+{
+    char buffer[512];
+    va_list args;
+    va_start(args, format);
+    const int length = std::vsnprintf(buffer, sizeof(buffer), format, args);
+    va_end(args);
+    text.append(buffer, static_cast<size_t>(length));
+}
+
+void skipLine(Log& log, const char* line)
+{
+    log.text += line;
+    log.text += '\n';
+    ++log.skipped;
+}
+
+std::vector<Frame> makeFrames()
+{
+    std::mt19937 random(25);
+    std::vector<Frame> frames(kFrames);
+    int64_t time = 0;
+    for (Frame& frame : frames) {
+        time += 1 + random() % 500;
+        frame.timeUs = time;
+        frame.bus = static_cast<int>(random() % kBuses);
+        const bool ext = random() % 4 == 0;
+        const bool rtr = random() % 50 == 0;
+        const bool canfd = !rtr && random() % 5 == 0;
+        frame.flags = static_cast<uint8_t>((ext ? CaptureFormat::Ext : 0) | (rtr ? CaptureFormat::Rtr : 0)
+                                           | (random() % 10 == 0 ? CaptureFormat::Tx : 0));
+        if (canfd) {
+            frame.flags |= CaptureFormat::CanFd | (random() % 2 ? CaptureFormat::Brs : 0)
+                           | (random() % 8 == 0 ? CaptureFormat::Esi : 0);
+        }
+        frame.canId = ext ? random() & 0x1FFFFFFF : random() & 0x7FF;
+        if (rtr) {
+            frame.dlc = static_cast<uint8_t>(random() % 9);
+        } else if (canfd) {
+            frame.dlc = static_cast<uint8_t>(random() % 16);
+        } else {
+            // Now and then a classic DLC above 8, which still carries 8 bytes
+            frame.dlc = static_cast<uint8_t>(random() % 20 == 0 ? 9 + random() % 7 : random() % 9);
+        }
+        const int length = rtr ? 0 : CaptureFormat::payloadLength(frame.dlc, canfd);
+        for (int i = 0; i < length; ++i) {
+            frame.payload.push_back(static_cast<uint8_t>(random()));
+        }
+    }
+    return frames;
+}
+
+Log writeCanDump(const std::vector<Frame>& frames)
+{
+    Log log;
+    skipLine(log, "# candump -l can0 can1 can2");
+    for (size_t i = 0; i < frames.size(); ++i) {
+        const Frame& frame = frames[i];
+        const int64_t time = kEpochUs + frame.timeUs;
+        appendf(log.text, "(%lld.%06lld) can%d ", static_cast<long long>(time / 1000000),
+                static_cast<long long>(time % 1000000), frame.bus);
+        appendf(log.text, (frame.flags & CaptureFormat::Ext) ? "%08X" : "%03X", frame.canId);
+        if (frame.flags & CaptureFormat::CanFd) {
+            appendf(log.text, "##%X", ((frame.flags & CaptureFormat::Brs) ? 1 : 0)
+                                      | ((frame.flags & CaptureFormat::Esi) ? 2 : 0));
+        } else {
+            log.text += '#';
+        }
+        if (frame.flags & CaptureFormat::Rtr) {
+            log.text += 'R';
+            if (frame.dlc > 0) {
+                appendf(log.text, "%d", frame.dlc);
+            }
+        }
+        for (uint8_t byte : frame.payload) {
+            appendf(log.text, "%02X", byte);
+        }
+        if (!(frame.flags & (CaptureFormat::CanFd | CaptureFormat::Rtr)) && frame.dlc > 8) {
+            appendf(log.text, "_%X", frame.dlc);
+        }
+        log.text += (frame.flags & CaptureFormat::Tx) ? " T\n" : " R\n";
+
+        if (i % kErrorEvery == 0) {
+            appendf(log.text, "(%lld.000000) can0 20000080#0000000000000000\n",
+                    static_cast<long long>(time / 1000000));
+            ++log.skipped;
+            log.text += '\n';
+        }
+    }
+    return log;
+}
+
+Log writeAsc(const std::vector<Frame>& frames, bool decimal)
+{
+    Log log;
+    skipLine(log, "date Wed Jan 13 10:36:44.123 am 2021");
+    skipLine(log, decimal ? "base dec  timestamps absolute" : "base hex  timestamps absolute");
+    skipLine(log, "internal events logged");
+    skipLine(log, "// version 9.0.0");
+    skipLine(log, "Begin Triggerblock Wed Jan 13 10:36:44.123 am 2021");
+    skipLine(log, "   0.000000 Start of measurement");
+
+    const char* byteFormat = decimal ? " %d" : " %02X";
+    for (size_t i = 0; i < frames.size(); ++i) {
+        const Frame& frame = frames[i];
+        char id[16];
+        std::snprintf(id, sizeof(id), decimal ? "%u%s" : "%X%s", frame.canId,
+                      (frame.flags & CaptureFormat::Ext) ? "x" : "");
+        const char* direction = (frame.flags & CaptureFormat::Tx) ? "Tx" : "Rx";
+        appendf(log.text, "%4lld.%06lld", static_cast<long long>(frame.timeUs / 1000000),
+                static_cast<long long>(frame.timeUs % 1000000));
+
+        if (frame.flags & CaptureFormat::CanFd) {
+            // Every other frame leaves out the symbolic name
+            appendf(log.text, " CANFD %3d %s %8s %s %d %d %x %2d", frame.bus + 1, direction, id,
+                    i % 2 ? "Motor" : "", (frame.flags & CaptureFormat::Brs) ? 1 : 0,
+                    (frame.flags & CaptureFormat::Esi) ? 1 : 0, frame.dlc, static_cast<int>(frame.payload.size()));
+            for (uint8_t byte : frame.payload) {
+                appendf(log.text, byteFormat, byte);
+            }
+            log.text += "   102203 135 303000 b0a3 46500250 4b140250 20011736 2001174c\n";
+        } else if (frame.flags & CaptureFormat::Rtr) {
+            appendf(log.text, " %d  %-15s %s   r %x  Length = 0 BitCount = 0 ID = %u\n", frame.bus + 1, id,
+                    direction, frame.dlc, frame.canId);
+        } else {
+            appendf(log.text, " %d  %-15s %s   d %x", frame.bus + 1, id, direction, frame.dlc);
+            for (uint8_t byte : frame.payload) {
+                appendf(log.text, byteFormat, byte);
+            }
+            appendf(log.text, "  Length = 240000 BitCount = 125 ID = %u\n", frame.canId);
+        }
+
+        if (i % kErrorEvery == 0) {
+            appendf(log.text, "%4lld.%06lld 1  ErrorFrame\n", static_cast<long long>(frame.timeUs / 1000000),
+                    static_cast<long long>(frame.timeUs % 1000000));
+            ++log.skipped;
+        }
+    }
+    skipLine(log, "End TriggerBlock");
+    return log;
+}
+
+bool writeFile(const QString& path, const std::string& text)
+{
+    QFile file(path);
+    return file.open(QIODevice::WriteOnly)
+           && file.write(text.data(), static_cast<qint64>(text.size())) == static_cast<qint64>(text.size());
+}
+
+// Runs an import to the end, or cancels it right after the start
+LogImporter::Stats import(const QString& logPath, bool cancel)
+{
+    std::atomic<bool> finished{false};
+    LogImporter importer([&finished]() { finished.store(true, std::memory_order_release); });
+    QString error;
+    CHECK(importer.start(logPath, LogImporter::capturePathFor(logPath), &error));
+    if (cancel) {
+        importer.cancel();
+    }
+    while (!finished.load(std::memory_order_acquire)) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    CHECK(!importer.isRunning());
+    return importer.stats();
+}
+
+// The capture holds the frames, in order per bus and direction
+void checkCapture(const QString& capturePath, const std::vector<Frame>& frames, int64_t timeOffsetUs)
+{
+    CaptureFile capture;
+    QString error;
+    CHECK(capture.open(capturePath, &error));
+    CHECK(capture.isIndexed());
+    CHECK(capture.blocks().size() > 10);
+
+    std::vector<std::vector<const Frame*>> lanes(2 * kBuses);
+    for (const Frame& frame : frames) {
+        lanes[frame.bus * 2 + ((frame.flags & CaptureFormat::Tx) ? 1 : 0)].push_back(&frame);
+    }
+    std::vector<size_t> next(lanes.size(), 0);
+    uint64_t records = 0;
+    for (const CaptureBlockEntry& block : capture.blocks()) {
+        capture.forEachRecord(block, [&](const CaptureRecord& record, const uint8_t* payload) {
+            const size_t lane = record.bus * 2 + ((record.flags & CaptureFormat::Tx) ? 1 : 0);
+            CHECK(lane < lanes.size() && next[lane] < lanes[lane].size());
+            const Frame& frame = *lanes[lane][next[lane]++];
+            CHECK(record.hostTimeNs == (timeOffsetUs + frame.timeUs) * 1000);
+            CHECK(record.deviceTime == 0);
+            CHECK(record.bus == frame.bus);
+            CHECK(record.flags == frame.flags);
+            CHECK(record.canId == frame.canId);
+            CHECK(record.dlc == frame.dlc);
+            CHECK(CaptureFormat::isConsistent(record));
+            CHECK(record.length == frame.payload.size());
+            CHECK(std::equal(frame.payload.begin(), frame.payload.end(), payload));
+            ++records;
+        });
+    }
+    CHECK(records == frames.size());
+    for (size_t lane = 0; lane < lanes.size(); ++lane) {
+        CHECK(next[lane] == lanes[lane].size());
+    }
+}
+}
+
+int main()
+{
+    const std::vector<Frame> frames = makeFrames();
+    struct Case
+    {
+        QString path;
+        Log log;
+        int64_t timeOffsetUs;
+    };
+    const Case cases[] = {
+        {QStringLiteral("log_importer_test.log"), writeCanDump(frames), kEpochUs},
+        {QStringLiteral("log_importer_test_hex.asc"), writeAsc(frames, false), 0},
+        {QStringLiteral("log_importer_test_dec.asc"), writeAsc(frames, true), 0},
+    };
+
+    for (const Case& test : cases) {
+        CHECK(test.log.text.size() > 8u << 20);
+        CHECK(writeFile(test.path, test.log.text));
+        const QString capturePath = LogImporter::capturePathFor(test.path);
+        CHECK(LogImporter::isLog(test.path));
+        CHECK(!LogImporter::isImported(test.path, capturePath));
+
+        const LogImporter::Stats stats = import(test.path, false);
+        CHECK(!stats.failed && !stats.cancelled);
+        CHECK(stats.frames == frames.size());
+        CHECK(stats.skippedLines == test.log.skipped);
+        CHECK(stats.fileSize == test.log.text.size());
+        CHECK(stats.bytesRead == stats.fileSize);
+        CHECK(LogImporter::isImported(test.path, capturePath));
+        checkCapture(capturePath, frames, test.timeOffsetUs);
+        QFile::remove(capturePath);
+
+        // A cancelled import leaves no capture behind
+        const LogImporter::Stats cancelled = import(test.path, true);
+        CHECK(cancelled.cancelled);
+        CHECK(cancelled.bytesRead < cancelled.fileSize);
+        CHECK(!QFile::exists(capturePath));
+        CHECK(!LogImporter::isImported(test.path, capturePath));
+        QFile::remove(test.path);
+    }
+
+    // Neither format, and ASC times relative to the previous event
+    const QString otherPath = QStringLiteral("log_importer_test_other.log");
+    QString error;
+    for (const char* text : {"not a log\n", "date Wed Jan 13 10:36:44.123 am 2021\nbase hex  timestamps relative\n"}) {
+        CHECK(writeFile(otherPath, text));
+        LogImporter importer(nullptr);
+        CHECK(!importer.start(otherPath, LogImporter::capturePathFor(otherPath), &error));
+        CHECK(!error.isEmpty());
+        CHECK(!QFile::exists(LogImporter::capturePathFor(otherPath)));
+        error.clear();
+    }
+    QFile::remove(otherPath);
+    return 0;
+}
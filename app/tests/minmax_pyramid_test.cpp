@@ -0,0 +1,107 @@
+// Appends several laps of pseudo-random samples, with a gap and a restart
+// inside the last lap, and checks MinMaxPyramid::minMax and mean against a
+// scan of the raw column for windows of every size inside the live range.
+
+#include "column_ring.h"
+#include "minmax_pyramid.h"
+#include "test_check.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <random>
+
+namespace {
+constexpr int64_t kCapacity = 10000;
+constexpr int64_t kSamples = kCapacity * 5 + 123;
+constexpr int64_t kRestartAt = kCapacity * 4 + 5077;  // Not bucket aligned
+constexpr int64_t kGap = 300;      // Sequences skipped before the restart
+
+void checkWindow(const MinMaxPyramid& pyramid, const ColumnRing<float>& raw, int64_t from, int64_t to)
+{
+    float min = 0.0f;
+    float max = 0.0f;
+    pyramid.minMax(raw, from, to, min, max);
+
+    float expectMin = raw.read(from);
+    float expectMax = expectMin;
+    double sum = expectMin;
+    for (int64_t seq = from + 1; seq < to; ++seq) {
+        expectMin = std::min(expectMin, raw.read(seq));
+        expectMax = std::max(expectMax, raw.read(seq));
+        sum += raw.read(seq);
+    }
+    CHECK(min == expectMin);
+    CHECK(max == expectMax);
+    // Bucket sums are added in another order
+    CHECK(std::fabs(pyramid.mean(raw, from, to) - sum / static_cast<double>(to - from)) < 1e-6);
+}
+}
+
+int main()
+{
+    ColumnRing<float> raw;
+    raw.reset(kCapacity);
+    MinMaxPyramid pyramid;
+    pyramid.reset(kCapacity);
+    // 8^4 <= 10000 < 8^5
+    CHECK(pyramid.levelCount() == 4);
+
+    std::mt19937 random(13);
+    std::uniform_real_distribution<float> values(-1000.0f, 1000.0f);
+    for (int64_t seq = 0; seq < kSamples; ++seq) {
+        if (seq == kRestartAt - kGap) {
+            seq = kRestartAt;
+        }
+        // A slow ramp with noise, so buckets at every level differ
+        const float value = static_cast<float>(seq % 4096) + values(random);
+        raw.write(seq, value);
+        pyramid.append(seq, value, seq == 0 || seq == kRestartAt);
+    }
+
+    const int64_t first = std::max(kSamples - kCapacity, kRestartAt);
+    const int64_t end = kSamples;
+
+    // Whole range, single samples, and aligned blocks of each level
+    checkWindow(pyramid, raw, first, end);
+    checkWindow(pyramid, raw, end - 1, end);
+    for (int level = 1; level <= pyramid.levelCount(); ++level) {
+        const int64_t size = int64_t(1) << (MinMaxPyramid::kFanoutShift * level);
+        const int64_t aligned = (first + size - 1) & ~(size - 1);
+        if (aligned + size <= end) {
+            checkWindow(pyramid, raw, aligned, aligned + size);
+        }
+    }
+
+    // Ragged windows of every length scale
+    std::uniform_int_distribution<int64_t> starts(first, end - 1);
+    for (int i = 0; i < 2000; ++i) {
+        const int64_t from = starts(random);
+        const int64_t span = std::max<int64_t>(1, (end - from) >> (i % 12));
+        checkWindow(pyramid, raw, from, from + span);
+    }
+
+    // Buckets summarise exactly their own raw samples
+    const int64_t bucket = (end >> MinMaxPyramid::kFanoutShift) - 2;
+    const MinMaxPyramid::Bucket b = pyramid.bucket(1, bucket);
+    float min = raw.read(bucket << MinMaxPyramid::kFanoutShift);
+    float max = min;
+    for (int64_t i = 1; i < 8; ++i) {
+        min = std::min(min, raw.read((bucket << MinMaxPyramid::kFanoutShift) + i));
+        max = std::max(max, raw.read((bucket << MinMaxPyramid::kFanoutShift) + i));
+    }
+    CHECK(b.min == min);
+    CHECK(b.max == max);
+    CHECK(b.count == 8);
+
+    // The bucket cut by the restart only counts what followed it
+    const int64_t cut = kRestartAt >> MinMaxPyramid::kFanoutShift;
+    const int64_t written = ((cut + 1) << MinMaxPyramid::kFanoutShift) - kRestartAt;
+    double sum = 0.0;
+    for (int64_t seq = kRestartAt; seq < kRestartAt + written; ++seq) {
+        sum += raw.read(seq);
+    }
+    CHECK(pyramid.bucket(1, cut).count == written);
+    CHECK(std::fabs(pyramid.bucket(1, cut).sum - sum) < 1e-6);
+    return 0;
+}
@@ -0,0 +1,102 @@
+// Swaps the active profile in a loop while a channel worker decodes frames.
+// Every sample must have been dispatched and decoded by one and the same
+// snapshot, and the producer pauses now and then so the worker keeps
+// falling asleep and being woken.
+
+#include "channel_worker.h"
+#include "profile_snapshot.h"
+#include "snapshot_cell.h"
+#include "test_check.h"
+#include "test_profiles.h"
+
+#include <atomic>
+#include <chrono>
+#include <thread>
+#include <vector>
+
+namespace {
+constexpr int kFrames = 400000;
+
+// Frames carry their CAN ID as ecd, so each sample tells which motor of
+// which profile decoded it
+void checkSamples(const std::vector<MotorSample>& samples)
+{
+    for (const MotorSample& sample : samples) {
+        const int asA = static_cast<int>(sample.measure.ecd) - 0x201;
+        const int asB = static_cast<int>(sample.measure.ecd) - 0x205;
+        CHECK((asA >= 0 && asA < 4 && sample.motorIndex == asA)
+              || (asB >= 0 && asB < 2 && sample.motorIndex == asB));
+    }
+}
+}
+
+int main()
+{
+    const MotorProfile profileA = makeEcdProfile(0x201, 4);
+    const MotorProfile profileB = makeEcdProfile(0x205, 2);
+
+    SnapshotCell<ProfileSnapshot> cell;
+    cell.publish(ProfileSnapshot::build(profileA));
+
+    ChannelWorker worker(0, cell, nullptr);
+    worker.start();
+
+    // Swaps keep going for as long as frames do
+    std::atomic<bool> producing{true};
+    uint64_t swaps = 0;
+    std::thread swapper([&]() {
+        while (producing.load(std::memory_order_acquire)) {
+            cell.publish(ProfileSnapshot::build(++swaps % 2 ? profileB : profileA));
+        }
+    });
+
+    uint64_t decoded = 0;
+    std::thread consumer([&]() {
+        std::vector<MotorSample> samples;
+        while (producing.load(std::memory_order_acquire) || worker.samples().depth() > 0
+               || worker.framesPending() > 0) {
+            samples.clear();
+            worker.samples().drain(samples);
+            checkSamples(samples);
+            decoded += samples.size();
+            if (samples.empty()) {
+                std::this_thread::yield();
+            }
+        }
+    });
+
+    usb_rx_frame_t frame{};
+    frame.head.dlc = 8;
+    for (int i = 0; i < kFrames; ++i) {
+        const uint32_t id = 0x201 + static_cast<uint32_t>(i % 7);
+        frame.head.can_id = id;
+        frame.payload[0] = static_cast<uint8_t>(id >> 8);
+        frame.payload[1] = static_cast<uint8_t>(id);
+        while (!worker.offer(frame, i)) {
+            std::this_thread::yield();
+        }
+        if (i % 5000 == 0) {
+            std::this_thread::sleep_for(std::chrono::microseconds(300));
+        }
+    }
+    producing.store(false, std::memory_order_release);
+
+    swapper.join();
+    consumer.join();
+    worker.stop();
+
+    // Whatever the worker decoded after the consumer last looked
+    std::vector<MotorSample> rest;
+    worker.samples().drain(rest);
+    checkSamples(rest);
+    decoded += rest.size();
+
+    CHECK(worker.framesReceived() == static_cast<uint64_t>(kFrames));
+    CHECK(worker.framesDropped() == 0);
+    CHECK(worker.samples().overflowCount() == 0);
+    CHECK(swaps > 0);
+    CHECK(decoded > 0);
+    // 0x207 matches neither profile
+    CHECK(decoded < static_cast<uint64_t>(kFrames) * 6 / 7 + 1);
+    return 0;
+}
@@ -0,0 +1,173 @@
+// Records two buses from two threads, with TX echoes on the first, then
+// replays the capture unpaced into a channel worker per bus, as the device
+// wrapper does. Every decoded sample must carry the value recorded at its
+// host time, in time order per bus, and every recorded receive frame must
+// come back exactly once.
+
+#include "channel_worker.h"
+#include "frame_recorder.h"
+#include "frame_replayer.h"
+#include "profile_snapshot.h"
+#include "snapshot_cell.h"
+#include "test_check.h"
+#include "test_profiles.h"
+
+#include <QFile>
+
+#include <atomic>
+#include <chrono>
+#include <thread>
+#include <vector>
+
+namespace {
+constexpr int kFrames0 = 200000;     // Bus 0, motors 0x201-0x204 in turn
+constexpr int kFrames1 = 100000;     // Bus 1, motor 0x202 only
+constexpr int64_t kStep0Ns = 10000;
+constexpr int64_t kStep1Ns = 20000;
+constexpr int64_t kOffset0Ns = 1;
+constexpr int64_t kOffset1Ns = 3;
+
+// Recorded host time of frame i of a bus
+int64_t recordedTime(int bus, int64_t i)
+{
+    return bus == 0 ? i * kStep0Ns + kOffset0Ns : i * kStep1Ns + kOffset1Ns;
+}
+
+// The value a bus was given at a recorded host time
+int expectedValue(int bus, int64_t timeNs)
+{
+    const int64_t i = bus == 0 ? (timeNs - kOffset0Ns) / kStep0Ns : (timeNs - kOffset1Ns) / kStep1Ns;
+    return static_cast<int>(i & 0xFFFF);
+}
+
+// Frame i carries i in its 16-bit ecd field
+usb_rx_frame_t makeFrame(uint32_t canId, int i)
+{
+    usb_rx_frame_t frame{};
+    frame.head.can_id = canId;
+    frame.head.dlc = 8;
+    frame.payload[0] = static_cast<uint8_t>(i >> 8);
+    frame.payload[1] = static_cast<uint8_t>(i);
+    return frame;
+}
+
+// Well under a lane's two blocks per writer poll, so normally nothing is
+// dropped; far above any real bus all the same
+void pace(int i)
+{
+    if (i % 1000 == 999) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+}
+
+void record(const QString& path, FrameRecorder::Stats& stats)
+{
+    FrameRecorder recorder;
+    CHECK(recorder.start(path));
+
+    std::thread bus0([&]() {
+        for (int i = 0; i < kFrames0; ++i) {
+            recorder.record(0, 0, makeFrame(0x201 + static_cast<uint32_t>(i % 4), i), recordedTime(0, i), false);
+            // An echo would decode as motor 0 with a value of 0xFFFF
+            if (i % 3 == 0) {
+                recorder.record(1, 0, makeFrame(0x201, 0xFFFF), recordedTime(0, i) + 1, true);
+            }
+            pace(i);
+        }
+    });
+    std::thread bus1([&]() {
+        for (int i = 0; i < kFrames1; ++i) {
+            recorder.record(2, 1, makeFrame(0x202, i), recordedTime(1, i), false);
+            pace(i);
+        }
+    });
+    bus0.join();
+    bus1.join();
+    stats = recorder.stats();
+    recorder.stop();
+    CHECK(!stats.writeFailed);
+}
+}
+
+int main()
+{
+    const QString path = QStringLiteral("replay_test.dmcap");
+    FrameRecorder::Stats recorded;
+    record(path, recorded);
+
+    SnapshotCell<ProfileSnapshot> cell;
+    cell.publish(ProfileSnapshot::build(makeEcdProfile(0x201, 4)));
+    ChannelWorker worker0(0, cell, nullptr);
+    ChannelWorker worker1(1, cell, nullptr);
+    ChannelWorker* workers[] = {&worker0, &worker1};
+    worker0.start();
+    worker1.start();
+
+    std::atomic<bool> finished{false};
+    FrameReplayer replayer(
+        [&](int bus, const usb_rx_frame_t& frame, int64_t hostTimeNs) {
+            CHECK(bus == 0 || bus == 1);
+            return workers[bus]->offer(frame, hostTimeNs);
+        },
+        [&]() { finished.store(true, std::memory_order_release); });
+    QString error;
+    CHECK(replayer.start(path, FrameReplayer::Mode::Unpaced, 1.0, &error));
+
+    // Replay moves the recording to start now; the first sample, one of the
+    // first 65536 of its bus, gives the shift
+    int64_t shift = 0;
+    bool shifted = false;
+    uint64_t decoded[2] = {};
+    int64_t lastTime[2][4] = {{-1, -1, -1, -1}, {-1, -1, -1, -1}};
+    std::vector<MotorSample> samples;
+    auto drain = [&]() {
+        for (int bus = 0; bus < 2; ++bus) {
+            samples.clear();
+            workers[bus]->samples().drain(samples);
+            for (const MotorSample& sample : samples) {
+                if (!shifted) {
+                    shift = sample.timestampNs - recordedTime(bus, sample.measure.ecd);
+                    shifted = true;
+                }
+                CHECK(sample.bus == bus);
+                CHECK(bus == 0 ? sample.motorIndex >= 0 && sample.motorIndex < 4 : sample.motorIndex == 1);
+                CHECK(static_cast<int>(sample.measure.ecd) == expectedValue(bus, sample.timestampNs - shift));
+                CHECK(sample.timestampNs > lastTime[bus][sample.motorIndex]);
+                lastTime[bus][sample.motorIndex] = sample.timestampNs;
+            }
+            decoded[bus] += samples.size();
+        }
+    };
+    while (!finished.load(std::memory_order_acquire)) {
+        drain();
+        std::this_thread::sleep_for(std::chrono::microseconds(200));
+    }
+    const FrameReplayer::Stats replayed = replayer.stats();
+    replayer.stop();
+
+    // stop() abandons queued frames, so let the workers catch up first
+    const auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(10);
+    while (decoded[0] + decoded[1] < replayed.frames && std::chrono::steady_clock::now() < deadline) {
+        drain();
+        std::this_thread::sleep_for(std::chrono::microseconds(200));
+    }
+    worker0.stop();
+    worker1.stop();
+    drain();
+
+    // Frames of blocks the recorder had to drop never reached the file
+    const uint64_t echoes = (kFrames0 + 2) / 3;
+    CHECK(replayed.frames + replayed.skipped == recorded.frames - recorded.droppedFrames);
+    CHECK(!replayed.truncated);
+    CHECK(decoded[0] + decoded[1] == replayed.frames);
+    CHECK(replayed.skipped <= echoes);
+    if (recorded.droppedFrames == 0) {
+        CHECK(replayed.skipped == echoes);
+        CHECK(decoded[0] == static_cast<uint64_t>(kFrames0));
+        CHECK(decoded[1] == static_cast<uint64_t>(kFrames1));
+    }
+    CHECK(worker0.framesDropped() == 0 && worker1.framesDropped() == 0);
+    CHECK(worker0.samples().overflowCount() == 0 && worker1.samples().overflowCount() == 0);
+    QFile::remove(path);
+    return 0;
+}
@@ -0,0 +1,80 @@
+// Stores samples decoded with the default profile, which declares ecd,
+// speed and current, and with a profile without fields. The legacy IDs must
+// read the profile's field where there is one, each field must be held and
+// listed once, and a profile without the fields must still get the legacy
+// metrics.
+
+#include "decode_plan.h"
+#include "telemetry_data_store.h"
+#include "test_check.h"
+
+namespace {
+constexpr int kSamples = 500;
+
+MotorSampleBatch decode(const DecodePlan& plan)
+{
+    MotorSampleBatch batch;
+    for (int i = 0; i < kSamples; ++i) {
+        const uint8_t payload[8] = {static_cast<uint8_t>(i >> 8), static_cast<uint8_t>(i),
+                                    static_cast<uint8_t>(-i >> 8), static_cast<uint8_t>(-i),
+                                    static_cast<uint8_t>(i >> 4), static_cast<uint8_t>(i * 3), 40, 0};
+        MotorSample sample;
+        sample.motorIndex = 0;
+        sample.timestampNs = int64_t(i) * 1000000;
+        plan.decode(0, payload, sample.measure);
+        batch.push_back(sample);
+    }
+    return batch;
+}
+
+void checkSeries(const TelemetryReader& reader, const QString& fieldId, const MotorSampleBatch& batch,
+                 double (*expected)(const MotorMeasure&))
+{
+    const QVector<QPointF> series = reader.getSeries(0, fieldId);
+    CHECK(series.size() == batch.size());
+    for (int i = 0; i < series.size(); ++i) {
+        CHECK(series[i].y() == expected(batch[i].measure));
+    }
+}
+}
+
+int main()
+{
+    const MotorProfile profile = defaultMotorProfiles().first();
+    const DecodePlan plan = DecodePlan::compile(profile);
+    CHECK(plan.slotOf(QStringLiteral("ecd")) >= 0 && plan.slotOf(QStringLiteral("speed")) >= 0
+          && plan.slotOf(QStringLiteral("current")) >= 0);
+    const MotorSampleBatch batch = decode(plan);
+
+    TelemetryDataStore store;
+    store.setActiveProfile(profile);
+    store.setHistorySize(kSamples);
+    store.onMotorsUpdated(batch);
+
+    // Exactly the profile's fields, once each
+    const TelemetryDataStore::SnapshotPtr snapshot = store.snapshot();
+    CHECK(snapshot->fieldIds(0) == plan.fieldIds());
+
+    checkSeries(store, QStringLiteral("ecd"), batch, [](const MotorMeasure& m) { return double(m.ecd); });
+    checkSeries(store, QStringLiteral("speed"), batch, [](const MotorMeasure& m) { return double(m.speed_rpm); });
+    checkSeries(store, QStringLiteral("current"), batch, [](const MotorMeasure& m) { return double(m.current); });
+    checkSeries(*snapshot, QStringLiteral("ecd"), batch, [](const MotorMeasure& m) { return double(m.ecd); });
+    const QVector<QPointF> byMetric = store.getSeries(0, TelemetryDataStore::Metric::Velocity);
+    CHECK(byMetric.size() == kSamples && byMetric.last().y() == batch.last().measure.speed_rpm);
+
+    TelemetryReader::FieldStats stats;
+    CHECK(store.fieldStats(0, QStringLiteral("ecd"), stats));
+    CHECK(stats.count == kSamples);
+    CHECK(stats.max == kSamples - 1);
+
+    // Without fields the legacy metrics are all there is
+    TelemetryDataStore bare;
+    bare.setActiveProfile(MotorProfile());
+    bare.setHistorySize(kSamples);
+    bare.onMotorsUpdated(batch);
+    CHECK(bare.snapshot()->fieldIds(0)
+          == QStringList({QStringLiteral("current"), QStringLiteral("ecd"), QStringLiteral("speed")}));
+    checkSeries(bare, QStringLiteral("ecd"), batch, [](const MotorMeasure& m) { return double(m.ecd); });
+    checkSeries(bare, QStringLiteral("current"), batch, [](const MotorMeasure& m) { return double(m.current); });
+    return 0;
+}
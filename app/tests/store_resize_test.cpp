@@ -0,0 +1,131 @@
+// Resizes a telemetry store holding long histories while another thread
+// keeps appending, starts a motor while the resize runs, and changes the
+// size again before the first resize is in effect. Once the
+// last size is, every motor must hold a contiguous run of the newest
+// samples, with statistics and M4 points matching a scan of the series.
+
+#include "telemetry_data_store.h"
+#include "test_check.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <iterator>
+#include <thread>
+
+namespace {
+constexpr int kInitialHistory = 200000;
+constexpr int kSizes[] = {400000, 150000, 250000};   // The second supersedes the first
+constexpr int kBatchSize = 100;
+constexpr int kPrefill = 3000;         // Batches before the resize
+constexpr int kDuring = 2000;          // Batches appended while resizing
+constexpr int kLateMotor = 2;          // First seen while resizing
+
+// Sample n of motors [first, last] has ecd n % 60000 and is n ms after the first
+void append(TelemetryDataStore& store, int& n, int first, int last)
+{
+    MotorSampleBatch batch;
+    for (int i = 0; i < kBatchSize; ++i, ++n) {
+        for (int motor = first; motor <= last; ++motor) {
+            MotorSample sample;
+            sample.motorIndex = motor;
+            sample.timestampNs = int64_t(n) * 1000000;
+            sample.measure.ecd = static_cast<uint16_t>(n % 60000);
+            sample.measure.current = static_cast<int16_t>(n % 77);
+            batch.push_back(sample);
+        }
+    }
+    store.onMotorsUpdated(batch);
+}
+
+void checkMotor(const TelemetryDataStore& store, int motor, int last, int capacity)
+{
+    const QString ecd = QStringLiteral("ecd");
+    const QVector<QPointF> series = store.getSeries(motor, ecd);
+    CHECK(!series.isEmpty() && series.size() <= capacity);
+    CHECK(store.sampleCount(motor) == series.size());
+
+    // Contiguous and ending at the newest sample
+    CHECK(static_cast<int>(series.last().y()) == last % 60000);
+    for (int i = 1; i < series.size(); ++i) {
+        CHECK(series[i].x() > series[i - 1].x());
+        CHECK(static_cast<int>(series[i].y()) == (static_cast<int>(series[i - 1].y()) + 1) % 60000);
+    }
+
+    double min = series[0].y();
+    double max = min;
+    double sum = 0.0;
+    for (const QPointF& point : series) {
+        min = std::min(min, point.y());
+        max = std::max(max, point.y());
+        sum += point.y();
+    }
+    TelemetryReader::FieldStats stats;
+    CHECK(store.fieldStats(motor, ecd, stats));
+    CHECK(stats.count == series.size());
+    CHECK(stats.min == min && stats.max == max);
+    CHECK(std::abs(stats.mean - sum / series.size()) < 1e-6 * max);
+
+    // The rebuilt levels must agree with the raw samples
+    QVector<QPointF> m4;
+    store.readM4(motor, ecd, series.first().x(), series.last().x(), 97, m4);
+    CHECK(!m4.isEmpty());
+    double m4Min = m4[0].y();
+    double m4Max = m4Min;
+    for (const QPointF& point : m4) {
+        m4Min = std::min(m4Min, point.y());
+        m4Max = std::max(m4Max, point.y());
+    }
+    CHECK(m4Min == min && m4Max == max);
+}
+}
+
+int main()
+{
+    TelemetryDataStore store;
+    store.setActiveProfile(MotorProfile());
+    store.setHistorySize(kInitialHistory);
+
+    int n = 0;
+    for (int i = 0; i < kPrefill; ++i) {
+        append(store, n, 0, 1);
+    }
+    CHECK(store.sampleCount(0) == kInitialHistory);
+
+    int last = n;
+    std::thread writer([&]() {
+        for (int i = 0; i < kDuring; ++i) {
+            append(store, last, 0, 1);
+        }
+    });
+    store.setHistorySize(kSizes[0]);
+    std::this_thread::sleep_for(std::chrono::milliseconds(20));
+    store.setHistorySize(kSizes[1]);
+    store.waitForResize();
+
+    // The late motor starts once the last resize has taken its copy
+    int late = 0;
+    store.setHistorySize(kSizes[2]);
+    std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    for (int i = 0; i < 10; ++i) {
+        append(store, late, kLateMotor, kLateMotor);
+    }
+    writer.join();
+    store.waitForResize();
+
+    const int capacity = kSizes[std::size(kSizes) - 1];
+    CHECK(store.historySize() == capacity);
+    checkMotor(store, 0, last - 1, capacity);
+    checkMotor(store, 1, last - 1, capacity);
+    checkMotor(store, kLateMotor, late - 1, capacity);
+    CHECK(store.sampleCount(kLateMotor) == late);
+
+    // Appending after the resize fills the new size and no more
+    n = last;
+    for (int i = 0; i < capacity / kBatchSize + 10; ++i) {
+        append(store, n, 0, 1);
+    }
+    CHECK(store.sampleCount(0) == capacity);
+    checkMotor(store, 0, n - 1, capacity);
+    return 0;
+}
@@ -0,0 +1,125 @@
+// Takes snapshots of a telemetry store from one thread while another keeps
+// appending several laps of history. Each snapshot must hold a contiguous
+// run of samples and read back the same series, statistics and M4 points
+// however much is written after it, and the live store must be unaffected.
+
+#include "telemetry_data_store.h"
+#include "test_check.h"
+
+#include <atomic>
+#include <thread>
+
+namespace {
+constexpr int kHistory = 1000;
+constexpr int kBatches = 3000;
+constexpr int kBatchSize = 31;
+constexpr int kMotors = 2;
+
+// Sample n of every motor has ecd n % 60000 and is n ms after the first
+MotorSampleBatch makeBatch(int& n)
+{
+    MotorSampleBatch batch;
+    for (int i = 0; i < kBatchSize; ++i, ++n) {
+        for (int motor = 0; motor < kMotors; ++motor) {
+            MotorSample sample;
+            sample.motorIndex = motor;
+            sample.timestampNs = int64_t(n) * 1000000;
+            sample.measure.ecd = static_cast<uint16_t>(n % 60000);
+            sample.measure.current = static_cast<int16_t>(n % 77);
+            batch.push_back(sample);
+        }
+    }
+    return batch;
+}
+
+void checkContiguous(const QVector<QPointF>& series)
+{
+    for (int i = 1; i < series.size(); ++i) {
+        CHECK(series[i].x() > series[i - 1].x());
+        CHECK(static_cast<int>(series[i].y()) == (static_cast<int>(series[i - 1].y()) + 1) % 60000);
+    }
+}
+
+bool samePoints(const QVector<QPointF>& a, const QVector<QPointF>& b)
+{
+    if (a.size() != b.size()) {
+        return false;
+    }
+    for (int i = 0; i < a.size(); ++i) {
+        if (a[i].x() != b[i].x() || a[i].y() != b[i].y()) {
+            return false;
+        }
+    }
+    return true;
+}
+
+bool sameStats(const TelemetryReader::FieldStats& a, const TelemetryReader::FieldStats& b)
+{
+    return a.count == b.count && a.min == b.min && a.max == b.max && a.mean == b.mean;
+}
+}
+
+int main()
+{
+    const QString ecd = QStringLiteral("ecd");
+    const QString current = QStringLiteral("current");
+
+    TelemetryDataStore store;
+    store.setActiveProfile(MotorProfile());
+    store.setHistorySize(kHistory);
+
+    int n = 0;
+    // Some history before the first snapshot
+    for (int i = 0; i < 40; ++i) {
+        store.onMotorsUpdated(makeBatch(n));
+    }
+
+    std::atomic<bool> writing{true};
+    std::thread writer([&]() {
+        int next = n;
+        for (int i = 0; i < kBatches; ++i) {
+            store.onMotorsUpdated(makeBatch(next));
+        }
+        writing.store(false, std::memory_order_release);
+    });
+
+    int snapshots = 0;
+    while (writing.load(std::memory_order_acquire)) {
+        const TelemetryDataStore::SnapshotPtr snapshot = store.snapshot();
+        for (int motor = 0; motor < kMotors; ++motor) {
+            const QVector<QPointF> series = snapshot->getSeries(motor, ecd);
+            CHECK(series.size() == kHistory);
+            CHECK(snapshot->sampleCount(motor) == kHistory);
+            checkContiguous(series);
+
+            TelemetryReader::FieldStats stats;
+            CHECK(snapshot->fieldStats(motor, current, stats));
+            QVector<QPointF> m4;
+            snapshot->readM4(motor, ecd, series.first().x(), series.last().x(), 64, m4);
+
+            // The writer laps the ring meanwhile; the snapshot must not notice
+            std::this_thread::yield();
+            CHECK(samePoints(snapshot->getSeries(motor, ecd), series));
+            TelemetryReader::FieldStats again;
+            CHECK(snapshot->fieldStats(motor, current, again));
+            CHECK(sameStats(again, stats));
+            QVector<QPointF> m4Again;
+            snapshot->readM4(motor, ecd, series.first().x(), series.last().x(), 64, m4Again);
+            CHECK(samePoints(m4Again, m4));
+        }
+        ++snapshots;
+    }
+    writer.join();
+    CHECK(snapshots > 0);
+
+    // The live store holds the newest samples, in order
+    n += kBatches * kBatchSize;
+    for (int motor = 0; motor < kMotors; ++motor) {
+        const QVector<QPointF> live = store.getSeries(motor, ecd);
+        CHECK(live.size() == kHistory);
+        for (int i = 0; i < live.size(); ++i) {
+            CHECK(static_cast<int>(live[i].y()) == (n - kHistory + i) % 60000);
+        }
+    }
+    return 0;
+}
@@ -0,0 +1,18 @@
+#ifndef TEST_CHECK_H
+#define TEST_CHECK_H
+
+#include <cstdio>
+#include <cstdlib>
+
+// The tests are plain executables run by ctest: a failed CHECK prints the
+// condition and exits non-zero, which fails the test
+#define CHECK(condition)                                                         \
+    do {                                                                         \
+        if (!(condition)) {                                                      \
+            std::fprintf(stderr, "%s:%d: CHECK(%s) failed\n", __FILE__, __LINE__, \
+                         #condition);                                            \
+            std::exit(1);                                                        \
+        }                                                                        \
+    } while (0)
+
+#endif // TEST_CHECK_H
@@ -0,0 +1,27 @@
+#ifndef TEST_PROFILES_H
+#define TEST_PROFILES_H
+
+#include <cstdint>
+
+#include "motor_profile.h"
+
+// Motor i answers on firstId + i and has one field, ecd: the big-endian
+// 16 bits at the start of the payload
+inline MotorProfile makeEcdProfile(uint32_t firstId, int motors)
+{
+    FieldDefinition ecd;
+    ecd.id = QStringLiteral("ecd");
+    ecd.byteOffset = 0;
+    ecd.bits.length = 16;
+
+    MotorProfile profile;
+    for (int i = 0; i < motors; ++i) {
+        MotorDescriptor motor;
+        motor.canIdMatcher.canId = firstId + static_cast<uint32_t>(i);
+        motor.fields = {ecd};
+        profile.motors.append(motor);
+    }
+    return profile;
+}
+
+#endif // TEST_PROFILES_H
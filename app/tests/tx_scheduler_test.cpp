@@ -0,0 +1,101 @@
+// Runs one offloaded group at 1 kHz, answering the offload check with the
+// echoes a working adapter would give, and stalls the send of one window
+// past the window's end. Windows must follow each other at the window
+// length, never start before the previous one's last frame, and the frames
+// lost to the stall must show up in the group's stats.
+
+#include "test_check.h"
+#include "tx_scheduler.h"
+
+#include <chrono>
+#include <cmath>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace {
+constexpr int kRateHz = 1000;
+constexpr int64_t kPeriodNs = 1000000000 / kRateHz;
+constexpr int64_t kWindowNs = TxScheduler::kOffloadWindowNs;
+constexpr int kWindows = 14;
+constexpr int kStalledWindow = 6;
+constexpr int64_t kStallNs = kWindowNs + 5000000;   // Five slots past the window
+
+int64_t nowNs()
+{
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+}
+
+int main()
+{
+    std::mutex mutex;
+    std::vector<int64_t> windows;       // Send time of each offloaded window
+    TxScheduler* scheduler = nullptr;
+
+    TxScheduler tx([&](int group, const int32_t*, int count, const TxRepeat& repeat) {
+        const int64_t sent = nowNs();
+        CHECK(group == 0 && count == 4);
+        if (repeat.times <= 1) {
+            return;
+        }
+        CHECK(repeat.intervalNs == kPeriodNs && repeat.times == kWindowNs / kPeriodNs);
+        if (scheduler->checkingOffload()) {
+            for (int i = 0; i < repeat.times; ++i) {
+                scheduler->onTxEcho(group, sent + i * kPeriodNs);
+            }
+        }
+        size_t index = 0;
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            windows.push_back(sent);
+            index = windows.size() - 1;
+        }
+        if (index == kStalledWindow) {
+            std::this_thread::sleep_for(std::chrono::nanoseconds(kStallNs));
+        }
+    });
+    scheduler = &tx;
+
+    const int32_t values[4] = {100, -100, 200, -200};
+    tx.setSetpoints(0, values, 4);
+    tx.setGroupRate(0, kRateHz);
+    tx.setGroupMode(0, TxScheduler::Mode::Offloaded);
+    tx.setGroupEnabled(0, true);
+    tx.start();
+    for (;;) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+        std::lock_guard<std::mutex> lock(mutex);
+        if (windows.size() >= kWindows) {
+            break;
+        }
+    }
+    tx.stop();
+    CHECK(tx.offloadCheck() == TxScheduler::OffloadCheck::Confirmed);
+
+    std::lock_guard<std::mutex> lock(mutex);
+    const TxScheduler::GroupStats stats = tx.groupStats(0);
+    CHECK(stats.rearms == windows.size());
+
+    // The stall is the only gap
+    const int64_t stalledGap = windows[kStalledWindow + 1] - windows[kStalledWindow] - kWindowNs;
+    CHECK(stalledGap >= kStallNs - kWindowNs);
+    CHECK(stats.windowGapFrames >= static_cast<uint64_t>((kStallNs - kWindowNs) / kPeriodNs));
+    CHECK(std::fabs(stats.maxWindowGapUs - stalledGap / 1000.0) < 1000.0);
+
+    // Everywhere else windows are chained: none starts before the previous
+    // one's last frame, and on average they are exactly a window apart
+    int64_t spacingSum = 0;
+    int pairs = 0;
+    for (size_t i = 1; i < windows.size(); ++i) {
+        const int64_t spacing = windows[i] - windows[i - 1];
+        CHECK(spacing > kWindowNs - kPeriodNs);
+        if (i != kStalledWindow + 1 && i != kStalledWindow + 2) {
+            spacingSum += spacing;
+            ++pairs;
+        }
+    }
+    CHECK(std::llabs(spacingSum / pairs - kWindowNs) < kWindowNs / 100);
+    return 0;
+}